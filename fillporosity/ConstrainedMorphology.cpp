@@ -1,9 +1,21 @@
 #include "ConstrainedMorphology.hpp"
+#include <algorithm>
 #include <mi/ParallelFor.hpp>
 #define BG_VALUE 0
 #define FG_VALUE 1
+#define BORDER_VALUE -1 // neither fg nor bg.
 
 ConstrainedMorphology::ConstrainedMorphology (mi::VolumeData<char>& data, const mi::VolumeData<char>& mask ) : _data(data), _mask(mask) {
+        mi::VolumeInfo& info = this->_data.getInfo();
+        const mi::Point3i& size = info.getSize();
+        this->_src.setHalo( 1, BORDER_VALUE ).init( info );
+        this->_trg.setHalo( 1, BORDER_VALUE ).init( info );
+        for ( int z = 0 ; z < size.z() ; ++z ) {
+                for ( int y = 0 ; y < size.y() ; ++y ) {
+                        const char* row = this->_data.getPointer( y, z );
+                        std::copy( row, row + size.x(), this->_src.getPointer( y, z ) );
+                }
+        }
         return;
 }
 
@@ -25,9 +37,8 @@ ConstrainedMorphology::grow ( void ) {
 bool 
 ConstrainedMorphology::morphology (const char fgValue, const char bgValue ) {
         mi::VolumeInfo& info = this->_data.getInfo();
-        mi::VolumeData<char> tmp(info);
-        ConstrainedMorphology::morphology_fn fn(this->_data, this->_mask, tmp, fgValue, bgValue);
+        ConstrainedMorphology::morphology_fn fn(this->_src, this->_mask, this->_trg, this->_data, fgValue, bgValue);
         mi::parallel_for_each(info.begin(), info.end(), fn);
-        this->_data.clone(tmp);
+        this->_src.swap(this->_trg); // the halo of both keeps BORDER_VALUE.
         return true;
 }
@@ -7,6 +7,8 @@ class ConstrainedMorphology
 private:
         mi::VolumeData<char>& _data;
         const mi::VolumeData<char>& _mask;
+        mi::VolumeData<char> _src; ///< Copy of the data with a halo of a value that is neither fg nor bg.
+        mi::VolumeData<char> _trg; ///< Result of a step with the same halo.
 
 public:
         ConstrainedMorphology ( mi::VolumeData<char>& data, const mi::VolumeData<char>& mask );
@@ -16,31 +18,46 @@ public:
 private:
         bool morphology ( const char fgValue, const char bgValue );
 
+        /**
+         * @brief One step of constrained morphology.
+         *
+         * The source has a halo of a value that is neither fg nor bg, so that 6 neighbors are read through linear
+         * offsets without bounds checks. The mask is read only for neighbors inside the volume and needs no halo.
+         * The result is written to the target and to the data given by the user.
+         */
         class morphology_fn
         {
         private:
                 const  mi::VolumeData<char>& _srcData;
                 const  mi::VolumeData<char>& _maskData;
                 mi::VolumeData<char>& _trgData;
+                mi::VolumeData<char>& _outData;
                 char _fgValue;
                 char _bgValue;
+                const mi::NeighborOffset<6> _srcOffset;
+                const mi::NeighborOffset<6> _maskOffset;
         public :
-                morphology_fn( const mi::VolumeData<char>& srcData, const mi::VolumeData<char>& maskData, mi::VolumeData<char>& trgData, char fgValue, char bgValue ) : _srcData( srcData ), _maskData( maskData ), _trgData( trgData ), _fgValue( fgValue ), _bgValue( bgValue )
+                morphology_fn( const mi::VolumeData<char>& srcData, const mi::VolumeData<char>& maskData, mi::VolumeData<char>& trgData, mi::VolumeData<char>& outData, char fgValue, char bgValue ) :
+                        _srcData( srcData ), _maskData( maskData ), _trgData( trgData ), _outData( outData ), _fgValue( fgValue ), _bgValue( bgValue ),
+                        _srcOffset( srcData.getStrideY(), srcData.getStrideZ() ), _maskOffset( maskData.getStrideY(), maskData.getStrideZ() )
                 {
                         return;
                 }
                 void operator () ( const mi::Point3i& p )
                 {
-                        char result = this->_srcData.get( p );
+                        const char* src = this->_srcData.getPointer( p.y(), p.z() ) + p.x();
+                        char result = *src;
                         if ( result == this->_bgValue ) {
-                                for ( mi::Neighbor::iterator diter = mi::Neighbor::begin() ; diter != mi::Neighbor::end6() ; ++diter ) {
-                                        const mi::Point3i np = p + *diter;
-                                        if ( ! this->_trgData.getInfo().isValid( np ) ) continue;
-                                        if ( this->_maskData.get( np ) == 1 ) continue;
-                                        if ( this->_srcData.get( np ) == this->_fgValue ) result = this->_fgValue;
+                                const char* mask = this->_maskData.getPointer( p.y(), p.z() ) + p.x();
+                                for ( int i = 0 ; i < mi::NeighborOffset<6>::size ; ++i ) {
+                                        if ( src[ this->_srcOffset[i] ] != this->_fgValue ) continue; // including the halo.
+                                        if ( mask[ this->_maskOffset[i] ] == 1 ) continue;
+                                        result = this->_fgValue;
+                                        break;
                                 }
                         }
                         this->_trgData.set( p, result );
+                        this->_outData.set( p, result );
                 }
         };
 };
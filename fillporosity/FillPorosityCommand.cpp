@@ -5,6 +5,8 @@
 #include <mi/SystemInfo.hpp>
 #include <mi/ConnectedComponentLabellerRle.hpp>
 #include <mi/FunctionObject.hpp>
+#include <mi/VolumeDataCropper.hpp>
+#include <mi/VolumeDataCache.hpp>
 #include "ConstrainedMorphology.hpp"
 
 template<typename T>
@@ -20,13 +22,22 @@ FillPorosityCommand<T>::FillPorosityCommand ( void ) : mi::CommandTemplate( "xen
         attrSet.createTripleNumericAttribute<int>( "-size", size.x(), size.y(), size.z(), "size of volume" ).setMin( 1, 1, 1 ).setMax(512, 512, 1024).setMandatory();
         attrSet.createTripleNumericAttribute<double>( "-pitch", pitch.x(), pitch.y(), pitch.z(), "pitch size" ).setMin ( 0.0001, 0.0001, 0.0001 ).setDefaultValue( 1,1,1 );
         attrSet.createNumericAttribute<int> ( "-h", this->_header_size, "header size" ).setDefaultValue( 0 ).setMin( 0 );
+        attrSet.createStringAttribute( "-src", this->_src_type, "value type in the file (char, uchar, short, ushort, int, uint, float or double)" ).setDefaultValue( "" );
+        attrSet.createBooleanAttribute( "-be", this->_isBigEndian, "the file is big-endian" );
+        attrSet.createNumericAttribute<double>( "-offset", this->_value_offset, "offset added to values in the file" ).setDefaultValue( 0 );
 
+        attrSet.createNumericAttribute<int> ( "-debug_mem", this->_debug_memory, "memory for writing debug data in background (MB, 0: synchronous)" ).setDefaultValue( 1024 ).setMin( 0 );
+        attrSet.createBooleanAttribute( "-debug_brick", this->_debug_brick, "write debug data in the chunked compressed format" );
         attrSet.createNumericAttribute<int> ( "-thread", this->_num_threads, "The number of threads" ).setDefaultValue( mi::SystemInfo::getNumCores() ).setMin( 1 );
         attrSet.createNumericAttribute<double>( "-iso", this->_isovalue, "isovalue" ).setMandatory();
         attrSet.createNumericAttribute<double>( "-r", this->_radius, "Radius" ).setMandatory();
         
         attrSet.createNumericAttribute<int>("-ncp", this->_num_pruning, "The number of constrained pruning").setMin(0).setDefaultValue(0);
         attrSet.createNumericAttribute<int>("-ncg", this->_num_growing, "The number of constrained growing").setMin(0).setDefaultValue(0);
+        attrSet.createBooleanAttribute( "-brick", this->_brick, "use bricked layout for closing" );
+        attrSet.createBooleanAttribute( "-crop", this->_crop, "process only the bounding box of voxels above the isovalue" );
+        attrSet.createNumericAttribute<double>( "-margin", this->_margin, "margin of -crop (at least 2 x -r is used)" ).setMin( 0 ).setDefaultValue( 0 );
+        attrSet.createStringAttribute( "-cache", this->_cache_dir, "directory for reusing label and closing data of previous runs (empty: off)" ).setDefaultValue( "" );
 
         return ;
 }
@@ -42,13 +53,16 @@ bool
 FillPorosityCommand<T>::init ( const mi::Argument& arg )
 {
         if ( ! this->getAttributeSet().parse( arg ) ) return false;
+        mi::VolumeDataUtility::setNumThread( this->_num_threads );
 
         this->_ctData.init( mi::VolumeInfo( this->_size, this->_pitch ) );
-        if ( ! mi::VolumeDataUtility::open( this->_ctData, this->_ct_file, this->_header_size ) ) return false;
+        mi::RawValueType type;
+        if ( ! mi::getRawValueType( this->_src_type, type ) ) return false;
+        if ( ! mi::VolumeDataUtility::open( this->_ctData, this->_ct_file, this->_header_size, type, this->_isBigEndian, this->_value_offset ) ) return false;
         if ( this->isDebugModeOn() ) {
                 mi::VolumeDataUtility::setDebugModeOn();
+                mi::VolumeDataUtility::setDebugWriter( static_cast<size_t>( this->_debug_memory ) * 1024 * 1024, this->_debug_brick );
         }
-        mi::VolumeDataUtility::setNumThread( this->_num_threads );
         return true;
 }
 
@@ -56,33 +70,68 @@ template<typename T>
 bool
 FillPorosityCommand<T>::run  ( void )
 {
-	const mi::VolumeInfo& info = const_cast<mi::VolumeData<T>&>( this->_ctData ).getInfo();
+        // crop : closing is not affected by the box when the margin is larger than its diameter.
+        mi::VolumeView<T> ctView( this->_ctData );
+        if ( this->_crop ) {
+                const mi::Point3d pitch = this->_ctData.getInfo().getPitch();
+                const double minPitch = std::min( pitch.x(), std::min( pitch.y(), pitch.z() ) );
+                const int margin = static_cast<int>( std::ceil( std::max( this->_margin, 2 * this->_radius ) / minPitch ) ) + 1;
+                mi::VolumeDataCropper<T> cropper( this->_ctData );
+                cropper.setNumThread( this->_num_threads );
+                if ( cropper.compute( static_cast<T>( this->_isovalue ), margin ) ) {
+                        const mi::Point3i bmin = cropper.getMin();
+                        const mi::Point3i bmax = cropper.getMax();
+                        mi::VolumeDataUtility::clip( this->_ctData, bmin, bmax, ctView );
+                        std::cerr<<"crop : ("<<bmin.x()<<", "<<bmin.y()<<", "<<bmin.z()<<") - ("<<bmax.x()<<", "<<bmax.y()<<", "<<bmax.z()<<")"<<std::endl;
+                }
+        }
+	const mi::VolumeInfo& info = ctView.getInfo();
         const mi::Point3i& size = info.getSize();
-        // binarize
-	mi::VolumeData<char> binaryData( info );
-	std::cerr<<"binarization ";
-	mi::VolumeDataUtility::binarize<T>( this->_ctData, binaryData, static_cast<T>(this->_isovalue) );
-	std::cerr<<"done"<<std::endl;
-        // fill hole
-	mi::VolumeData<char> labelData( size );
-	std::cerr<<"filling"<<std::endl;
-        this->fill_closed_porosity( binaryData, labelData ) ;
-	mi::VolumeDataUtility::debug_save( labelData, "labeldata.raw" );
-	std::cerr<<"done"<<std::endl;
+        // keys : voxels in the box ( with their positions ) and parameters of each stage.
+        mi::VolumeDataCache cache( this->_cache_dir );
+        cache.setNumThread( this->_num_threads );
+        uint64_t labelKey = 0, closeKey = 0;
+        if ( cache.isEnabled() ) {
+                labelKey = mi::VolumeDataCache::combine( cache.hash( ctView ), this->_isovalue );
+                closeKey = mi::VolumeDataCache::combine( labelKey, this->_radius );
+        }
+	mi::VolumeData<char> labelData;
+        if ( cache.load( "label", labelKey, labelData ) ) {
+                std::cerr<<"cache : "<<cache.getFileName( "label", labelKey )<<std::endl;
+        } else {
+                // binarize
+                mi::VolumeData<char> binaryData( info );
+                std::cerr<<"binarization ";
+                mi::VolumeDataUtility::binarize<T>( ctView, binaryData, static_cast<T>(this->_isovalue) );
+                std::cerr<<"done"<<std::endl;
+                // fill hole
+                labelData.init( size );
+                std::cerr<<"filling"<<std::endl;
+                this->fill_closed_porosity( binaryData, labelData ) ;
+                mi::VolumeDataUtility::debug_save( labelData, "labeldata.raw" );
+                std::cerr<<"done"<<std::endl;
+                cache.save( "label", labelKey, labelData );
+        }
 
         // morphology
-	mi::VolumeData<char> closeData( size );
-	std::cerr<<"closing"<<std::endl;
-        this->closing( labelData, closeData, this->_radius );
-	mi::VolumeDataUtility::debug_save( closeData, "closedata.raw" );
-	std::cerr<<"done"<<std::endl;
+	mi::VolumeData<char> closeData;
+        if ( cache.load( "closing", closeKey, closeData ) ) {
+                std::cerr<<"cache : "<<cache.getFileName( "closing", closeKey )<<std::endl;
+        } else {
+                closeData.init( size );
+                std::cerr<<"closing"<<std::endl;
+                this->closing( labelData, closeData, this->_radius );
+                mi::VolumeDataUtility::debug_save( closeData, "closedata.raw" );
+                std::cerr<<"done"<<std::endl;
+                cache.save( "closing", closeKey, closeData );
+        }
         // replacement
         for( int z = 0 ; z < size.z() ; ++z ) {
                 for( int y = 0 ; y < size.y() ; ++y ) {
                         for( int x = 0 ; x < size.x() ; ++x ) {
                                 const mi::Point3i p ( x,y,z );
                                 if ( closeData.get( p ) == 1 && labelData.get( p ) == 0 ) { // the data is void
-                                        this->_ctData.set( p, static_cast<T>(this->_isovalue) );
+                                        ctView.set( p, static_cast<T>(this->_isovalue) );
                                 }
                         }
                 }
@@ -94,6 +143,7 @@ template<typename T>
 bool
 FillPorosityCommand<T> ::term ( void )
 {
+        mi::VolumeDataUtility::flush_debug();
         return mi::VolumeDataUtility::save( this->_ctData, this->_output_file );
 }
 
@@ -122,12 +172,27 @@ template<typename T>
 void
 FillPorosityCommand<T>::closing ( mi::VolumeData<char>& inData, mi::VolumeData<char>& outData , const double radius )
 {
-        mi::VolumeInfo& info = const_cast<mi::VolumeData<T>&>( this->_ctData ).getInfo();
-        mi::VolumeData<char> tmpData0( info );
-        mi::VolumeDataUtility::dilate( inData, tmpData0, radius );
-        mi::VolumeData<char> tmpData1( info );
-        mi::VolumeDataUtility::extract_nth_component ( tmpData0, tmpData1, 1 );
-        mi::VolumeDataUtility::erode ( tmpData1, outData, radius );
+        const mi::VolumeInfo info( inData.getSize(), this->_ctData.getInfo().getPitch() );
+        if ( this->_brick ) {
+                mi::VolumeData<char> tmpData0( info );
+                mi::VolumeData<char> tmpData1( info );
+                // spheres are probed in the bricked copy.
+                mi::BrickedVolumeData<char> brickData;
+                brickData.copyFrom( inData, this->_num_threads );
+                mi::VolumeDataUtility::dilate( brickData, tmpData0, radius );
+                mi::VolumeDataUtility::extract_nth_component ( tmpData0, tmpData1, 1 );
+                brickData.copyFrom( tmpData1, this->_num_threads );
+                mi::VolumeDataUtility::erode ( brickData, outData, radius );
+                return;
+        }
+        // the chain runs on run lists and only the result is expanded.
+        mi::RunLengthVolume runs;
+        runs.encode( inData, this->_num_threads );
+        mi::VolumeDataUtility::dilate( runs, runs, radius ); // with the pitch of inData as the dense chain.
+        runs.getInfo().init( info.getSize(), info.getPitch(), info.getOrigin() );
+        mi::VolumeDataUtility::extract_nth_component ( runs, runs, 1 );
+        mi::VolumeDataUtility::erode ( runs, runs, radius );
+        runs.decode( outData, this->_num_threads );
         return;
 }
 
@@ -12,6 +12,9 @@ private:
         std::string _output_file;
 
         int _header_size;
+        std::string _src_type;
+        bool _isBigEndian;
+        double _value_offset;
         mi::Point3i _size;
         mi::Vector3d _pitch;
 
@@ -20,9 +23,15 @@ private:
 
         int _num_pruning;
         int _num_growing;
+        bool _brick;
+        bool _crop;
+        double _margin;
+        std::string _cache_dir;
 
         mi::VolumeData<T>    _ctData;
         int _num_threads;
+        int _debug_memory;
+        bool _debug_brick;
 
 public:
         FillPorosityCommand ( void ) ;
@@ -103,13 +103,19 @@ PorosityAnalyzer::classify_porosity ( const mi::VolumeData<char>& inData, const
 	mi::VolumeInfo& info = const_cast< mi::VolumeData<char>& >(inData).getInfo();
 	mi::VolumeData<char> tmpData(info);
 	mi::VolumeDataUtility::diff(inData, maskData, tmpData);
-	int nlabels = 0;
 	const char CLOSED_POROSITY = 1;
 	const char OPEN_POROSITY =   3;
-	std::vector<char> types( nlabels, POROSITY_BG);
 	// 分離するルーチン	
-	mi::VolumeData<int> labelData(info);
-	mi::VolumeDataUtility::label_rle( tmpData, labelData, 6, false, &nlabels);
+	// pores touching the border of the volume are open. the flags are accumulated in labelling.
+	// pores are 26-connected ( runs ); label_rle() ignored the 6-neighborhood given here before.
+	mi::ConnectedComponentLabellerRle labeller( tmpData );
+	labeller.setNumThread( mi::VolumeDataUtility::getNumThread() );
+	const int nlabels = labeller.label( false );
+	std::vector<char> types( nlabels + 1, 0 );
+	for ( int i = 1 ; i <= nlabels ; ++i ) {
+		types[i] = labeller.getComponent( i ).isBorder() ? OPEN_POROSITY : CLOSED_POROSITY;
+	}
+	labeller.getData( outData, types ); // types are written from the runs.
 	return 1;
 }
 
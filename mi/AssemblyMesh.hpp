@@ -41,6 +41,37 @@ namespace mi
                         return;
                 };
 
+                /**
+                * @brief Move constructor. The source becomes empty.
+                * @param [in,out] that Instance.
+                */
+                AssemblyMesh ( AssemblyMesh&& that ) {
+                        this->swap( that );
+                        return;
+                }
+
+                /**
+                * @brief Move assignment. The source becomes empty.
+                * @param [in,out] that Instance.
+                * @return Instance itself.
+                */
+                AssemblyMesh& operator = ( AssemblyMesh&& that ) {
+                        if ( this != &that ) {
+                                this->init();
+                                this->swap( that );
+                        }
+                        return *this;
+                }
+
+                /**
+                * @brief Exchange the meshes with another assembly.
+                * @param [in,out] that Instance.
+                */
+                void swap ( AssemblyMesh& that ) {
+                        this->_mesh.swap( that._mesh );
+                        return;
+                }
+
                 int create( void ) {
                         int newId = this->getNumMeshes();
                         this->_mesh.push_back( new Mesh() );
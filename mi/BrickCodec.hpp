@@ -0,0 +1,186 @@
+/**
+ * @file BrickCodec.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_BRICK_CODEC_HPP
+#define MI_BRICK_CODEC_HPP 1
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <stdint.h>
+namespace mi
+{
+        /**
+         * @class BrickCodec BrickCodec.hpp <mi/BrickCodec.hpp>
+         * @brief Lossless codec for blocks of voxel values.
+         *
+         * Bytes of each value are first split into byte planes ( all lowest bytes, then the next bytes, ... ),
+         * so that slowly varying upper bytes form long repeats. The planes are then compressed by a
+         * byte-oriented LZ77 scheme with 64KB window:
+         * each sequence is a token ( upper 4 bits: literal length, lower 4 bits: match length - 4, 15 means
+         * that extra length bytes follow ), literals, a 2-byte offset and the extra match length bytes.
+         * The last sequence has literals only.
+         */
+        class BrickCodec
+        {
+        private:
+                explicit BrickCodec ( void );
+                BrickCodec ( const BrickCodec& that );
+                void operator = ( const BrickCodec& that );
+        public:
+                /**
+                 * @brief Compress values.
+                 * @param [in] src Values.
+                 * @param [in] bytes Size of values ( byte ).
+                 * @param [in] valueSize Size of a value ( byte ).
+                 * @param [out] dst Compressed bytes.
+                 */
+                static void compress ( const char* src, const size_t bytes, const size_t valueSize, std::vector<char>& dst ) {
+                        dst.clear();
+                        if ( bytes == 0 ) return;
+                        std::vector<char> planes;
+                        const char* in = src;
+                        if ( valueSize > 1 && bytes % valueSize == 0 ) {
+                                BrickCodec::shuffle( src, bytes, valueSize, planes );
+                                in = &planes[0];
+                        }
+                        BrickCodec::encode( reinterpret_cast<const unsigned char*>( in ), bytes, dst );
+                        return;
+                }
+
+                /**
+                 * @brief Decompress values.
+                 * @param [in] src Compressed bytes.
+                 * @param [in] srcBytes Size of compressed bytes.
+                 * @param [in] valueSize Size of a value ( byte ).
+                 * @param [out] dst Values.
+                 * @param [in] bytes Size of values ( byte ).
+                 * @retval true Success.
+                 * @retval false The data is broken.
+                 */
+                static bool decompress ( const char* src, const size_t srcBytes, const size_t valueSize, char* dst, const size_t bytes ) {
+                        if ( bytes == 0 ) return srcBytes == 0;
+                        if ( valueSize > 1 && bytes % valueSize == 0 ) {
+                                std::vector<char> planes( bytes );
+                                if ( !BrickCodec::decode( reinterpret_cast<const unsigned char*>( src ), srcBytes, reinterpret_cast<unsigned char*>( &planes[0] ), bytes ) ) return false;
+                                BrickCodec::unshuffle( &planes[0], bytes, valueSize, dst );
+                                return true;
+                        }
+                        return BrickCodec::decode( reinterpret_cast<const unsigned char*>( src ), srcBytes, reinterpret_cast<unsigned char*>( dst ), bytes );
+                }
+        private:
+                static void shuffle ( const char* src, const size_t bytes, const size_t valueSize, std::vector<char>& dst ) {
+                        const size_t n = bytes / valueSize;
+                        dst.resize( bytes );
+                        for ( size_t b = 0 ; b < valueSize ; ++b ) {
+                                char* plane = &dst[ b * n ];
+                                for ( size_t i = 0 ; i < n ; ++i ) plane[i] = src[ i * valueSize + b ];
+                        }
+                        return;
+                }
+
+                static void unshuffle ( const char* src, const size_t bytes, const size_t valueSize, char* dst ) {
+                        const size_t n = bytes / valueSize;
+                        for ( size_t b = 0 ; b < valueSize ; ++b ) {
+                                const char* plane = src + b * n;
+                                for ( size_t i = 0 ; i < n ; ++i ) dst[ i * valueSize + b ] = plane[i];
+                        }
+                        return;
+                }
+
+                static uint32_t read32 ( const unsigned char* p ) {
+                        uint32_t v;
+                        std::memcpy( &v, p, 4 );
+                        return v;
+                }
+
+                static void put_length ( size_t len, std::vector<char>& dst ) {
+                        while ( len >= 255 ) {
+                                dst.push_back( static_cast<char>( 255 ) );
+                                len -= 255;
+                        }
+                        dst.push_back( static_cast<char>( len ) );
+                        return;
+                }
+
+                static void put_sequence ( const unsigned char* literal, const size_t numLiterals, const size_t offset, const size_t matchLength, std::vector<char>& dst ) {
+                        const size_t ml = matchLength > 0 ? matchLength - 4 : 0;
+                        const unsigned char token = static_cast<unsigned char>( ( std::min<size_t>( numLiterals, 15 ) << 4 ) | std::min<size_t>( ml, 15 ) );
+                        dst.push_back( static_cast<char>( token ) );
+                        if ( numLiterals >= 15 ) BrickCodec::put_length( numLiterals - 15, dst );
+                        dst.insert( dst.end(), literal, literal + numLiterals );
+                        if ( matchLength == 0 ) return;
+                        dst.push_back( static_cast<char>( offset & 0xff ) );
+                        dst.push_back( static_cast<char>( ( offset >> 8 ) & 0xff ) );
+                        if ( ml >= 15 ) BrickCodec::put_length( ml - 15, dst );
+                        return;
+                }
+
+                static void encode ( const unsigned char* src, const size_t n, std::vector<char>& dst ) {
+                        const int hashBits = 14;
+                        std::vector<int64_t> table( static_cast<size_t>( 1 ) << hashBits, -1 );
+                        dst.reserve( n / 2 + 16 );
+                        size_t anchor = 0;
+                        size_t i = 0;
+                        while ( i + 4 <= n ) {
+                                const uint32_t v = BrickCodec::read32( src + i );
+                                const size_t h = static_cast<size_t>( ( v * 2654435761u ) >> ( 32 - hashBits ) );
+                                const int64_t cand = table[h];
+                                table[h] = static_cast<int64_t>( i );
+                                if ( cand < 0 || i - static_cast<size_t>( cand ) > 65535 || BrickCodec::read32( src + cand ) != v ) {
+                                        ++i;
+                                        continue;
+                                }
+                                size_t len = 4;
+                                while ( i + len < n && src[ cand + len ] == src[ i + len ] ) ++len;
+                                BrickCodec::put_sequence( src + anchor, i - anchor, i - static_cast<size_t>( cand ), len, dst );
+                                i += len;
+                                anchor = i;
+                        }
+                        BrickCodec::put_sequence( src + anchor, n - anchor, 0, 0, dst );
+                        return;
+                }
+
+                static bool get_length ( const unsigned char*& ip, const unsigned char* iend, size_t& len ) {
+                        unsigned char c;
+                        do {
+                                if ( ip >= iend ) return false;
+                                c = *ip++;
+                                len += c;
+                        } while ( c == 255 );
+                        return true;
+                }
+
+                static bool decode ( const unsigned char* src, const size_t srcBytes, unsigned char* dst, const size_t n ) {
+                        const unsigned char* ip = src;
+                        const unsigned char* iend = src + srcBytes;
+                        size_t op = 0;
+                        while ( ip < iend ) {
+                                const unsigned char token = *ip++;
+                                size_t numLiterals = token >> 4;
+                                if ( numLiterals == 15 && !BrickCodec::get_length( ip, iend, numLiterals ) ) return false;
+                                if ( static_cast<size_t>( iend - ip ) < numLiterals || n - op < numLiterals ) return false;
+                                std::memcpy( dst + op, ip, numLiterals );
+                                ip += numLiterals;
+                                op += numLiterals;
+                                if ( ip == iend ) break; // last sequence.
+
+                                if ( iend - ip < 2 ) return false;
+                                const size_t offset = static_cast<size_t>( ip[0] ) | ( static_cast<size_t>( ip[1] ) << 8 );
+                                ip += 2;
+                                size_t len = token & 0x0f;
+                                if ( len == 15 && !BrickCodec::get_length( ip, iend, len ) ) return false;
+                                len += 4;
+                                if ( offset == 0 || offset > op || n - op < len ) return false;
+                                unsigned char* out = dst + op;
+                                const unsigned char* from = out - offset;
+                                if ( offset >= len ) std::memcpy( out, from, len );
+                                else for ( size_t k = 0 ; k < len ; ++k ) out[k] = from[k]; // overlapping copy.
+                                op += len;
+                        }
+                        return op == n;
+                }
+        };
+}
+#endif// MI_BRICK_CODEC_HPP
@@ -0,0 +1,270 @@
+/**
+ * @file BrickedVolumeData.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_BRICKED_VOLUME_DATA_HPP
+#define MI_BRICKED_VOLUME_DATA_HPP 1
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include "VolumeInfo.hpp"
+#include "VolumeData.hpp"
+#include "ParallelFor.hpp"
+namespace mi
+{
+        /**
+         * @class BrickedVolumeData BrickedVolumeData.hpp <mi/BrickedVolumeData.hpp>
+         * @brief Volume data stored in small cubic bricks.
+         *
+         * Voxels of a B x B x B brick are contiguous ( x-fastest in the brick ), so the 26 neighbors of
+         * most voxels lie in the same few kilobytes. Accessors are the same as VolumeData ( get(), set(),
+         * at(), getInfo() and getSize() ), so function objects written for VolumeData run on either layout
+         * when the volume type is a template parameter. get( p, d ) reads p + d through brick-local
+         * offsets when p + d stays in the brick of p.
+         * B must be a power of two. Bricks at the upper boundary are padded.
+         */
+        template <typename T, int B = 8>
+        class BrickedVolumeData
+        {
+                static_assert( B > 0 && ( B & ( B - 1 ) ) == 0, "brick size must be a power of two." );
+        private:
+                BrickedVolumeData ( const BrickedVolumeData<T, B>& that );
+                void operator = ( const BrickedVolumeData<T, B>& that );
+        private:
+                static const int SHIFT = ( B >= 64 ) ? 6 : ( B >= 32 ) ? 5 : ( B >= 16 ) ? 4 : ( B >= 8 ) ? 3 : ( B >= 4 ) ? 2 : ( B >= 2 ) ? 1 : 0;
+                static const int MASK = B - 1;
+                static_assert( ( 1 << SHIFT ) == B, "brick size is too large." );
+        private:
+                VolumeInfo _info;
+                std::vector<T> _data; ///< Voxels ( brick by brick ).
+                size_t _nbx; ///< The number of bricks ( x ).
+                size_t _nby; ///< The number of bricks ( y ).
+                bool _isReadable;
+        public:
+                explicit BrickedVolumeData ( void ) : _nbx( 0 ), _nby( 0 ), _isReadable( false ) {
+                        return;
+                }
+
+                explicit BrickedVolumeData ( const VolumeInfo& info, const bool allocateMemory = true ) : _nbx( 0 ), _nby( 0 ), _isReadable( false ) {
+                        this->init( info, allocateMemory );
+                        return;
+                }
+
+                /**
+                 * @brief Move constructor. The source becomes empty.
+                 * @param [in,out] that Instance.
+                 */
+                BrickedVolumeData ( BrickedVolumeData<T, B>&& that ) : _nbx( 0 ), _nby( 0 ), _isReadable( false ) {
+                        this->swap( that );
+                        return;
+                }
+
+                /**
+                 * @brief Exchange the contents with another volume without copying voxels.
+                 * @param [in,out] that Instance.
+                 */
+                void swap ( BrickedVolumeData<T, B>& that ) {
+                        this->_info.swap( that._info );
+                        this->_data.swap( that._data );
+                        std::swap( this->_nbx, that._nbx );
+                        std::swap( this->_nby, that._nby );
+                        std::swap( this->_isReadable, that._isReadable );
+                        return;
+                }
+
+                BrickedVolumeData& init ( const VolumeInfo& info, const bool allocateMemory = true ) {
+                        this->deallocate();
+                        this->_info.init( info.getSize(), info.getPitch(), info.getOrigin() );
+                        if ( allocateMemory ) this->allocate();
+                        return *this;
+                }
+
+                bool allocate ( void ) {
+                        if ( ! this->isReadable() ) {
+                                const Point3i& size = this->_info.getSize();
+                                this->_nbx = static_cast<size_t>( ( size.x() + MASK ) >> SHIFT );
+                                this->_nby = static_cast<size_t>( ( size.y() + MASK ) >> SHIFT );
+                                const size_t nbz = static_cast<size_t>( ( size.z() + MASK ) >> SHIFT );
+                                this->_data.assign( ( this->_nbx * this->_nby * nbz ) << ( 3 * SHIFT ), T() );
+                                this->_isReadable = true;
+                        }
+                        return true;
+                }
+
+                bool deallocate ( void ) {
+                        std::vector<T>().swap( this->_data );
+                        this->_isReadable = false;
+                        return true;
+                }
+
+                inline bool isReadable ( void ) const {
+                        return this->_isReadable;
+                }
+
+                inline VolumeInfo& getInfo ( void ) {
+                        return this->_info;
+                }
+
+                inline Point3i getSize ( void ) {
+                        return this->getInfo().getSize();
+                }
+
+                /**
+                 * @brief Get the brick size.
+                 * @return Brick size.
+                 */
+                static int getBrickSize ( void ) {
+                        return B;
+                }
+
+                BrickedVolumeData& fill ( const T& value ) {
+                        std::fill( this->_data.begin(), this->_data.end(), value );
+                        return *this;
+                }
+
+                void clear ( void ) {
+                        this->fill( T() );
+                        return;
+                }
+
+                inline T get ( const Point3i& p ) const {
+                        return this->at( p.x(), p.y(), p.z() );
+                }
+
+                inline T get ( const int x, const int y, const int z ) const {
+                        return this->at( x, y, z );
+                }
+
+                /**
+                 * @brief Get the value at a neighbor.
+                 * @param [in] p Position.
+                 * @param [in] d Offset to the neighbor.
+                 * @return Value at p + d.
+                 */
+                inline T get ( const Point3i& p, const Point3i& d ) const {
+                        const int lx = ( p.x() & MASK ) + d.x();
+                        const int ly = ( p.y() & MASK ) + d.y();
+                        const int lz = ( p.z() & MASK ) + d.z();
+                        if ( static_cast<unsigned int>( lx | ly | lz ) < static_cast<unsigned int>( B ) ) {
+                                const ptrdiff_t delta = d.x() + d.y() * B + d.z() * B * B;
+                                return this->_data[ this->get_offset( p.x(), p.y(), p.z() ) + delta ];
+                        }
+                        return this->at( p.x() + d.x(), p.y() + d.y(), p.z() + d.z() );
+                }
+
+                inline void set ( const Point3i& p, const T v ) {
+                        this->set( p.x(), p.y(), p.z(), v );
+                        return;
+                }
+
+                inline void set ( const int x, const int y, const int z, const T v ) {
+                        this->at( x, y, z ) = v;
+                        return;
+                }
+
+                inline T at ( const Point3i& p ) const {
+                        return this->at( p.x(), p.y(), p.z() );
+                }
+
+                inline T& at ( const Point3i& p ) {
+                        return this->at( p.x(), p.y(), p.z() );
+                }
+
+                inline T at ( const int x, const int y, const int z ) const {
+                        return this->_data[ this->get_offset( x, y, z ) ];
+                }
+
+                inline T& at ( const int x, const int y, const int z ) {
+                        return this->_data[ this->get_offset( x, y, z ) ];
+                }
+
+                /**
+                 * @brief Copy voxels from volume data in scanline order.
+                 * @param [in] src Source.
+                 * @param [in] nthread The number of threads.
+                 * @retval true Success.
+                 * @retval false Source is not readable.
+                 */
+                bool copyFrom ( const VolumeData<T>& src, const int nthread = 1 ) {
+                        if ( !src.isReadable() ) return false;
+                        this->init( const_cast<VolumeData<T>&>( src ).getInfo() );
+                        copy_fn<true> fn( *this, const_cast<VolumeData<T>&>( src ) );
+                        this->run( fn, nthread );
+                        return true;
+                }
+
+                /**
+                 * @brief Copy voxels to volume data in scanline order.
+                 * @param [out] dst Destination. It is initialized with the same information.
+                 * @param [in] nthread The number of threads.
+                 * @retval true Success.
+                 * @retval false This volume is not readable.
+                 */
+                bool copyTo ( VolumeData<T>& dst, const int nthread = 1 ) {
+                        if ( !this->isReadable() ) return false;
+                        dst.init( this->_info );
+                        copy_fn<false> fn( *this, dst );
+                        this->run( fn, nthread );
+                        return true;
+                }
+        private:
+                inline size_t get_offset ( const int x, const int y, const int z ) const {
+                        const size_t brick = ( static_cast<size_t>( z >> SHIFT ) * this->_nby + static_cast<size_t>( y >> SHIFT ) ) * this->_nbx + static_cast<size_t>( x >> SHIFT );
+                        const size_t local = ( static_cast<size_t>( ( ( z & MASK ) << SHIFT ) | ( y & MASK ) ) << SHIFT ) | static_cast<size_t>( x & MASK );
+                        return ( brick << ( 3 * SHIFT ) ) | local;
+                }
+
+                template <class Function>
+                void run ( Function& fn, const int nthread ) {
+                        const int sz = this->_info.getSize().z();
+                        const int n = std::max( 1, std::min( nthread, sz ) );
+                        std::vector<int> chunks( n );
+                        for ( int i = 0 ; i < n ; ++i ) chunks[i] = i;
+                        fn.setNumChunks( n );
+                        if ( n == 1 ) fn( 0 );
+                        else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                        return;
+                }
+
+                /**
+                 * @brief Copy rows between the two layouts. Each chunk handles a range of slices.
+                 */
+                template <bool toBrick>
+                class copy_fn
+                {
+                private:
+                        BrickedVolumeData<T, B>& _bricked;
+                        VolumeData<T>& _linear;
+                        int _numChunks;
+                public:
+                        copy_fn ( BrickedVolumeData<T, B>& bricked, VolumeData<T>& linear ) : _bricked( bricked ), _linear( linear ), _numChunks( 1 ) {
+                                return;
+                        }
+
+                        void setNumChunks ( const int n ) {
+                                this->_numChunks = n;
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                const Point3i size = this->_bricked.getInfo().getSize();
+                                const int zbegin = static_cast<int>( static_cast<long long>( size.z() ) * chunk / this->_numChunks );
+                                const int zend   = static_cast<int>( static_cast<long long>( size.z() ) * ( chunk + 1 ) / this->_numChunks );
+                                for ( int z = zbegin ; z < zend ; ++z ) {
+                                        for ( int y = 0 ; y < size.y() ; ++y ) {
+                                                T* row = this->_linear.getPointer( y, z );
+                                                for ( int x = 0 ; x < size.x() ; x += B ) {
+                                                        const size_t n = static_cast<size_t>( std::min( B, size.x() - x ) );
+                                                        T* brick = &this->_bricked.at( x, y, z );
+                                                        if ( toBrick ) std::memcpy( brick, row + x, sizeof( T ) * n );
+                                                        else std::memcpy( row + x, brick, sizeof( T ) * n );
+                                                }
+                                        }
+                                }
+                                return;
+                        }
+                };
+        };
+}
+#endif// MI_BRICKED_VOLUME_DATA_HPP
@@ -6,7 +6,11 @@
 #ifndef MI_CONNECT_COMPONENT_LABELLER_HPP
 #define MI_CONNECT_COMPONENT_LABELLER_HPP 1
 #include <queue>
+#include <vector>
+#include <algorithm>
 #include <iostream>
+#include <cstddef>
+#include <cstdlib>
 
 #include "ParallelFor.hpp"
 #include "math.hpp"
@@ -21,11 +25,21 @@ namespace mi
         private:
                 ConnectedComponentLabeller( const ConnectedComponentLabeller& that ) ;
                 void operator = ( const ConnectedComponentLabeller& that ) ;
+        public:
+                /**
+                 * @brief Labelling algorithm. Both give the same labels.
+                 */
+                enum Algorithm {
+                        QUEUE, ///< Flooding from seeds in raster order.
+                        SCAN   ///< Two-pass raster scan with union-find.
+                };
         private:
                 const static int UNLABELLED = -2; ///< Unlabelled label.
                 const static int BACKGROUND = 0;  ///< Background label.
                 /**
                  * @brief Queue-based labelling algorithm.
+                 *
+                 * The label data is given a halo of BACKGROUND, so that voxels are flooded through linear offsets without bounds checks.
                  */
                 class ccl_queue
                 {
@@ -58,6 +72,11 @@ namespace mi
                         ccl_queue( mi::VolumeData<char>& binaryData, mi::VolumeData<int>& labelData, const int neighbor = 26, const bool isFg = true , const int grainSize = 800000 ) :
                                 _labelData( labelData ) , _neighbor ( neighbor ) {
                                 mi::VolumeInfo& info = binaryData.getInfo();
+                                if ( this->_labelData.getHalo() < 1 || this->_labelData.getBorderValue() != BACKGROUND ) {
+                                        // all voxels are initialized below.
+                                        this->_labelData.deallocate();
+                                        this->_labelData.setHalo( 1, BACKGROUND ).allocate();
+                                }
                                 mi::parallel_for_each( info.begin(), info.end(), ccl_init( binaryData, this->_labelData, isFg ), grainSize );
                                 this->_labelId = 0;
                                 return;
@@ -65,22 +84,11 @@ namespace mi
 
                         int operator () ( const mi::Point3i& p ) {
                                 if( this->_labelData.get( p ) == UNLABELLED ) {
-                                        static mi::Neighbor nbr;
                                         this->_labelId += 1;
-                                        std::queue<mi::Point3i> q;
-                                        this->_labelData.set( p, this->_labelId );
-                                        q.push( p );
-                                        while ( !q.empty() ) {
-                                                const mi::Point3i p0 = q.front();
-                                                q.pop();
-                                                for( mi::Neighbor::iterator iter = nbr.begin() ; iter != nbr.end( this->_neighbor ) ; ++iter ) {
-                                                        const mi::Point3i p1 = p0 + ( *iter );
-                                                        if ( !this->_labelData.getInfo().isValid( p1 ) ) continue;
-                                                        if (  this->_labelData.get( p1 ) != UNLABELLED ) continue;
-                                                        this->_labelData.set( p1, this->_labelId );
-                                                        q.push( p1 );
-                                                }
-                                        }
+                                        int* seed = &this->_labelData.at( p );
+                                        if ( this->_neighbor == 6 ) this->flood< 6>( seed );
+                                        else if ( this->_neighbor == 18 ) this->flood<18>( seed );
+                                        else this->flood<26>( seed );
                                 }
                                 return _labelId;
 
@@ -88,14 +96,280 @@ namespace mi
                         int getNumLabel( void ) {
                                 return _labelId;
                         }
+                private:
+                        template <int N>
+                        void flood ( int* seed ) {
+                                const mi::NeighborOffset<N> nbr( this->_labelData.getStrideY(), this->_labelData.getStrideZ() );
+                                std::queue<int*> q;
+                                *seed = this->_labelId;
+                                q.push( seed );
+                                while ( !q.empty() ) {
+                                        int* p0 = q.front();
+                                        q.pop();
+                                        for ( int i = 0 ; i < N ; ++i ) {
+                                                int* p1 = p0 + nbr[i];
+                                                if ( *p1 != UNLABELLED ) continue;
+                                                *p1 = this->_labelId;
+                                                q.push( p1 );
+                                        }
+                                }
+                                return;
+                        }
+                };
+
+                /**
+                 * @brief Two-pass raster-scan labelling algorithm.
+                 *
+                 * Slabs of slices are scanned in parallel. A voxel takes a label of the visited neighbors ( the scan mask )
+                 * or a new provisional label, and labels met in the mask are united. For 26 neighbors, the mask of a voxel
+                 * whose left neighbor is foreground shares all voxels but the next column with the mask of the left
+                 * neighbor, so only the next column is examined ( decision tree ). Labels of neighboring slabs are united
+                 * at their boundaries, and the roots are numbered in raster order in the second pass, so the labels are the
+                 * same as those of ccl_queue. The label data is given a halo of BACKGROUND as well.
+                 */
+                class ccl_scan
+                {
+                private:
+                        /**
+                         * @brief Union-find of provisional labels. A root is the smallest label of its set.
+                         */
+                        static int find ( std::vector<int>& parent, int l ) {
+                                while ( parent[l] != l ) {
+                                        parent[l] = parent[ parent[l] ];
+                                        l = parent[l];
+                                }
+                                return l;
+                        }
+
+                        static void unite ( std::vector<int>& parent, const int l0, const int l1 ) {
+                                const int r0 = find( parent, l0 );
+                                const int r1 = find( parent, l1 );
+                                if ( r0 < r1 ) parent[r1] = r0;
+                                else if ( r1 < r0 ) parent[r0] = r1;
+                                return;
+                        }
+
+                        /**
+                         * @brief Linear offsets of the scan mask.
+                         */
+                        class scan_mask
+                        {
+                        public:
+                                std::vector<ptrdiff_t> all;    ///< Visited neighbors. Those in the same slice come first.
+                                size_t numInSlice;             ///< The number of neighbors in the same slice.
+                                std::vector<ptrdiff_t> column; ///< Neighbors in the next column ( 26 neighbors ). Those in the same slice come first.
+                                size_t numColumnInSlice;
+                        public:
+                                scan_mask ( const int neighbor, const ptrdiff_t sy, const ptrdiff_t sz ) {
+                                        const int n = ( neighbor == 6 ) ? 1 : ( neighbor == 18 ) ? 2 : 3; // max. non-zero offsets.
+                                        for ( int dz = -1 ; dz <= 0 ; ++dz ) {
+                                                for ( int dy = -1 ; dy <= 1 ; ++dy ) {
+                                                        for ( int dx = -1 ; dx <= 1 ; ++dx ) {
+                                                                if ( dz == 0 && ( dy > 0 || ( dy == 0 && dx >= 0 ) ) ) continue; // not visited.
+                                                                if ( std::abs( dx ) + std::abs( dy ) + std::abs( dz ) > n ) continue;
+                                                                const ptrdiff_t offset = dx + dy * sy + dz * sz;
+                                                                if ( dz == 0 ) this->all.insert( this->all.begin(), offset );
+                                                                else this->all.push_back( offset );
+                                                                if ( dx == 1 ) {
+                                                                        if ( dz == 0 ) this->column.insert( this->column.begin(), offset );
+                                                                        else this->column.push_back( offset );
+                                                                }
+                                                        }
+                                                }
+                                        }
+                                        this->numInSlice = ( neighbor == 6 ) ? 2 : 4;
+                                        this->numColumnInSlice = 1;
+                                        return;
+                                }
+                        };
+
+                        /**
+                         * @brief First pass on a slab. Labels are provisional ones of the slab.
+                         */
+                        class scan_fn
+                        {
+                        private:
+                                mi::VolumeData<char>& _binaryData;
+                                mi::VolumeData<int>& _labelData;
+                                const scan_mask& _mask;
+                                const bool _useColumn;
+                                std::vector<std::vector<int> >& _parents;
+                        public:
+                                scan_fn ( mi::VolumeData<char>& binaryData, mi::VolumeData<int>& labelData, const scan_mask& mask, const bool useColumn, std::vector<std::vector<int> >& parents ) :
+                                        _binaryData( binaryData ), _labelData( labelData ), _mask( mask ), _useColumn( useColumn ), _parents( parents ) {
+                                        return;
+                                }
+
+                                void operator () ( const int chunk ) const {
+                                        const mi::Point3i& size = this->_binaryData.getInfo().getSize();
+                                        const int n = static_cast<int>( this->_parents.size() );
+                                        const int zbegin = static_cast<int>( static_cast<long long>( size.z() ) * chunk / n );
+                                        const int zend   = static_cast<int>( static_cast<long long>( size.z() ) * ( chunk + 1 ) / n );
+                                        std::vector<int>& parent = this->_parents[chunk];
+                                        parent.assign( 1, int( BACKGROUND ) ); // label 0 is not used.
+                                        const scan_mask& mask = this->_mask;
+                                        for ( int z = zbegin ; z < zend ; ++z ) {
+                                                // the previous slice of another slab is united later.
+                                                const size_t numAll    = ( z > zbegin ) ? mask.all.size() : mask.numInSlice;
+                                                const size_t numColumn = ( z > zbegin ) ? mask.column.size() : mask.numColumnInSlice;
+                                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                                        const char* bin = this->_binaryData.getPointer( y, z );
+                                                        int* label = this->_labelData.getPointer( y, z );
+                                                        for ( int x = 0 ; x < size.x() ; ++x ) {
+                                                                int* p = label + x;
+                                                                if ( bin[x] == 0 ) {
+                                                                        *p = BACKGROUND;
+                                                                        continue;
+                                                                }
+                                                                int l = p[-1];
+                                                                if ( this->_useColumn && l != BACKGROUND ) {
+                                                                        for ( size_t i = 0 ; i < numColumn ; ++i ) {
+                                                                                const int l1 = p[ mask.column[i] ];
+                                                                                if ( l1 != BACKGROUND && l1 != l ) unite( parent, l, l1 );
+                                                                        }
+                                                                        *p = l;
+                                                                        continue;
+                                                                }
+                                                                l = BACKGROUND;
+                                                                for ( size_t i = 0 ; i < numAll ; ++i ) {
+                                                                        const int l1 = p[ mask.all[i] ];
+                                                                        if ( l1 == BACKGROUND ) continue;
+                                                                        if ( l == BACKGROUND ) l = l1;
+                                                                        else if ( l1 != l ) unite( parent, l, l1 );
+                                                                }
+                                                                if ( l == BACKGROUND ) {
+                                                                        l = static_cast<int>( parent.size() );
+                                                                        parent.push_back( l );
+                                                                }
+                                                                *p = l;
+                                                        }
+                                                }
+                                        }
+                                        return;
+                                }
+                        };
+
+                        /**
+                         * @brief Second pass on a slab. Provisional labels are replaced with final ones.
+                         */
+                        class relabel_fn
+                        {
+                        private:
+                                mi::VolumeData<int>& _labelData;
+                                const std::vector<int>& _final;
+                                const std::vector<int>& _offsets;
+                        public:
+                                relabel_fn ( mi::VolumeData<int>& labelData, const std::vector<int>& final, const std::vector<int>& offsets ) :
+                                        _labelData( labelData ), _final( final ), _offsets( offsets ) {
+                                        return;
+                                }
+
+                                void operator () ( const int chunk ) const {
+                                        const mi::Point3i& size = this->_labelData.getInfo().getSize();
+                                        const int n = static_cast<int>( this->_offsets.size() );
+                                        const int zbegin = static_cast<int>( static_cast<long long>( size.z() ) * chunk / n );
+                                        const int zend   = static_cast<int>( static_cast<long long>( size.z() ) * ( chunk + 1 ) / n );
+                                        const int offset = this->_offsets[chunk];
+                                        for ( int z = zbegin ; z < zend ; ++z ) {
+                                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                                        int* label = this->_labelData.getPointer( y, z );
+                                                        for ( int x = 0 ; x < size.x() ; ++x ) {
+                                                                if ( label[x] != BACKGROUND ) label[x] = this->_final[ label[x] + offset ];
+                                                        }
+                                                }
+                                        }
+                                        return;
+                                }
+                        };
+                public:
+                        /**
+                         * @brief Label foreground voxels.
+                         * @param [in] binaryData Binary data.
+                         * @param [out] labelData Labels.
+                         * @param [in] neighbor 6, 18 or 26.
+                         * @param [in] nthread The number of threads.
+                         * @return The number of labels.
+                         */
+                        static int label ( mi::VolumeData<char>& binaryData, mi::VolumeData<int>& labelData, const int neighbor, const int nthread ) {
+                                if ( labelData.getHalo() < 1 || labelData.getBorderValue() != BACKGROUND ) {
+                                        // all voxels are written below.
+                                        labelData.deallocate();
+                                        labelData.setHalo( 1, BACKGROUND ).allocate();
+                                }
+                                const mi::Point3i& size = binaryData.getInfo().getSize();
+                                const int n = std::max( 1, std::min( nthread, size.z() ) );
+                                std::vector<int> chunks( n );
+                                for ( int i = 0 ; i < n ; ++i ) chunks[i] = i;
+                                const scan_mask mask( neighbor, labelData.getStrideY(), labelData.getStrideZ() );
+                                std::vector<std::vector<int> > parents( n );
+                                scan_fn sfn( binaryData, labelData, mask, neighbor != 6 && neighbor != 18, parents );
+                                if ( n == 1 ) sfn( 0 );
+                                else mi::parallel_for_each( chunks.begin(), chunks.end(), sfn, 1 );
+
+                                // provisional labels of all slabs.
+                                std::vector<int> offsets( n, 0 );
+                                for ( int i = 1 ; i < n ; ++i ) offsets[i] = offsets[i - 1] + static_cast<int>( parents[i - 1].size() ) - 1;
+                                std::vector<int> parent( 1, int( BACKGROUND ) );
+                                for ( int i = 0 ; i < n ; ++i ) {
+                                        for ( size_t l = 1 ; l < parents[i].size() ; ++l ) parent.push_back( parents[i][l] + offsets[i] );
+                                        std::vector<int>().swap( parents[i] );
+                                }
+                                // unite labels across slab boundaries.
+                                for ( int i = 1 ; i < n ; ++i ) {
+                                        const int z = static_cast<int>( static_cast<long long>( size.z() ) * i / n );
+                                        for ( int y = 0 ; y < size.y() ; ++y ) {
+                                                const int* label = labelData.getPointer( y, z );
+                                                for ( int x = 0 ; x < size.x() ; ++x ) {
+                                                        if ( label[x] == BACKGROUND ) continue;
+                                                        for ( size_t j = mask.numInSlice ; j < mask.all.size() ; ++j ) {
+                                                                const int l1 = label[ x + mask.all[j] ];
+                                                                if ( l1 != BACKGROUND ) unite( parent, label[x] + offsets[i], l1 + offsets[i - 1] );
+                                                        }
+                                                }
+                                        }
+                                }
+                                // roots are numbered in raster order.
+                                int numLabels = 0;
+                                std::vector<int> final( parent.size(), int( BACKGROUND ) );
+                                for ( size_t l = 1 ; l < parent.size() ; ++l ) {
+                                        const int r = find( parent, static_cast<int>( l ) );
+                                        final[l] = ( r == static_cast<int>( l ) ) ? ++numLabels : final[r];
+                                }
+                                relabel_fn rfn( labelData, final, offsets );
+                                if ( n == 1 ) rfn( 0 );
+                                else mi::parallel_for_each( chunks.begin(), chunks.end(), rfn, 1 );
+                                return numLabels;
+                        }
                 };
         private:
                 mi::VolumeData<char> &_data;
+                Algorithm _algorithm;
+                int _nthread;
         public:
 
-                explicit ConnectedComponentLabeller ( mi::VolumeData<char>& data ) : _data( data ) {
+                explicit ConnectedComponentLabeller ( mi::VolumeData<char>& data ) : _data( data ), _algorithm( SCAN ), _nthread( 1 ) {
                         return;
                 }
+
+                /**
+                 * @brief Set the labelling algorithm.
+                 * @param [in] algorithm Algorithm ( SCAN by default ).
+                 * @return Instance itself.
+                 */
+                ConnectedComponentLabeller& setAlgorithm ( const Algorithm algorithm ) {
+                        this->_algorithm = algorithm;
+                        return *this;
+                }
+
+                /**
+                 * @brief Set the number of threads of SCAN.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                ConnectedComponentLabeller& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
                 ~ConnectedComponentLabeller ( void ) {
                         return;
                 }
@@ -119,7 +393,9 @@ namespace mi
                  */
                 int label ( mi::VolumeData<int>& labelData, const int nbr = 26, const bool isSorted = false ) {
                         mi::VolumeInfo& info = this->_data.getInfo();
-                        const int numLabels = std::for_each( info.begin(), info.end(), ccl_queue( this->_data, labelData, nbr, true ) ).getNumLabel();
+                        const int numLabels = ( this->_algorithm == QUEUE ) ?
+                                std::for_each( info.begin(), info.end(), ccl_queue( this->_data, labelData, nbr, true ) ).getNumLabel() :
+                                ccl_scan::label( this->_data, labelData, nbr, this->_nthread );
 
                         if( isSorted ) {
                                 std::vector<std::pair<int, int> > nextLabel;
@@ -6,28 +6,171 @@
 #define MI_CONNECTED_COMPONENT_LABELLER_RLE_HPP 1
 #include <mi/VolumeData.hpp>
 #include <mi/RunLengthEncoder.hpp>
+#include <mi/RunLengthVolume.hpp>
+#include <mi/ParallelFor.hpp>
 #include <cstdlib>
+#include <algorithm>
 namespace mi
 {
         class ConnectedComponentLabellerRle
         {
+        public:
+                /**
+                 * @brief Statistics of a component accumulated from its runs. Coordinates are voxel indices.
+                 */
+                class Component
+                {
+                private:
+                        size_t _count;
+                        Point3i _min;
+                        Point3i _max;
+                        Point3d _sum;
+                        bool _isBorder;
+                public:
+                        Component ( void ) : _count( 0 ), _min( 0, 0, 0 ), _max( -1, -1, -1 ), _sum( 0, 0, 0 ), _isBorder( false ) {
+                                return;
+                        }
+
+                        /**
+                         * @brief Add a run.
+                         * @param [in] code Run.
+                         * @param [in] sy Row of the run ( y ).
+                         * @param [in] sz Row of the run ( z ).
+                         * @param [in] size Size of the volume.
+                         */
+                        void add ( const RunLengthCodeBinary& code, const int sy, const int sz, const Point3i& size ) {
+                                int sx, l;
+                                code.get( sx, l );
+                                const Point3i bmin( sx, sy, sz );
+                                const Point3i bmax( sx + l - 1, sy, sz );
+                                if ( this->_count == 0 ) {
+                                        this->_min = bmin;
+                                        this->_max = bmax;
+                                } else {
+                                        this->_min = this->_min.cwiseMin( bmin );
+                                        this->_max = this->_max.cwiseMax( bmax );
+                                }
+                                this->_count += static_cast<size_t>( l );
+                                this->_sum += Point3d( l * ( sx + 0.5 * ( l - 1 ) ), l * 1.0 * sy, l * 1.0 * sz );
+                                if ( sx == 0 || sx + l == size.x() || sy == 0 || sy == size.y() - 1 || sz == 0 || sz == size.z() - 1 ) this->_isBorder = true;
+                                return;
+                        }
+
+                        /**
+                         * @brief Get the number of voxels.
+                         */
+                        size_t getCount ( void ) const {
+                                return this->_count;
+                        }
+
+                        /**
+                         * @brief Get the minimum corner of the bounding box.
+                         */
+                        Point3i getMin ( void ) const {
+                                return this->_min;
+                        }
+
+                        /**
+                         * @brief Get the maximum corner of the bounding box ( inclusive ).
+                         */
+                        Point3i getMax ( void ) const {
+                                return this->_max;
+                        }
+
+                        /**
+                         * @brief Get the centroid.
+                         */
+                        Point3d getCentroid ( void ) const {
+                                if ( this->_count == 0 ) return Point3d( 0, 0, 0 );
+                                return this->_sum * ( 1.0 / static_cast<double>( this->_count ) );
+                        }
+
+                        /**
+                         * @brief The component touches the border of the volume.
+                         */
+                        bool isBorder ( void ) const {
+                                return this->_isBorder;
+                        }
+                };
         private:
-                VolumeData<char>& _data;
+                VolumeData<char>* _data; ///< Binary data ( NULL : runs are given by encode() ).
+                Point3i _size;
                 std::vector<RunLengthCodeBinary> _codes;
                 std::vector<int> _labels;
                 std::vector<int> _idx;
+                std::vector<Component> _components; ///< Statistics of labels ( 0 : background, empty ).
                 int _num_label;
+                int _nthread;
         public:
-                ConnectedComponentLabellerRle( VolumeData<char>& data ) :_data( data ) {
+                ConnectedComponentLabellerRle( VolumeData<char>& data ) :_data( &data ), _size( data.getInfo().getSize() ), _nthread( 1 ) {
+                        return;
+                }
+
+                /**
+                 * @brief Constructor for runs given by encode().
+                 * @param [in] size Size of the volume.
+                 */
+                explicit ConnectedComponentLabellerRle( const Point3i& size ) : _data( NULL ), _size( size ), _nthread( 1 ) {
+                        return;
+                }
+
+                /**
+                 * @brief Set the number of threads for encoding and decoding.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                ConnectedComponentLabellerRle& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
+
+                /**
+                 * @brief Encode voxels at or above an isovalue in slices [zbegin, zend) as foreground runs.
+                 *
+                 * Slices must be given in z order and cover the volume before label() is called. Binarization is
+                 * fused into encoding, so labelling a thresholded volume needs no binary volume.
+                 * @param [in] data Volume data. Its size must be the same as that of the labeller.
+                 * @param [in] isovalue Isovalue.
+                 * @param [in] zbegin First slice.
+                 * @param [in] zend End slice ( exclusive ).
+                 */
+                template <typename S>
+                void encode ( const VolumeData<S>& data, const S isovalue, const int zbegin, const int zend ) {
+                        RunLengthEncoder<S> encoder( data );
+                        encoder.setNumThread( this->_nthread ).encode( this->_codes, this->_idx, isovalue, zbegin, zend );
+                        return;
+                }
+
+                /**
+                 * @brief Take runs of a run-length volume as foreground runs. Its size must be the same as that of the labeller.
+                 * @param [in] runs Run-length volume.
+                 */
+                void encode ( const RunLengthVolume& runs ) {
+                        const Point3i& size = this->_size;
+                        this->_codes.reserve( this->_codes.size() + runs.getNumRuns() );
+                        for( int z = 0 ; z < size.z() ; ++z ) {
+                                for( int y = 0 ; y < size.y() ; ++y ) {
+                                        this->_idx.push_back( static_cast<int>( this->_codes.size() ) );
+                                        size_t n;
+                                        const RunLengthVolume::Run* r = runs.getRow( y, z, n );
+                                        for( size_t i = 0 ; i < n ; ++i ) {
+                                                this->_codes.push_back( RunLengthCodeBinary( r[i].begin, r[i].end - r[i].begin ) );
+                                        }
+                                }
+                        }
                         return;
                 }
 
                 // return the num labels.
                 int label ( const bool isSorted = false , const bool joinXyz = true ) {
-                        RunLengthEncoder<char> encoder( this->_data );
-                        const Point3i& size = this->_data.getInfo().getSize();
-
-                        this->_num_label = encoder.encode( this->_codes, this->_idx );
+                        const Point3i& size = this->_size;
+                        if ( this->_data != NULL ) {
+                                RunLengthEncoder<char> encoder( *( this->_data ) );
+                                this->_num_label = encoder.setNumThread( this->_nthread ).encode( this->_codes, this->_idx );
+                        } else {
+                                this->_idx.push_back( static_cast<int>( this->_codes.size() ) );
+                                this->_num_label = static_cast<int>( this->_codes.size() );
+                        }
                         // join in xy-plane
                         for( int z = 0 ; z < size.z() ; ++z ) {
                                 for( int y = 0 ; y < size.y() - 1 ; ++y ) {
@@ -41,75 +184,106 @@ namespace mi
                                 }
                         }
 
+                        // statistics are accumulated while runs take the labels of their roots. Runs are visited row by row to know their y and z.
                         this->_labels.assign( this->_codes.size() , 0 );
-                        std::vector<int> voxelCount;
-                        voxelCount.push_back( 0 );
+                        std::vector<Component>& components = this->_components;
+                        components.assign( 1, Component() );
                         int count = 1;
-                        for( int i = 0 ; i < this->_codes.size() ; ++i ) {
-                                int parent = this->get_parent( i );
-                                if ( parent == i ) {
-                                        this->_labels[i] = count;
-                                        voxelCount.push_back ( this->_codes[i].getLength() );
-                                        ++count;
-                                } else {
-                                        const int newLabel = this->_labels[ parent ];
-                                        this->_labels[i] = newLabel;
-                                        voxelCount [ newLabel ] += this->_codes[i].getLength();
+                        for( int z = 0 ; z < size.z() ; ++z ) {
+                                for( int y = 0 ; y < size.y() ; ++y ) {
+                                        const int row = y + z * size.y();
+                                        for( int i = this->_idx[row] ; i < this->_idx[row + 1] ; ++i ) {
+                                                int parent = this->get_parent( i );
+                                                if ( parent == i ) {
+                                                        this->_labels[i] = count;
+                                                        components.push_back( Component() );
+                                                        ++count;
+                                                } else {
+                                                        this->_labels[i] = this->_labels[ parent ];
+                                                }
+                                                components[ this->_labels[i] ].add( this->_codes[i], y, z, size );
+                                        }
                                 }
                         }
 
-                        // Sort labels by descend order
+                        // Sort labels by descend order of the number of voxels. Labels of the same size keep their order.
                         if ( isSorted ) {
-                                std::vector<std::pair<int, int> > pairs;
-                                for( int i = 0 ; i < voxelCount.size() ; ++i ) {
-                                        pairs.push_back( std::make_pair( - voxelCount[i], i ) );
-                                }
-                                std::sort( pairs.begin() + 1, pairs.end() );
-
-                                for( int i = 0 ; i < voxelCount.size() ; ++i ) {
-                                        pairs[i].first = pairs[i].second;
-                                        pairs[i].second = i;
+                                std::vector<std::pair<size_t, int> > pairs;
+                                for( int i = 0 ; i < components.size() ; ++i ) {
+                                        pairs.push_back( std::make_pair( components[i].getCount(), i ) );
                                 }
-                                std::sort( pairs.begin() + 1, pairs.end() );
+                                std::stable_sort( pairs.begin() + 1, pairs.end(), ConnectedComponentLabellerRle::is_larger );
 
-                                for( int i = 0 ; i < this->_codes.size() ; ++i ) {
-                                        this->_labels[i] = pairs[ this->_labels[i] ].second;
+                                std::vector<int> order( components.size() ); // new label of each label.
+                                std::vector<Component> sorted( components.size() );
+                                for( int i = 0 ; i < components.size() ; ++i ) {
+                                        order[ pairs[i].second ] = i;
+                                        sorted[i] = components[ pairs[i].second ];
                                 }
-
-                                voxelCount.clear();
-                                voxelCount.assign( pairs.size(), 0 ) ;
-
                                 for( int i = 0 ; i < this->_codes.size() ; ++i ) {
-                                        voxelCount [ this->_labels[i] ] += this->_codes[i].getLength();
+                                        this->_labels[i] = order[ this->_labels[i] ];
                                 }
+                                components.swap( sorted );
                         }
                         return count - 1 ;
                 }
 
+                /**
+                 * @brief Get the number of components of the last label().
+                 */
+                int getNumComponents ( void ) const {
+                        return static_cast<int>( this->_components.size() ) - 1;
+                }
+
+                /**
+                 * @brief Get statistics of a component.
+                 * @param [in] n Label ( 1 ... getNumComponents() ).
+                 * @return Statistics.
+                 */
+                const Component& getComponent ( const int n ) const {
+                        return this->_components[n];
+                }
+
 
+                /**
+                 * @brief Write labels of runs. Background voxels are not changed.
+                 */
                 template <typename T>
                 bool getData( VolumeData<T>& labelData ) {
-                        for( int i = 0 ; i < this->_codes.size() ; ++i ) {
-                                short int sx, sy, sz, l;
-                                this->_codes[i].get( sx,sy,sz, l ) ;
-                                for( int j = 0 ; j < l ; ++j ) {
-                                        labelData.set( sx+j , sy, sz, this->_labels[i] );
-                                }
-                        }
+                        this->decode( labelData, decode_fn<T>::LABEL, 0 );
+                        return true;
+                }
+
+                /**
+                 * @brief Write values[label] to voxels of runs. Background voxels are not changed.
+                 * @param [out] data Volume data.
+                 * @param [in] values Values of labels ( 0 ... getNumComponents() ).
+                 */
+                template <typename T>
+                bool getData( VolumeData<T>& data, const std::vector<T>& values ) {
+                        this->decode( data, decode_fn<T>::LOOK_UP, 0, &values );
                         return true;
                 }
 
 
+                /**
+                 * @brief Set voxels of the n-th component to 1. Other voxels are not changed.
+                 */
                 template <typename T>
                 bool getNthComponent( VolumeData<T>& labelData , const int n = 1 ) {
-                        for( int i = 0 ; i < this->_codes.size() ; ++i ) {
-                                if ( n != this->_labels[i] ) continue;
-                                short int sx, sy, sz, l;
-                                this->_codes[i].get( sx,sy,sz, l ) ;
-                                for( int j = 0 ; j < l ; ++j ) {
-                                        labelData.set( sx+j , sy, sz, 1 );
-                                }
-                        }
+                        this->decode( labelData, decode_fn<T>::NTH, n );
+                        return true;
+                }
+
+                /**
+                 * @brief Get runs of the n-th component without decoding.
+                 * @param [out] runs Run-length volume.
+                 * @param [in] info Volume information of the runs.
+                 * @param [in] n Label.
+                 */
+                bool getNthComponent( RunLengthVolume& runs, const VolumeInfo& info, const int n = 1 ) {
+                        nth_row fn( *this, n );
+                        runs.build( info, fn, this->_nthread );
                         return true;
                 }
 
@@ -119,15 +293,7 @@ namespace mi
                  */
                 template <typename T>
                 bool getNotNthComponents( VolumeData<T>& labelData , const int n = 1 ) {
-                        labelData.fill( 1 );
-                        for( int i = 0 ; i < this->_codes.size() ; ++i ) {
-                                if ( n != this->_labels[i] ) continue;
-                                short int sx, sy, sz, l;
-                                this->_codes[i].get( sx,sy,sz, l ) ;
-                                for( int j = 0 ; j < l ; ++j ) {
-                                        labelData.set( sx+j , sy, sz, 0 );
-                                }
-                        }
+                        this->decode( labelData, decode_fn<T>::NOT_NTH, n );
                         return true;
                 }
 
@@ -138,7 +304,7 @@ namespace mi
                                 if ( fn( this->_label[i] ) == false) continue;
                 		const T value =  mp(this->_label[i]) ;
 
-                		short int sx, sy, sz, l;
+                		int sx, sy, sz, l;
                                 this->_codes[i].get( sx,sy,sz, l ) ;
                 		if ( label != this->_labels[i] ) continue;
                                 for( int j = 0 ; j < l ; ++j ) {
@@ -150,8 +316,99 @@ namespace mi
                 */
 
         private:
+                /**
+                 * @brief Decode runs of a range of slices row by row.
+                 */
+                template <typename T>
+                class decode_fn
+                {
+                public:
+                        enum Mode {
+                                LABEL,   ///< runs : label.
+                                NTH,     ///< runs of label n : 1.
+                                NOT_NTH, ///< runs of label n : 0, others : 1.
+                                LOOK_UP  ///< runs : values[label].
+                        };
+                private:
+                        const ConnectedComponentLabellerRle& _labeller;
+                        VolumeData<T>& _data;
+                        const Mode _mode;
+                        const int _n;
+                        const std::vector<T>* _values;
+                        const int _numChunks;
+                public:
+                        decode_fn ( const ConnectedComponentLabellerRle& labeller, VolumeData<T>& data, const Mode mode, const int n, const std::vector<T>* values, const int numChunks ) :
+                                _labeller( labeller ), _data( data ), _mode( mode ), _n( n ), _values( values ), _numChunks( numChunks ) {
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                const Point3i& size = this->_labeller._size;
+                                const int zbegin = static_cast<int>( static_cast<long long>( size.z() ) * chunk / this->_numChunks );
+                                const int zend   = static_cast<int>( static_cast<long long>( size.z() ) * ( chunk + 1 ) / this->_numChunks );
+                                for( int z = zbegin ; z < zend ; ++z ) {
+                                        for( int y = 0 ; y < size.y() ; ++y ) {
+                                                T* row = this->_data.getPointer( y, z );
+                                                if ( this->_mode == NOT_NTH ) std::fill( row, row + size.x(), T( 1 ) );
+                                                const int id = y + z * size.y();
+                                                for( int i = this->_labeller._idx[id] ; i < this->_labeller._idx[id + 1] ; ++i ) {
+                                                        const int label = this->_labeller._labels[i];
+                                                        if ( ( this->_mode == NTH || this->_mode == NOT_NTH ) && label != this->_n ) continue;
+                                                        int sx, l;
+                                                        this->_labeller._codes[i].get( sx, l );
+                                                        T value;
+                                                        if ( this->_mode == LABEL ) value = static_cast<T>( label );
+                                                        else if ( this->_mode == LOOK_UP ) value = ( *this->_values )[label];
+                                                        else value = this->_mode == NTH ? T( 1 ) : T( 0 );
+                                                        std::fill( row + sx, row + sx + l, value );
+                                                }
+                                        }
+                                }
+                                return;
+                        }
+                };
+
+                template <typename T>
+                void decode ( VolumeData<T>& labelData, const typename decode_fn<T>::Mode mode, const int n, const std::vector<T>* values = NULL ) const {
+                        const int n0 = std::max( 1, std::min( this->_nthread, this->_size.z() ) );
+                        std::vector<int> chunks( n0 );
+                        for ( int i = 0 ; i < n0 ; ++i ) chunks[i] = i;
+                        decode_fn<T> fn( *this, labelData, mode, n, values, n0 );
+                        if ( n0 == 1 ) fn( 0 );
+                        else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                        return;
+                }
+
+                /**
+                 * @brief Runs of a label in a row. Codes of a row are sorted and maximal.
+                 */
+                class nth_row
+                {
+                private:
+                        const ConnectedComponentLabellerRle& _labeller;
+                        const int _n;
+                public:
+                        nth_row ( const ConnectedComponentLabellerRle& labeller, const int n ) : _labeller( labeller ), _n( n ) {
+                                return;
+                        }
+
+                        void operator () ( const int y, const int z, std::vector<RunLengthVolume::Run>& runs, std::vector<RunLengthVolume::Run>& /*work*/ ) const {
+                                const int row = y + z * this->_labeller._size.y();
+                                for( int i = this->_labeller._idx[row] ; i < this->_labeller._idx[row + 1] ; ++i ) {
+                                        if ( this->_labeller._labels[i] != this->_n ) continue;
+                                        int sx, l;
+                                        this->_labeller._codes[i].get( sx, l );
+                                        RunLengthVolume::Run run;
+                                        run.begin = sx;
+                                        run.end = sx + l;
+                                        runs.push_back( run );
+                                }
+                                return;
+                        }
+                };
+
                 void join_xyz( const int z ) {
-                        const Point3i& size = this->_data.getInfo().getSize();
+                        const Point3i& size = this->_size;
                         const int id0 =  z * size.y() ;
                         const int id1 =  ( z+1 ) * size.y() ;
                         std::vector<int>& idx = this->_idx;
@@ -171,7 +428,7 @@ namespace mi
 
 
                 void join_xy( const int z , const int y ) {
-                        const Point3i& size = this->_data.getInfo().getSize();
+                        const Point3i& size = this->_size;
                         const int id0 =  z * size.y() + y ;
                         std::vector<int>& idx = this->_idx;
                         for( int i = idx[ id0 ] ; i < idx[id0+1] ; ++i ) {
@@ -181,10 +438,14 @@ namespace mi
                         }
                 }
 
+                static bool is_larger ( const std::pair<size_t, int>& a, const std::pair<size_t, int>& b ) {
+                        return a.first > b.first;
+                }
+
                 int get_parent( int id ) {
-                        const int parent = this->_codes[id].getParent();
-                        if ( parent == -1 ) return id;
-                        else return this->get_parent( parent );
+                        // iterative : chains of runs are long in large volumes.
+                        for( int parent = this->_codes[id].getParent() ; parent != -1 ; parent = this->_codes[id].getParent() ) id = parent;
+                        return id;
                 }
 
                 void set_parent ( int p, int c ) {
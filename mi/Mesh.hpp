@@ -6,22 +6,41 @@
 #define MI_MESH_HPP 1
 #include <iostream>
 #include <vector>
+#include <array>
 #include <utility>
 #include <deque>
 #include <map>
 #include <cmath>
+#include <cstddef>
 #include "math.hpp"
 
 namespace mi
 {
+#ifdef MI_MESH_DOUBLE_PRECISION
+        typedef double MeshReal; ///< Scalar type of vertex coordinates.
+#else
+        typedef float  MeshReal; ///< Scalar type of vertex coordinates.
+#endif
+        /**
+         * @class Mesh Mesh.hpp <mi/Mesh.hpp>
+         * @brief Triangle mesh.
+         *
+         * Vertex coordinates are stored as separate x, y and z arrays of MeshReal
+         * (float by default, double when MI_MESH_DOUBLE_PRECISION is defined).
+         * Triangles are stored as a flat index array.
+         */
         class Mesh
         {
+        public:
+                typedef std::array<int, 3> Face; ///< Vertex indices of a triangle.
         private:
                 Mesh( const Mesh& that );
                 void operator = ( const Mesh& that );
         private:
                 std::string _name;
-                std::vector<mi::Vector3d> _vertex; /// vertex position
+                std::vector<MeshReal> _x; /// vertex position (x)
+                std::vector<MeshReal> _y; /// vertex position (y)
+                std::vector<MeshReal> _z; /// vertex position (z)
                 std::vector<int> _index; /// triangles
         public:
                 explicit Mesh ( void ) {
@@ -29,30 +48,142 @@ namespace mi
                         return;
                 }
 
+                /**
+                 * @brief Move constructor. The source becomes empty.
+                 * @param [in,out] that Instance.
+                 */
+                Mesh ( Mesh&& that ) {
+                        this->swap( that );
+                        return;
+                }
+
+                /**
+                 * @brief Move assignment. The source becomes empty.
+                 * @param [in,out] that Instance.
+                 * @return Instance itself.
+                 */
+                Mesh& operator = ( Mesh&& that ) {
+                        if ( this != &that ) {
+                                this->init();
+                                this->_name.clear();
+                                this->swap( that );
+                        }
+                        return *this;
+                }
+
                 virtual ~Mesh ( void ) {
                         return;
                 }
 
+                /**
+                 * @brief Exchange the contents with another mesh without copying.
+                 * @param [in,out] that Instance.
+                 */
+                void swap ( Mesh& that ) {
+                        this->_name.swap( that._name );
+                        this->_x.swap( that._x );
+                        this->_y.swap( that._y );
+                        this->_z.swap( that._z );
+                        this->_index.swap( that._index );
+                        return;
+                }
+
                 void clone ( const Mesh &mesh ) {
                         this->init();
-                        for( int i = 0 ; i < mesh.getNumVertices() ; ++i ) {
-                                this->addPoint( mesh.getPosition( i ) );
-                        }
-                        for( int i = 0 ; i < mesh.getNumFaces() ; ++i ) {
-                                std::vector<int> index = mesh.getFaceIndices( i );
-                                this->addFace( index );
-                        }
+                        this->_name  = mesh._name;
+                        this->_x     = mesh._x;
+                        this->_y     = mesh._y;
+                        this->_z     = mesh._z;
+                        this->_index = mesh._index;
+                }
+
+                /**
+                 * @brief Reserve memory.
+                 * @param [in] numVertices The number of vertices.
+                 * @param [in] numFaces The number of faces.
+                 */
+                void reserve ( const size_t numVertices, const size_t numFaces ) {
+                        this->_x.reserve( numVertices );
+                        this->_y.reserve( numVertices );
+                        this->_z.reserve( numVertices );
+                        this->_index.reserve( numFaces * 3 );
+                        return;
+                }
+
+                /**
+                 * @brief Resize vertex and index arrays. New elements are zero.
+                 * @param [in] numVertices The number of vertices.
+                 * @param [in] numFaces The number of faces.
+                 */
+                void resize ( const size_t numVertices, const size_t numFaces ) {
+                        this->_x.resize( numVertices );
+                        this->_y.resize( numVertices );
+                        this->_z.resize( numVertices );
+                        this->_index.resize( numFaces * 3 );
+                        return;
                 }
 
                 int addPoint( const mi::Vector3d& p ) {
-                        this->_vertex.push_back( p );
-                        return static_cast<int>( this->_vertex.size() - 1 );
+                        return this->addPoint( p.x(), p.y(), p.z() );
+                }
+
+                inline int addPoint( const double x, const double y, const double z ) {
+                        this->_x.push_back( static_cast<MeshReal>( x ) );
+                        this->_y.push_back( static_cast<MeshReal>( y ) );
+                        this->_z.push_back( static_cast<MeshReal>( z ) );
+                        return static_cast<int>( this->_x.size() - 1 );
+                }
+
+                /**
+                 * @brief Append vertices.
+                 * @param [in] xyz Interleaved coordinates (x0, y0, z0, x1, y1, z1, ...).
+                 * @param [in] n The number of vertices.
+                 * @return ID of the first appended vertex.
+                 */
+                template <typename S>
+                int addPoints( const S* xyz, const size_t n ) {
+                        const size_t offset = this->_x.size();
+                        this->_x.resize( offset + n );
+                        this->_y.resize( offset + n );
+                        this->_z.resize( offset + n );
+                        for ( size_t i = 0 ; i < n ; ++i ) {
+                                this->_x[offset + i] = static_cast<MeshReal>( xyz[ 3 * i + 0 ] );
+                                this->_y[offset + i] = static_cast<MeshReal>( xyz[ 3 * i + 1 ] );
+                                this->_z[offset + i] = static_cast<MeshReal>( xyz[ 3 * i + 2 ] );
+                        }
+                        return static_cast<int>( offset );
+                }
+
+                inline int addFace ( const int v0, const int v1, const int v2 ) {
+                        this->_index.push_back( v0 );
+                        this->_index.push_back( v1 );
+                        this->_index.push_back( v2 );
+                        return static_cast<int>( this->_index.size() / 3 ) ; // ID
+                }
+
+                inline int addFace ( const Face& fidx ) {
+                        return this->addFace( fidx[0], fidx[1], fidx[2] );
                 }
 
                 int addFace ( const std::vector<int>& fidx ) {
                         if ( fidx.size() != 3 ) return -1;
-                        this->_index.insert ( this->_index.end(), fidx.begin(), fidx.end() );
-                        return static_cast<int>( this->_index.size() / 3 ) ; // ID
+                        return this->addFace( fidx[0], fidx[1], fidx[2] );
+                }
+
+                /**
+                 * @brief Append triangles.
+                 * @param [in] idx Vertex indices (3 per triangle).
+                 * @param [in] n The number of triangles.
+                 * @param [in] offset Value added to each index.
+                 * @return The number of faces.
+                 */
+                int addFaces ( const int* idx, const size_t n, const int offset = 0 ) {
+                        const size_t first = this->_index.size();
+                        this->_index.resize( first + 3 * n );
+                        for ( size_t i = 0 ; i < 3 * n ; ++i ) {
+                                this->_index[ first + i ] = idx[i] + offset;
+                        }
+                        return this->getNumFaces();
                 }
 
                 void addName ( const std::string name = std::string( "mesh" ) ) {
@@ -68,26 +199,55 @@ namespace mi
                         return ( 0 <= vertexid && vertexid < this->getNumVertices() );
                 }
 
-                inline std::vector<int> getFaceIndices ( const int faceid ) const {
-                        std::vector<int> idx ( 3, -1 );
+                inline Face getFaceIndices ( const int faceid ) const {
+                        Face idx = {{ -1, -1, -1 }};
                         if ( this->isValidFaceId( faceid ) ) {
-                                for ( int i = 0 ; i < 3 ; i++ ) {
-                                        idx[i] = this->_index.at ( faceid * 3 + i );
-                                }
+                                const int* p = &this->_index[ faceid * 3 ];
+                                idx[0] = p[0];
+                                idx[1] = p[1];
+                                idx[2] = p[2];
                         }
                         return idx;
                 }
 
                 inline mi::Vector3d getPosition ( const int vertexid ) const {
-                        if ( this->isValidVertexId( vertexid ) ) return this->_vertex.at ( vertexid );
+                        if ( this->isValidVertexId( vertexid ) ) {
+                                return mi::Vector3d( this->_x[vertexid], this->_y[vertexid], this->_z[vertexid] );
+                        }
                         return mi::Vector3d();
                 }
 
+                /**
+                 * @brief Get raw coordinate arrays.
+                 * @param [in] axis 0:x, 1:y, 2:z.
+                 * @return Pointer to the first element ( NULL if the mesh is empty ).
+                 */
+                inline const MeshReal* getCoordinates ( const int axis ) const {
+                        const std::vector<MeshReal>& v = ( axis == 0 ) ? this->_x : ( ( axis == 1 ) ? this->_y : this->_z );
+                        return v.empty() ? NULL : &v[0];
+                }
+
+                inline MeshReal* getCoordinates ( const int axis ) {
+                        std::vector<MeshReal>& v = ( axis == 0 ) ? this->_x : ( ( axis == 1 ) ? this->_y : this->_z );
+                        return v.empty() ? NULL : &v[0];
+                }
+
+                /**
+                 * @brief Get raw index array ( 3 per triangle ).
+                 * @return Pointer to the first element ( NULL if the mesh is empty ).
+                 */
+                inline const int* getIndices ( void ) const {
+                        return this->_index.empty() ? NULL : &this->_index[0];
+                }
+
+                inline int* getIndices ( void ) {
+                        return this->_index.empty() ? NULL : &this->_index[0];
+                }
 
                 mi::Vector3d getNormal ( const int faceid , bool normalize = true ) const {
                         if ( ! this->isValidFaceId( faceid ) ) return mi::Vector3d();
 
-                        std::vector<int> fidx = this->getFaceIndices( faceid );
+                        const Face fidx = this->getFaceIndices( faceid );
                         mi::Vector3d v0 = this->getPosition( fidx[0] );
                         mi::Vector3d v1 = this->getPosition( fidx[1] ) - v0;
                         mi::Vector3d v2 = this->getPosition( fidx[2] ) - v0;
@@ -104,18 +264,22 @@ namespace mi
 
                 void setPosition ( const int vertexid, const mi::Vector3d& pos ) {
                         if ( this->isValidVertexId( vertexid ) ) {
-                                this->_vertex.at ( vertexid ) = pos;
+                                this->_x[vertexid] = static_cast<MeshReal>( pos.x() );
+                                this->_y[vertexid] = static_cast<MeshReal>( pos.y() );
+                                this->_z[vertexid] = static_cast<MeshReal>( pos.z() );
                         }
                         return;
                 };
                 void init( void ) {
-                        this->_vertex.clear();
+                        this->_x.clear();
+                        this->_y.clear();
+                        this->_z.clear();
                         this->_index.clear();
                         return;
                 }
 
                 inline int getNumVertices( void ) const {
-                        return static_cast<int>( this->_vertex.size() );
+                        return static_cast<int>( this->_x.size() );
                 }
 
                 inline int getNumFaces( void ) const {
@@ -155,7 +319,7 @@ namespace mi
                 }
 
                 double getArea( const int faceId ) const {
-                        std::vector<int> index = this->getFaceIndices( faceId );
+                        const Face index = this->getFaceIndices( faceId );
                         const Eigen::Vector3d p0 = this->getPosition( index[0] );
                         const Eigen::Vector3d p1 = this->getPosition( index[1] );
                         const Eigen::Vector3d p2 = this->getPosition( index[2] );
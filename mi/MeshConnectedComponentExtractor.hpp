@@ -24,13 +24,13 @@ namespace mi
 
                 int extract ( AssemblyMesh& assy ) {
                         const Mesh& mesh = this->_mesh;
-                        std::vector<int> faceLabel ( mesh.getNumFaces(), -1 ) ;
+                        const int numFaces = mesh.getNumFaces();
 
-                        std::deque< std::pair<int, int> > vfpairs; // vid , fid
-                        for ( int i = 0 ; i < mesh.getNumFaces() ; ++i ) {
-                                std::vector<int> index = mesh.getFaceIndices ( i );
-                                const int numvf = static_cast<int>( index.size() );
-                                for( int j = 0 ; j < numvf ; ++j ) {
+                        std::vector< std::pair<int, int> > vfpairs; // vid , fid
+                        vfpairs.reserve( 3 * numFaces );
+                        for ( int i = 0 ; i < numFaces ; ++i ) {
+                                const Mesh::Face index = mesh.getFaceIndices ( i );
+                                for( int j = 0 ; j < 3 ; ++j ) {
                                         vfpairs.push_back ( std::make_pair( index[j], i ) ) ;
                                 }
                         }
@@ -38,7 +38,7 @@ namespace mi
 
                         std::vector<int> vidx;
                         int curvid = -1;
-                        for( int i = 0 ; i < vfpairs.size() ; ++i ) {
+                        for( int i = 0 ; i < static_cast<int>( vfpairs.size() ) ; ++i ) {
                                 while ( vfpairs[i].first  != curvid ) {
                                         vidx.push_back( i );
                                         ++curvid;
@@ -47,51 +47,46 @@ namespace mi
                         vidx.push_back( static_cast<int>( vfpairs.size() ) );
 
 
-                        std::deque<std::pair<int, int> > edges;
-                        std::vector<int> idlist;
-
-                        for ( int i = 0 ; i < vidx.size() ; ++i ) {
-                                std::vector<int> fids;
+                        std::vector<std::pair<int, int> > edges;
+                        for ( int i = 0 ; i + 1 < static_cast<int>( vidx.size() ) ; ++i ) {
                                 const int begin = vidx[i];
                                 const int end   = vidx[i+1];
+                                // face ids of a vertex are already sorted.
                                 for( int j = begin ; j < end ; ++j ) {
-                                        fids.push_back( vfpairs[j].second );
-                                }
-
-                                std::sort( fids.begin(), fids.end() );
-                                for( int j = 0 ; j < fids.size() ; ++j ) {
-                                        for( int k = j + 1 ; k < fids.size() ; ++k ) {
-                                                edges.push_back (  std::make_pair( fids[j], fids[k]  ) ) ;
+                                        for( int k = j + 1 ; k < end ; ++k ) {
+                                                edges.push_back (  std::make_pair( vfpairs[j].second, vfpairs[k].second  ) ) ;
                                         }
                                 }
                         }
 
                         vfpairs.clear();
                         std::sort ( edges.begin(), edges.end() );
-                        std::deque<std::pair<int,int> >::iterator eiter = std::unique ( edges.begin(), edges.end() );
+                        std::vector<std::pair<int,int> >::iterator eiter = std::unique ( edges.begin(), edges.end() );
                         edges.erase( eiter, edges.end() );
 
-                        Graph graph ( mesh.getNumFaces() );
-                        for ( int i = 0 ; i < edges.size() ; ++i ) {
+                        Graph graph ( numFaces );
+                        for ( size_t i = 0 ; i < edges.size() ; ++i ) {
                                 graph.addEdge ( edges[i].first, edges[i].second );
                         }
                         const int numLabels = graph.label();
 
+                        std::vector<int> numComponentFaces( numLabels, 0 );
+                        for ( int i = 0 ; i < numFaces ; ++i ) {
+                                ++numComponentFaces[ graph.getClusterId( i ) ];
+                        }
+                        const int offset = assy.getNumMeshes();
                         for ( int i = 0 ; i < numLabels ; ++i ) {
-                                assy.create();
+                                const int id = assy.create();
+                                assy.getMesh( id )->reserve( 3 * numComponentFaces[i], numComponentFaces[i] );
                         }
 
-                        for ( int i = 0 ; i < mesh.getNumFaces() ; ++i ) {
-                                const int id = graph.getClusterId( i );
-                                std::vector<int> index = mesh.getFaceIndices ( i );
-
-
-                                for( int j = 0 ; j < index.size() ; ++j ) {
-                                        const mi::Vector3d p = mesh.getPosition( index[j] );
-                                        int newId = assy.getMesh( id )->addPoint( p );
-                                        index[j] = newId;
+                        for ( int i = 0 ; i < numFaces ; ++i ) {
+                                Mesh* component = assy.getMesh( offset + graph.getClusterId( i ) );
+                                Mesh::Face index = mesh.getFaceIndices ( i );
+                                for( int j = 0 ; j < 3 ; ++j ) {
+                                        index[j] = component->addPoint( mesh.getPosition( index[j] ) );
                                 }
-                                assy.getMesh( id )->addFace( index );
+                                component->addFace( index );
                         }
 
                         return numLabels;
@@ -5,21 +5,31 @@
 #pragma once
 #ifndef MI_MESH_EXPORTER_HPP
 #define MI_MESH_EXPORTER_HPP 1
+#include <string>
+#include <vector>
+#include <cstdio>
+#if defined(__has_include)
+#if __has_include(<charconv>) && __cplusplus >= 201703L
+#include <charconv>
+#endif
+#endif
 #include "Mesh.hpp"
 #include "Exporter.hpp"
+#include "ParallelFor.hpp"
 namespace mi
 {
         class MeshExporter : public Exporter
         {
         protected:
                 const Mesh& _mesh;
+                int _nthread;
         protected:
                 /**
                  * @brief Constructor.
                  * @param [in] mesh Mesh object.
                  * @param [in] isBinary Set true the file is binary format.
                  */
-                explicit MeshExporter ( const mi::Mesh& mesh, const bool isBinary = true ) : Exporter ( isBinary ), _mesh ( mesh ) {
+                explicit MeshExporter ( const mi::Mesh& mesh, const bool isBinary = true ) : Exporter ( isBinary ), _mesh ( mesh ), _nthread( 1 ) {
                         return;
                 }
         public:
@@ -29,6 +39,16 @@ namespace mi
                 virtual ~MeshExporter ( void ) {
                         return;
                 }
+
+                /**
+                 * @brief Set the number of threads used for formatting the body.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                MeshExporter& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
         protected:
                 /**
                  * @brief Get mesh instance.
@@ -37,6 +57,139 @@ namespace mi
                 const Mesh& getMesh ( void ) {
                         return this->_mesh;
                 }
+
+                /**
+                 * @brief Write records [0, num) formatted by fn.
+                 *
+                 * Records are formatted into per-thread buffers in parallel, and the buffers are
+                 * written in order with one call each. Memory usage is bounded by the batch size.
+                 * fn( begin, end, buf ) must append records [begin, end) to buf.
+                 * @param [in] fout File stream.
+                 * @param [in] num The number of records.
+                 * @param [in] fn Formatter.
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                template <typename Formatter>
+                bool write_records ( std::ofstream& fout, const int num, const Formatter& fn ) {
+                        const int chunkSize = 1 << 16;
+                        const int nthread = this->_nthread;
+                        std::vector<std::string> buf( nthread );
+                        std::vector<int> chunks;
+                        for ( int batch = 0 ; batch < num ; batch += chunkSize * nthread ) {
+                                chunks.clear();
+                                for ( int i = 0 ; i < nthread && batch + i * chunkSize < num ; ++i ) {
+                                        chunks.push_back( i );
+                                }
+                                format_chunk_fn<Formatter> cfn( fn, buf, batch, chunkSize, num );
+                                if ( chunks.size() == 1 ) cfn( 0 );
+                                else mi::parallel_for_each( chunks.begin(), chunks.end(), cfn, 1 );
+                                for ( size_t i = 0 ; i < chunks.size() ; ++i ) {
+                                        if ( !fout.write( buf[i].data(), static_cast<std::streamsize>( buf[i].size() ) ) ) return false;
+                                }
+                        }
+                        return fout.good();
+                }
+
+                /**
+                 * @brief Append a real value as formatted by std::ostream ( %g, 6 digits ).
+                 * @param [in,out] buf Buffer.
+                 * @param [in] v Value.
+                 */
+                static void append_real ( std::string& buf, const double v ) {
+                        char str[32];
+#if defined(__cpp_lib_to_chars)
+                        const std::to_chars_result r = std::to_chars( str, str + sizeof( str ), v, std::chars_format::general, 6 );
+                        buf.append( str, r.ptr );
+#else
+                        const int n = std::snprintf( str, sizeof( str ), "%g", v );
+                        buf.append( str, n );
+#endif
+                        return;
+                }
+
+                /**
+                 * @brief Append an integer value.
+                 * @param [in,out] buf Buffer.
+                 * @param [in] v Value.
+                 */
+                static void append_int ( std::string& buf, const int v ) {
+                        char str[16];
+#if defined(__cpp_lib_to_chars)
+                        const std::to_chars_result r = std::to_chars( str, str + sizeof( str ), v );
+                        buf.append( str, r.ptr );
+#else
+                        const int n = std::snprintf( str, sizeof( str ), "%d", v );
+                        buf.append( str, n );
+#endif
+                        return;
+                }
+
+                /**
+                 * @brief Append raw bytes of a value.
+                 * @param [in,out] buf Buffer.
+                 * @param [in] v Value.
+                 */
+                template <typename S>
+                static void append_binary ( std::string& buf, const S v ) {
+                        buf.append( reinterpret_cast<const char*>( &v ), sizeof( S ) );
+                        return;
+                }
+
+                /**
+                 * @brief Formatter writing vertices as "<prefix>x y z" lines.
+                 */
+                class ascii_vertex_fn
+                {
+                private:
+                        const MeshReal* _x;
+                        const MeshReal* _y;
+                        const MeshReal* _z;
+                        const std::string _prefix;
+                public:
+                        ascii_vertex_fn ( const Mesh& mesh, const std::string& prefix = std::string() ) :
+                                _x( mesh.getCoordinates( 0 ) ), _y( mesh.getCoordinates( 1 ) ), _z( mesh.getCoordinates( 2 ) ), _prefix( prefix ) {
+                                return;
+                        }
+
+                        void operator () ( const int begin, const int end, std::string& buf ) const {
+                                for ( int i = begin ; i < end ; ++i ) {
+                                        buf.append( this->_prefix );
+                                        MeshExporter::append_real( buf, this->_x[i] );
+                                        buf.push_back( ' ' );
+                                        MeshExporter::append_real( buf, this->_y[i] );
+                                        buf.push_back( ' ' );
+                                        MeshExporter::append_real( buf, this->_z[i] );
+                                        buf.push_back( '\n' );
+                                }
+                                return;
+                        }
+                };
+        private:
+                template <typename Formatter>
+                class format_chunk_fn
+                {
+                private:
+                        const Formatter& _fn;
+                        std::vector<std::string>& _buf;
+                        const int _offset;
+                        const int _chunkSize;
+                        const int _num;
+                public:
+                        format_chunk_fn ( const Formatter& fn, std::vector<std::string>& buf, const int offset, const int chunkSize, const int num ) :
+                                _fn( fn ), _buf( buf ), _offset( offset ), _chunkSize( chunkSize ), _num( num ) {
+                                return;
+                        }
+
+                        void operator () ( const int i ) const {
+                                const int begin = this->_offset + i * this->_chunkSize;
+                                const int end   = std::min( begin + this->_chunkSize, this->_num );
+                                std::string& buf = this->_buf[i];
+                                buf.clear();
+                                this->_fn( begin, end, buf );
+                                return;
+                        }
+                };
         };
 }
 #endif
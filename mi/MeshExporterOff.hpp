@@ -50,21 +50,32 @@ namespace mi
                  */
                 virtual bool writeBody ( std::ofstream &fout ) {
                         const Mesh& mesh = this->getMesh();
-                        for ( int i = 0 ; i < mesh.getNumVertices() ; ++i ) {
-                                Vector3d v0 = mesh.getPosition ( i );
-                                fout<<v0.x()<<" "<<v0.y()<<" "<<v0.z()<<std::endl;
+                        if ( !this->write_records( fout, mesh.getNumVertices(), ascii_vertex_fn( mesh ) ) ) return false;
+                        return this->write_records( fout, mesh.getNumFaces(), face_fn( mesh ) );
+                }
+        private:
+                class face_fn
+                {
+                private:
+                        const int* _index;
+                public:
+                        explicit face_fn ( const Mesh& mesh ) : _index( mesh.getIndices() ) {
+                                return;
                         }
 
-                        for ( int i = 0 ; i < mesh.getNumFaces() ; ++i ) {
-                                std::vector<int> idx = this->getMesh().getFaceIndices( i );
-                                fout<<idx.size();
-                                for( size_t j = 0 ; j < idx.size(); ++j ) {
-                                        fout<<" "<<idx[j];
+                        void operator () ( const int begin, const int end, std::string& buf ) const {
+                                for ( int i = begin ; i < end ; ++i ) {
+                                        const int* idx = this->_index + 3 * i;
+                                        buf.push_back( '3' );
+                                        for ( int j = 0 ; j < 3 ; ++j ) {
+                                                buf.push_back( ' ' );
+                                                MeshExporter::append_int( buf, idx[j] );
+                                        }
+                                        buf.push_back( '\n' );
                                 }
-                                fout<<std::endl;
+                                return;
                         }
-                        return fout.good();
-                }
+                };
         public:
                 /**
                  * @brief Return type of expoter.
@@ -56,15 +56,13 @@ namespace mi
                  */
                 bool writeBody ( std::ofstream &fout ) {
                         const Mesh& mesh = this->getMesh();
-                        for ( int i = 0 ; i < mesh.getNumVertices() ; ++i ) {
-                                mi::Vector3d v = mesh.getPosition( i );
-                                if ( !this->write_vertex( v, fout ) ) return false;
-                        }
-                        for ( int i = 0 ; i < mesh.getNumFaces() ; ++i ) {
-                                std::vector<int> idx = this->getMesh().getFaceIndices( i );
-                                if ( !this->write_face_index( idx, fout ) ) return false;
+                        if ( this->_isBinaryPly ) {
+                                if ( !this->write_records( fout, mesh.getNumVertices(), binary_vertex_fn( mesh ) ) ) return false;
+                                return this->write_records( fout, mesh.getNumFaces(), binary_face_fn( mesh ) );
+                        } else {
+                                if ( !this->write_records( fout, mesh.getNumVertices(), ascii_vertex_fn( mesh ) ) ) return false;
+                                return this->write_records( fout, mesh.getNumFaces(), ascii_face_fn( mesh ) );
                         }
-                        return true;
                 }
         public:
                 /**
@@ -76,37 +74,69 @@ namespace mi
                         else return std::string ( "ply(ascii)" );
                 }
         private:
-                bool write_vertex( mi::Vector3d& v, std::ofstream& fout  ) {
-                        if ( this->_isBinaryPly ) {
-                                float p[3];
-                                p[0] = static_cast<float>( v.x() );
-                                p[1] = static_cast<float>( v.y() );
-                                p[2] = static_cast<float>( v.z() );
-                                if( !fout.write( ( char* )( &p[0] ), sizeof( float ) * 3 ) ) return false;
-                        } else {
-                                fout<<v.x()<<" "<<v.y()<<" "<<v.z()<<std::endl;
+                class binary_vertex_fn
+                {
+                private:
+                        const MeshReal* _x;
+                        const MeshReal* _y;
+                        const MeshReal* _z;
+                public:
+                        explicit binary_vertex_fn ( const Mesh& mesh ) : _x( mesh.getCoordinates( 0 ) ), _y( mesh.getCoordinates( 1 ) ), _z( mesh.getCoordinates( 2 ) ) {
+                                return;
                         }
-                        return fout.good();
-                }
 
-                bool write_face_index ( std::vector<int>& idx, std::ofstream& fout ) {
-                        if ( this->_isBinaryPly ) {
-                                unsigned char n = static_cast<unsigned char>( idx.size() );
-                                if( !fout.write( ( char* )( &n ), sizeof( unsigned char ) ) ) {
-                                        return false;
+                        void operator () ( const int begin, const int end, std::string& buf ) const {
+                                buf.reserve( buf.size() + static_cast<size_t>( end - begin ) * sizeof( float ) * 3 );
+                                for ( int i = begin ; i < end ; ++i ) {
+                                        MeshExporter::append_binary( buf, static_cast<float>( this->_x[i] ) );
+                                        MeshExporter::append_binary( buf, static_cast<float>( this->_y[i] ) );
+                                        MeshExporter::append_binary( buf, static_cast<float>( this->_z[i] ) );
                                 }
-                                if( !fout.write( ( char* )( &idx[0] ), sizeof( int ) * n ) ) {
-                                        return false;
+                                return;
+                        }
+                };
+
+                class binary_face_fn
+                {
+                private:
+                        const int* _index;
+                public:
+                        explicit binary_face_fn ( const Mesh& mesh ) : _index( mesh.getIndices() ) {
+                                return;
+                        }
+
+                        void operator () ( const int begin, const int end, std::string& buf ) const {
+                                buf.reserve( buf.size() + static_cast<size_t>( end - begin ) * ( 1 + sizeof( int ) * 3 ) );
+                                for ( int i = begin ; i < end ; ++i ) {
+                                        buf.push_back( static_cast<char>( 3 ) );
+                                        buf.append( reinterpret_cast<const char*>( this->_index + 3 * i ), sizeof( int ) * 3 );
                                 }
-                        } else {
-                                fout<<idx.size();
-                                for ( size_t j = 0 ; j < idx.size() ; ++j ) {
-                                        fout<<" "<<idx[idx.size() - 1 - j];
+                                return;
+                        }
+                };
+
+                class ascii_face_fn
+                {
+                private:
+                        const int* _index;
+                public:
+                        explicit ascii_face_fn ( const Mesh& mesh ) : _index( mesh.getIndices() ) {
+                                return;
+                        }
+
+                        void operator () ( const int begin, const int end, std::string& buf ) const {
+                                for ( int i = begin ; i < end ; ++i ) {
+                                        const int* idx = this->_index + 3 * i;
+                                        buf.push_back( '3' );
+                                        for ( int j = 0 ; j < 3 ; ++j ) {
+                                                buf.push_back( ' ' );
+                                                MeshExporter::append_int( buf, idx[2 - j] );
+                                        }
+                                        buf.push_back( '\n' );
                                 }
-                                fout<<std::endl;
+                                return;
                         }
-                        return fout.good();
-                }
+                };
         private:
                 bool _isBinaryPly;
         };
@@ -63,7 +63,7 @@ namespace mi
                                 if ( !this->write_vertex( v, this->_col[i], fout ) ) return false;
                         }
                         for ( int i = 0 ; i < mesh.getNumFaces() ; ++i ) {
-                                std::vector<int> idx = this->getMesh().getFaceIndices( i );
+                                const Mesh::Face idx = this->getMesh().getFaceIndices( i );
                                 if ( !this->write_face_index( idx, fout ) ) return false;
                         }
                         return true;
@@ -97,7 +97,7 @@ namespace mi
                         return fout.good();
                 }
 
-                bool write_face_index ( std::vector<int>& idx, std::ofstream& fout ) {
+                bool write_face_index ( const Mesh::Face& idx, std::ofstream& fout ) {
                         if ( this->_isBinaryPly ) {
                                 unsigned char n = static_cast<unsigned char>( idx.size() );
                                 if( !fout.write( ( char* )( &n ), sizeof( unsigned char ) ) ) {
@@ -52,7 +52,7 @@ namespace mi
                 virtual bool writeHeader( std::ofstream &fout ) {
                         if( !fout.is_open() ) return false;
                         std::string name = this->getMesh().getName();
-                        char ch[80];
+                        char ch[80] = {0};
                         //std::strcpy( ch, name.c_str() );
                         for( std::string::size_type i = 0 ; i < name.length() ; ++i ) {
                                 if ( i == 80 ) break;
@@ -69,32 +69,48 @@ namespace mi
                  */
                 virtual bool writeBody ( std::ofstream &fout ) {
                         const Mesh& mesh = this->getMesh();
-                        for ( int i = 0 ; i < mesh.getNumFaces() ; ++i ) {
-                                std::vector<int> idx = this->getMesh().getFaceIndices ( i );
-                                Vector3d v0 = mesh.getPosition ( idx[0] );
-                                Vector3d v1 = mesh.getPosition ( idx[1] );
-                                Vector3d v2 = mesh.getPosition ( idx[2] );
-                                Vector3d n  = mesh.getNormal( i, true );
-                                std::vector<float> buf;
-                                buf.reserve( 16 );
-                                buf.push_back( static_cast<float>(  n.x() ) );
-                                buf.push_back( static_cast<float>(  n.y() ) );
-                                buf.push_back( static_cast<float>(  n.z() ) );
-                                buf.push_back( static_cast<float>( v0.x() ) );
-                                buf.push_back( static_cast<float>( v0.y() ) );
-                                buf.push_back( static_cast<float>( v0.z() ) );
-                                buf.push_back( static_cast<float>( v1.x() ) );
-                                buf.push_back( static_cast<float>( v1.y() ) );
-                                buf.push_back( static_cast<float>( v1.z() ) );
-                                buf.push_back( static_cast<float>( v2.x() ) );
-                                buf.push_back( static_cast<float>( v2.y() ) );
-                                buf.push_back( static_cast<float>( v2.z() ) );
-                                if( !fout.write ( ( char* )( &buf[0] ), 48 )  ) return false;
-                                unsigned short s = ( i < static_cast<int>( this->_property.size() ) ) ? this->_property[i] : 0x0000;
-                                if( !fout.write ( ( char* )( &s ), 2 ) ) return false;
-                        }
-                        return true;
+                        return this->write_records( fout, mesh.getNumFaces(), face_fn( mesh, this->_property ) );
                 }
+        private:
+                class face_fn
+                {
+                private:
+                        const Mesh& _mesh;
+                        const std::vector<unsigned short>& _property;
+                public:
+                        face_fn ( const Mesh& mesh, const std::vector<unsigned short>& property ) : _mesh( mesh ), _property( property ) {
+                                return;
+                        }
+
+                        void operator () ( const int begin, const int end, std::string& buf ) const {
+                                const Mesh& mesh = this->_mesh;
+                                buf.reserve( buf.size() + static_cast<size_t>( end - begin ) * 50 );
+                                for ( int i = begin ; i < end ; ++i ) {
+                                        const Mesh::Face idx = mesh.getFaceIndices ( i );
+                                        const Vector3d v0 = mesh.getPosition ( idx[0] );
+                                        const Vector3d v1 = mesh.getPosition ( idx[1] );
+                                        const Vector3d v2 = mesh.getPosition ( idx[2] );
+                                        const Vector3d n  = mesh.getNormal( i, true );
+                                        float rec[12];
+                                        rec[ 0] = static_cast<float>(  n.x() );
+                                        rec[ 1] = static_cast<float>(  n.y() );
+                                        rec[ 2] = static_cast<float>(  n.z() );
+                                        rec[ 3] = static_cast<float>( v0.x() );
+                                        rec[ 4] = static_cast<float>( v0.y() );
+                                        rec[ 5] = static_cast<float>( v0.z() );
+                                        rec[ 6] = static_cast<float>( v1.x() );
+                                        rec[ 7] = static_cast<float>( v1.y() );
+                                        rec[ 8] = static_cast<float>( v1.z() );
+                                        rec[ 9] = static_cast<float>( v2.x() );
+                                        rec[10] = static_cast<float>( v2.y() );
+                                        rec[11] = static_cast<float>( v2.z() );
+                                        buf.append( reinterpret_cast<const char*>( &rec[0] ), 48 );
+                                        const unsigned short s = ( i < static_cast<int>( this->_property.size() ) ) ? this->_property[i] : 0x0000;
+                                        MeshExporter::append_binary( buf, s );
+                                }
+                                return;
+                        }
+                };
         public:
                 /**
                  * @brief Return type of expoter.
@@ -6,6 +6,8 @@
 #ifndef MI_MESH_IMPORTER_HPP
 #define MI_MESH_IMPORTER_HPP 1
 
+#include <vector>
+#include <algorithm>
 #include "Mesh.hpp"
 #include "Importer.hpp"
 
@@ -15,13 +17,15 @@ namespace mi
         {
         protected:
                 Mesh& _mesh;
+                int _nthread;
+                bool _weld;
         protected:
                 /**
                  * @brief Constructor.
                  * @param [in] mesh Mesh object.
                  * @param [in] isBinary Set true the file is binary format.
                  */
-                explicit MeshImporter ( mi::Mesh& mesh, const bool isBinary = true ) : Importer ( isBinary ), _mesh ( mesh ) {
+                explicit MeshImporter ( mi::Mesh& mesh, const bool isBinary = true ) : Importer ( isBinary ), _mesh ( mesh ), _nthread( 1 ), _weld( false ) {
                         return;
                 }
         public:
@@ -31,6 +35,26 @@ namespace mi
                 virtual ~MeshImporter ( void ) {
                         return;
                 }
+
+                /**
+                 * @brief Set the number of threads used for decoding the body.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                MeshImporter& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
+
+                /**
+                 * @brief Merge vertices having exactly the same position after reading.
+                 * @param [in] weld Set true to weld vertices.
+                 * @return Instance itself.
+                 */
+                MeshImporter& setWeld ( const bool weld = true ) {
+                        this->_weld = weld;
+                        return *this;
+                }
         protected:
                 /**
                  * @brief Get mesh instance.
@@ -39,6 +63,99 @@ namespace mi
                 Mesh& getMesh ( void ) {
                         return this->_mesh;
                 }
+
+                /**
+                 * @brief Read the rest of the stream into a buffer.
+                 * @param [in] fin File stream.
+                 * @param [out] buf Buffer.
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                static bool read_all ( std::ifstream& fin, std::vector<char>& buf ) {
+                        const std::streampos cur = fin.tellg();
+                        fin.seekg( 0, std::ios::end );
+                        const std::streampos last = fin.tellg();
+                        fin.seekg( cur, std::ios::beg );
+                        if ( cur < 0 || last < cur ) return false;
+                        buf.resize( static_cast<size_t>( last - cur ) );
+                        if ( buf.empty() ) return true;
+                        return static_cast<bool>( fin.read( &buf[0], static_cast<std::streamsize>( buf.size() ) ) );
+                }
+
+                /**
+                 * @brief Merge vertices having identical coordinates.
+                 *
+                 * The first occurrence of each position is kept, and vertex order is preserved.
+                 * @param [in,out] mesh Mesh.
+                 * @return The number of vertices after welding.
+                 */
+                static int weld ( Mesh& mesh ) {
+                        const int numVertices = mesh.getNumVertices();
+                        const int numFaces    = mesh.getNumFaces();
+                        if ( numVertices == 0 ) return 0;
+                        const MeshReal* x = mesh.getCoordinates( 0 );
+                        const MeshReal* y = mesh.getCoordinates( 1 );
+                        const MeshReal* z = mesh.getCoordinates( 2 );
+
+                        std::vector<int> order( numVertices );
+                        for ( int i = 0 ; i < numVertices ; ++i ) order[i] = i;
+                        std::stable_sort( order.begin(), order.end(), less_position( x, y, z ) );
+
+                        std::vector<int> rep( numVertices );
+                        for ( int i = 0 ; i < numVertices ; ) {
+                                const int first = order[i];
+                                int j = i;
+                                for ( ; j < numVertices ; ++j ) {
+                                        const int k = order[j];
+                                        if ( x[k] != x[first] || y[k] != y[first] || z[k] != z[first] ) break;
+                                        rep[k] = first;
+                                }
+                                i = j;
+                        }
+                        order.clear();
+
+                        std::vector<int> newId( numVertices );
+                        Mesh result;
+                        result.addName( mesh.getName() );
+                        int count = 0;
+                        for ( int i = 0 ; i < numVertices ; ++i ) {
+                                if ( rep[i] == i ) newId[i] = count++;
+                                else newId[i] = newId[ rep[i] ];
+                        }
+                        result.reserve( count, numFaces );
+                        for ( int i = 0 ; i < numVertices ; ++i ) {
+                                if ( rep[i] == i ) result.addPoint( x[i], y[i], z[i] );
+                        }
+                        const int* index = mesh.getIndices();
+                        for ( int i = 0 ; i < numFaces ; ++i ) {
+                                int v[3];
+                                for ( int j = 0 ; j < 3 ; ++j ) {
+                                        const int id = index[ 3 * i + j ];
+                                        v[j] = ( 0 <= id && id < numVertices ) ? newId[id] : id;
+                                }
+                                result.addFace( v[0], v[1], v[2] );
+                        }
+                        mesh.swap( result );
+                        return count;
+                }
+        private:
+                class less_position
+                {
+                private:
+                        const MeshReal* _x;
+                        const MeshReal* _y;
+                        const MeshReal* _z;
+                public:
+                        less_position ( const MeshReal* x, const MeshReal* y, const MeshReal* z ) : _x( x ), _y( y ), _z( z ) {
+                                return;
+                        }
+
+                        bool operator () ( const int a, const int b ) const {
+                                if ( this->_x[a] != this->_x[b] ) return this->_x[a] < this->_x[b];
+                                if ( this->_y[a] != this->_y[b] ) return this->_y[a] < this->_y[b];
+                                return this->_z[a] < this->_z[b];
+                        }
+                };
         };
 }
 #endif
@@ -6,7 +6,8 @@
 #define MI_MESH_IMPORTER_OBJ_HPP 1
 
 #include <vector>
-#include "Tokenizer.hpp"
+#include <cstdlib>
+#include <cstring>
 #include "MeshImporter.hpp"
 
 namespace mi
@@ -38,58 +39,76 @@ namespace mi
                  */
                 virtual bool readBody ( std::ifstream &fin ) {
                         Mesh& mesh = this->getMesh();
+                        std::vector<char> buf;
+                        if ( !MeshImporter::read_all( fin, buf ) ) return false;
+                        buf.push_back( '\0' ); // terminator for strtod().
 
-                        std::vector<Eigen::Vector3d> vx;
-                        std::deque< std::deque<int> > index;
-
-                        int count = -1;
-                        while ( fin ) {
-                                std::string  buffer;
-                                std::getline( fin, buffer );
-                                if( fin.eof() ) break;
-                                if ( buffer.find_first_of( "#" ) == 0 ) continue;
-                                if ( buffer.length() == 0 ) continue;
+                        mesh.init();
+                        const char* p    = &buf[0];
+                        const char* last = p + buf.size() - 1;
+                        while ( p < last ) {
+                                const char* eol = static_cast<const char*>( std::memchr( p, '\n', static_cast<size_t>( last - p ) ) );
+                                if ( eol == NULL ) eol = last;
+                                this->parse_line( p, eol, mesh );
+                                p = eol + 1;
+                        }
+                        if ( this->_weld ) MeshImporter::weld( mesh );
+                        return true;
+                }
 
-                                Tokenizer tokenizer1 ( buffer, " " ) ;
-                                if ( tokenizer1.size() == 0 ) continue;
-                                if ( tokenizer1.get( 0 ).compare( "v" ) == 0 ) {
-                                        Eigen::Vector3d p;
-                                        p.x() = std::atof( tokenizer1.get( 1 ).c_str() );
-                                        p.y() = std::atof( tokenizer1.get( 2 ).c_str() );
-                                        p.z() = std::atof( tokenizer1.get( 3 ).c_str() );
-                                        vx.push_back( p );
-                                } else if ( tokenizer1.get( 0 ).compare( "g" ) == 0 ) {
-                                        count++;
-                                } else if ( tokenizer1.get( 0 ).compare( "f" ) == 0 ) {
-                                        index.push_back( std::deque<int>() );
-                                        for( int i = 1 ; i < tokenizer1.size() ; ++i ) {
-                                                Tokenizer tokenizer2( tokenizer1.get( i ), "/" );
-                                                if ( tokenizer2.get( 0 ).length() != 0 ) {
-                                                        std::string token = tokenizer2.get( 0 );
-                                                        int fid =  std::atoi( token.c_str() );
-                                                        if( fid != 0 ) index[ index.size() - 1 ].push_back( fid - 1 );
+                /**
+                 * @brief Parse a line [p, eol). Only "v" and "f" are interpreted.
+                 * @param [in] p Beginning of the line.
+                 * @param [in] eol End of the line.
+                 * @param [out] mesh Mesh.
+                 */
+                void parse_line ( const char* p, const char* eol, Mesh& mesh ) {
+                        if ( *p == '#' ) return;
+                        p = skip_blank( p, eol );
+                        const char* key = p;
+                        p = skip_token( p, eol );
+                        if ( p - key != 1 ) return;
 
-                                                }
-                                        }
+                        if ( *key == 'v' ) {
+                                double v[3] = { 0, 0, 0 };
+                                for ( int i = 0 ; i < 3 ; ++i ) {
+                                        p = skip_blank( p, eol );
+                                        if ( p == eol ) break;
+                                        char* next = NULL;
+                                        v[i] = std::strtod( p, &next );
+                                        p = skip_token( next, eol );
                                 }
-                        }
-
-                        mesh.init();
-                        for ( size_t i = 0 ; i < vx.size() ; ++i ) {
-                                mesh.addPoint( vx[i] );
-                        }
-                        for( size_t j = 0 ; j < index.size() ; ++j ) {
+                                mesh.addPoint( v[0], v[1], v[2] );
+                        } else if ( *key == 'f' ) {
                                 //N-gon -> triangles
-                                for ( size_t k = 0  ; k < index[j].size() - 2; ++k ) {
-                                        std::vector<int> fid;
-                                        fid.push_back( index[j][0] );
-                                        fid.push_back( index[j][k+1] );
-                                        fid.push_back( index[j][k+2] );
-                                        mesh.addFace( fid );
+                                int num = 0;
+                                int first = 0;
+                                int prev = 0;
+                                for ( ; ; ) {
+                                        p = skip_blank( p, eol );
+                                        if ( p == eol ) break;
+                                        while ( p < eol && *p == '/' ) ++p;
+                                        const int fid = static_cast<int>( std::strtol( p, NULL, 10 ) );
+                                        p = skip_token( p, eol );
+                                        if ( fid == 0 ) continue;
+                                        const int id = fid - 1;
+                                        if ( num == 0 ) first = id;
+                                        else if ( num >= 2 ) mesh.addFace( first, prev, id );
+                                        prev = id;
+                                        ++num;
                                 }
                         }
+                        return;
+                }
 
-                        return true;
+                static const char* skip_blank ( const char* p, const char* eol ) {
+                        while ( p < eol && ( *p == ' ' || *p == '\t' || *p == '\r' ) ) ++p;
+                        return p;
+                }
+
+                static const char* skip_token ( const char* p, const char* eol ) {
+                        while ( p < eol && *p != ' ' && *p != '\t' && *p != '\r' ) ++p;
+                        return p;
                 }
         public:
                 /**
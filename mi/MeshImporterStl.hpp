@@ -6,7 +6,10 @@
 #define MI_MESH_IMPORTER_STL_HPP 1
 
 #include <vector>
+#include <cstring>
+#include <algorithm>
 #include "MeshImporter.hpp"
+#include "ParallelFor.hpp"
 
 namespace mi
 {
@@ -34,15 +37,54 @@ namespace mi
                         return;
                 }
         private:
+                /**
+                 * @brief Decode a part of binary records into the mesh.
+                 */
+                class decode_fn
+                {
+                private:
+                        const char* _buf;
+                        MeshReal* _x;
+                        MeshReal* _y;
+                        MeshReal* _z;
+                        int* _index;
+                        const int _vertexOffset;
+                        const int _numFaces;
+                        const int _numChunks;
+                public:
+                        decode_fn ( const char* buf, Mesh& mesh, const int vertexOffset, const int faceOffset, const int numFaces, const int numChunks ) :
+                                _buf( buf ), _x( mesh.getCoordinates( 0 ) + vertexOffset ), _y( mesh.getCoordinates( 1 ) + vertexOffset ), _z( mesh.getCoordinates( 2 ) + vertexOffset ),
+                                _index( mesh.getIndices() + 3 * faceOffset ), _vertexOffset( vertexOffset ), _numFaces( numFaces ), _numChunks( numChunks ) {
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                const int begin = static_cast<int>( static_cast<long long>( this->_numFaces ) * chunk / this->_numChunks );
+                                const int end   = static_cast<int>( static_cast<long long>( this->_numFaces ) * ( chunk + 1 ) / this->_numChunks );
+                                for ( int i = begin ; i < end ; ++i ) {
+                                        float v[9];
+                                        std::memcpy( v, this->_buf + 50 * static_cast<size_t>( i ) + 12, sizeof( float ) * 9 );
+                                        for ( int j = 0 ; j < 3 ; ++j ) {
+                                                const int vid = 3 * i + j;
+                                                this->_x[vid] = static_cast<MeshReal>( v[ 3 * j + 0 ] );
+                                                this->_y[vid] = static_cast<MeshReal>( v[ 3 * j + 1 ] );
+                                                this->_z[vid] = static_cast<MeshReal>( v[ 3 * j + 2 ] );
+                                                this->_index[vid] = this->_vertexOffset + vid;
+                                        }
+                                }
+                                return;
+                        }
+                };
+
                 bool readHeader ( std::ifstream& fin ) {
                         if ( !this->isBinary() ) return true;
                         //Binary
                         char buf[80];
                         fin.read ( ( char* ) &buf, 80 );
-                        this->_name = std::string ( buf );
+                        this->_name = std::string ( buf, std::find( buf, buf + 80, '\0' ) );
                         fin.read( ( char* )&( this->_num_faces ), sizeof ( unsigned int ) );
 
-                        return true; fin.good();
+                        return fin.good();
                 }
                 /**
                  * @brief Write body part of STL file.
@@ -50,8 +92,13 @@ namespace mi
                  */
                 bool readBody ( std::ifstream &fin ) {
                         Mesh& mesh = this->getMesh();
-                        if ( this->isBinary() ) return this->read_body_binary ( fin, mesh ) ;
-                        else                    return this->read_body_ascii  ( fin, mesh ) ;
+                        if ( this->isBinary() ) {
+                                if ( !this->read_body_binary ( fin, mesh ) ) return false;
+                        } else {
+                                if ( !this->read_body_ascii  ( fin, mesh ) ) return false;
+                        }
+                        if ( this->_weld ) MeshImporter::weld( mesh );
+                        return true;
                 }
         public:
                 /**
@@ -64,30 +111,25 @@ namespace mi
 
 
                 bool read_body_binary ( std::ifstream& fin , Mesh & mesh ) {
-                        for ( unsigned int i = 0 ; i < this->_num_faces ; i++ ) {
-                                float nx, ny, nz;
-                                fin.read ( ( char* ) & ( nx ), sizeof ( float ) );
-                                fin.read ( ( char* ) & ( ny ), sizeof ( float ) );
-                                fin.read ( ( char* ) & ( nz ), sizeof ( float ) );
-                                for ( int j = 0 ; j < 3 ; j++ ) {
-                                        float x, y, z;
-                                        fin.read ( ( char* ) &x, sizeof ( float ) );
-                                        fin.read ( ( char* ) &y, sizeof ( float ) );
-                                        fin.read ( ( char* ) &z, sizeof ( float ) );
-                                        Eigen::Vector3d v ( x,y,z );
-                                        mesh.addPoint( v );
-                                }
-                                std::vector<int> idx;
-                                idx.push_back( i * 3 + 0 ) ;
-                                idx.push_back( i * 3 + 1 ) ;
-                                idx.push_back( i * 3 + 2 ) ;
-                                mesh.addFace( idx );
-
-                                char buf[2];
-                                fin.read ( buf, 2 );
-
+                        const size_t recordSize = 50; // normal(12) + vertices(36) + attribute(2)
+                        std::vector<char> buf;
+                        if ( !MeshImporter::read_all( fin, buf ) ) return false;
+                        if ( buf.size() < recordSize * this->_num_faces ) {
+                                std::cerr<<"file is truncated. ";
+                                return false;
                         }
-                        return fin.good();
+                        const int numFaces  = static_cast<int>( this->_num_faces );
+                        const int vertexOffset = mesh.getNumVertices();
+                        const int faceOffset   = mesh.getNumFaces();
+                        mesh.resize( vertexOffset + 3 * static_cast<size_t>( numFaces ), faceOffset + static_cast<size_t>( numFaces ) );
+                        if ( numFaces == 0 ) return true;
+
+                        decode_fn fn( &buf[0], mesh, vertexOffset, faceOffset, numFaces, this->_nthread );
+                        std::vector<int> chunks;
+                        for ( int i = 0 ; i < this->_nthread ; ++i ) chunks.push_back( i );
+                        if ( this->_nthread == 1 ) fn( 0 );
+                        else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                        return true;
                 }
 
                 bool read_body_ascii (  std::ifstream& fin , Mesh & mesh ) {
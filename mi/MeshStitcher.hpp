@@ -36,15 +36,20 @@ namespace mi
 
                 bool stitch ( Mesh& resultMesh ) {
                         typedef IndexedVector<Vector3d> VertexType;
-                        std::vector<int> newId( this->_mesh.getNumVertices(), -1 ) ;
+                        const int numVertices = this->_mesh.getNumVertices();
+                        const int numFaces    = this->_mesh.getNumFaces();
+                        std::vector<int> newId( numVertices, -1 ) ;
                         std::vector< VertexType > points;
-                        for( int i = 0 ; i < this->_mesh.getNumVertices() ; ++i ) {
+                        points.reserve( numVertices );
+                        for( int i = 0 ; i < numVertices ; ++i ) {
                                 points.push_back( VertexType( this->_mesh.getPosition( i ), i ) ) ;
                         }
                         Kdtree<VertexType> kdtree( points );
-                        for( int i = 0 ; i < this->_mesh.getNumVertices() ; ++i ) {
+                        resultMesh.reserve( resultMesh.getNumVertices() + numVertices, resultMesh.getNumFaces() + numFaces );
+                        std::list<VertexType> result;
+                        for( int i = 0 ; i < numVertices ; ++i ) {
                                 if ( newId[i] != -1 ) continue;
-                                std::list<VertexType> result;
+                                result.clear();
                                 kdtree.find( VertexType( this->_mesh.getPosition( i ), 0 ), this->_eps, result );
                                 const int id = resultMesh.addPoint( this->_mesh.getPosition( i ) ) ;
                                 for( std::list<VertexType>::iterator iter = result.begin() ; iter != result.end() ; ++iter ) {
@@ -52,13 +57,9 @@ namespace mi
                                 }
                         }
 
-                        for ( int i = 0 ; i < this->_mesh.getNumFaces() ; ++i ) {
-                                std::vector<int> index = this->_mesh.getFaceIndices ( i ) ;
-                                for ( size_t j = 0 ; j < index.size() ; ++j ) {
-                                        const int id = index[j];
-                                        index[j] = newId [ id ];
-                                }
-                                resultMesh.addFace( index );
+                        const int* index = this->_mesh.getIndices();
+                        for ( int i = 0 ; i < numFaces ; ++i ) {
+                                resultMesh.addFace( newId[ index[ 3 * i + 0 ] ], newId[ index[ 3 * i + 1 ] ], newId[ index[ 3 * i + 2 ] ] );
                         }
                         return true;
                 }
@@ -34,15 +34,20 @@ namespace mi
                  * @brief Open mesh data.
                  * @param [in] mesh Mesh.
                  * @param [in] filename File name.
+                 * @param [in] isBinary Binary mode.
+                 * @param [in] weld Merge vertices having the same position.
                  * @retval true Success.
                  * @retval false Failure.
                  */
-                static bool open ( Mesh& mesh, const std::string& filename, const bool isBinary = true ) {
+                static bool open ( Mesh& mesh, const std::string& filename, const bool isBinary = true, const bool weld = false ) {
                         std::string extension = FileNameConverter( filename ).getExtension();
+                        const int nthread = MeshUtility::getNumThread();
                         if ( extension.compare( "stl" ) == 0 ) {
-                                return MeshImporterStl( mesh ).read( filename );
+                                MeshImporterStl importer( mesh );
+                                return importer.setNumThread( nthread ).setWeld( weld ).read( filename );
                         } else if ( extension.compare( "obj" ) == 0 ) {
-                                return MeshImporterObj( mesh ).read( filename );
+                                MeshImporterObj importer( mesh );
+                                return importer.setNumThread( nthread ).setWeld( weld ).read( filename );
                         } else {
                                 std::cerr<<"unsupported format "<<extension<<std::endl;
                                 return false;
@@ -57,20 +62,43 @@ namespace mi
                  */
                 static bool save ( const Mesh& mesh, const std::string& filename, const bool isBinary = true ) {
                         std::string extension = FileNameConverter( filename ).getExtension();
+                        const int nthread = MeshUtility::getNumThread();
                         if ( extension.compare( "stl" ) == 0 ) {
-                                return MeshExporterStl( mesh ).write( filename );
+                                MeshExporterStl exporter( mesh );
+                                return exporter.setNumThread( nthread ).write( filename );
                         } else if ( extension.compare( "ply" ) == 0 ) {
-                                return MeshExporterPly( mesh , isBinary ).write( filename );
+                                MeshExporterPly exporter( mesh , isBinary );
+                                return exporter.setNumThread( nthread ).write( filename );
                         } else if ( extension.compare( "obj" ) == 0 ) {
-                                return MeshExporterObj( mesh ).write( filename );
+                                MeshExporterObj exporter( mesh );
+                                return exporter.setNumThread( nthread ).write( filename );
                         } else if ( extension.compare( "off" ) == 0 ) {
-                                return MeshExporterOff( mesh ).write( filename );
+                                MeshExporterOff exporter( mesh );
+                                return exporter.setNumThread( nthread ).write( filename );
                         } else {
                                 std::cerr<<"unsupported format "<<extension<<std::endl;
                                 return false;
                         }
                 }
 
+                /**
+                 * @brief Get the number of threads.
+                 * @return The number of threads.
+                 */
+                static int& getNumThread ( void ) {
+                        static int nthread = 1;
+                        return nthread;
+                }
+
+                /**
+                 * @brief Set the number of threads.
+                 * @param [in] nThread The number of threads.
+                 */
+                static void setNumThread ( const int nThread ) {
+                        MeshUtility::getNumThread() = nThread <  1 ? 1 : nThread;
+                        return;
+                }
+
 		/**
 		 * @brief Stitch a triangle soup.
 		 * @param [in, out] mesh Mesh object.
@@ -80,15 +108,8 @@ namespace mi
                         Mesh mesh0;
                         MeshStitcher stitcher( mesh, eps );
                         if ( !stitcher.stitch( mesh0 ) ) return false;
-			// Copying from mesh0 to mesh.
-                        mesh.init();
-                        for ( int i = 0 ; i < mesh0.getNumVertices(); ++i ) {
-                                mi::Vector3d p = mesh0.getPosition( i );
-                                mesh.addPoint( p );
-                        }
-                        for ( int i = 0 ; i < mesh0.getNumFaces(); ++i ) {
-                                mesh.addFace( mesh0.getFaceIndices( i ) );
-                        }
+                        mesh0.addName( mesh.getName() );
+                        mesh.swap( mesh0 );
                         return true;
                 }
 
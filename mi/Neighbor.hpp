@@ -3,6 +3,7 @@
 #include <vector>
 #include <algorithm>
 #include <functional>
+#include <cstddef>
 #include "math.hpp"
 
 namespace mi
@@ -68,6 +69,61 @@ namespace mi
                 static iterator end26 ( void ) {
                         return Neighbor::end( 26 );
                 }
+
+                /**
+                 * @brief Get linear offsets to neighboring voxels.
+                 * @param [in] strideY Distance between adjacent rows ( VolumeData::getStrideY() ).
+                 * @param [in] strideZ Distance between adjacent slices ( VolumeData::getStrideZ() ).
+                 * @param [in] n The number of neighbors ( 6, 18 or 26 ).
+                 * @return Offsets in the same order as begin() - end( n ).
+                 */
+                static std::vector<ptrdiff_t> getOffsets ( const ptrdiff_t strideY, const ptrdiff_t strideZ, const int n = 26 ) {
+                        std::vector<ptrdiff_t> offsets;
+                        for ( iterator iter = Neighbor::begin() ; iter != Neighbor::end( n ) ; ++iter ) {
+                                offsets.push_back( iter->x() + iter->y() * strideY + iter->z() * strideZ );
+                        }
+                        return offsets;
+                }
+        };
+
+        /**
+         * @class NeighborOffset Neighbor.hpp <mi/Neighbor.hpp>
+         * @brief Linear offsets to N neighboring voxels for a fixed volume layout.
+         *
+         * N is 6, 18 or 26, and the order is the same as Neighbor. Since N is a compile-time constant,
+         * loops over the offsets can be unrolled.
+         * @code
+         * const NeighborOffset<6> nbr( data.getStrideY(), data.getStrideZ() );
+         * const char* q = data.getPointer( y, z ) + x;
+         * for ( int i = 0 ; i < NeighborOffset<6>::size ; ++i ) if ( q[ nbr[i] ] ) ...
+         * @endcode
+         * The volume needs a halo ( VolumeData::setHalo() ) unless the neighbors are known to be inside.
+         */
+        template <int N>
+        class NeighborOffset
+        {
+                static_assert( N == 6 || N == 18 || N == 26, "the number of neighbors must be 6, 18 or 26." );
+        public:
+                static const int size = N;
+        private:
+                ptrdiff_t _offset[N];
+        public:
+                /**
+                 * @brief Constructor.
+                 * @param [in] strideY Distance between adjacent rows.
+                 * @param [in] strideZ Distance between adjacent slices.
+                 */
+                NeighborOffset ( const ptrdiff_t strideY, const ptrdiff_t strideZ ) {
+                        Neighbor::iterator iter = Neighbor::begin();
+                        for ( int i = 0 ; i < N ; ++i, ++iter ) {
+                                this->_offset[i] = iter->x() + iter->y() * strideY + iter->z() * strideZ;
+                        }
+                        return;
+                }
+
+                inline ptrdiff_t operator [] ( const int i ) const {
+                        return this->_offset[i];
+                }
         };
 }
 #endif //MI_NEIGHBOR_HPP
@@ -2,25 +2,31 @@
 #define MI_RUN_LENGTH_CODE_BINARY_HPP 1
 namespace mi
 {
+        /**
+         * @class RunLengthCodeBinary RunLengthCodeBinary.hpp <mi/RunLengthCodeBinary.hpp>
+         * @brief Run of foreground voxels along x.
+         *
+         * The start point and the length are 32-bit, so rows longer than 32767 voxels can be encoded. The row
+         * ( y, z ) of a run is not stored; it is given by the row index of the encoder ( RunLengthEncoder ), so a
+         * code is 12 bytes including the parent.
+         */
         class RunLengthCodeBinary
         {
         private:
                 // Start point
-                short int _sx;
-                short int _sy;
-                short int _sz;
+                int _sx;
 		
-                short int _length;
+                int _length;
                
 		// Parent ID (for labelling)
                 int       _parent;
         public:
-                RunLengthCodeBinary ( const short int x, const short int y, const short int z, const short int l ) : _sx( x ),  _sy( y ), _sz( z ) , _length( l ) {
+                RunLengthCodeBinary ( const int x, const int l ) : _sx( x ), _length( l ) {
                         this->_parent = -1;
                         return;
                 }
 
-                RunLengthCodeBinary ( const RunLengthCodeBinary& that ) : _sx( that._sx ), _sy( that._sy ), _sz( that._sz ), _length ( that._length ), _parent( that._parent ) {
+                RunLengthCodeBinary ( const RunLengthCodeBinary& that ) : _sx( that._sx ), _length ( that._length ), _parent( that._parent ) {
                         return ;
                 }
 
@@ -36,6 +42,9 @@ namespace mi
                         return this->_parent;
                 }
 
+                /**
+                 * @brief Check 26-connectivity with a run in the same or an adjacent row ( |dy| <= 1, |dz| <= 1 ).
+                 */
                 bool isConnected ( const RunLengthCodeBinary &that ) {
                         return this->is_connected_26( that );
                 }
@@ -44,23 +53,17 @@ namespace mi
                         return this->_length;
                 }
 
-                void get( short int &sx, short int &sy, short int &sz, short int& l ) {
+                void get( int &sx, int& l ) const {
                         sx = this->_sx;
-                        sy = this->_sy;
-                        sz = this->_sz;
                         l = this->_length;
                 }
         private:
                 bool is_connected_26 ( const RunLengthCodeBinary& that ) {
-                        const int dy = std::abs( this->_sy - that._sy );
-                        const int dz = std::abs( this->_sz - that._sz );
-                        if ( dy > 1 || dz > 1 ) return false;
+                        const int mn0 = this->_sx;
+                        const int mx0 = this->_sx + this->_length - 1;
 
-                        const short int mn0 = this->_sx;
-                        const short int mx0 = this->_sx + this->_length - 1;
-
-                        const short int mn1 = that._sx;
-                        const short int mx1 = that._sx + that._length - 1;
+                        const int mn1 = that._sx;
+                        const int mx1 = that._sx + that._length - 1;
 
                         if ( mn0 - 1 <= mn1 && mn1 <= mx0 + 1 ) return true;
                         if ( mn0 - 1 <= mx1 && mx1 <= mx0 + 1 ) return true;
@@ -1,56 +1,166 @@
 #ifndef MI_RUN_LENGTH_ENCODER_HPP
 #define MI_RUN_LENGTH_ENCODER_HPP 1
+#include <vector>
+#include <algorithm>
 #include <mi/VolumeData.hpp>
 #include <mi/RunLengthCodeBinary.hpp>
+#include <mi/ParallelFor.hpp>
 namespace mi
 {
+        /**
+         * @class RunLengthEncoder RunLengthEncoder.hpp <mi/RunLengthEncoder.hpp>
+         * @brief Encode volume data into runs along x.
+         *
+         * Slices are encoded in parallel into buffers of each thread. The row indices are computed from the
+         * number of runs of each row by a prefix sum and the buffers are concatenated in z order, so the codes
+         * are the same as those of serial encoding.
+         */
         template<typename T>
         class RunLengthEncoder
         {
         private:
                 const VolumeData<T>& _data;
+                int _nthread;
         public:
-                RunLengthEncoder ( const VolumeData<T>& data ) : _data( data ) {
+                RunLengthEncoder ( const VolumeData<T>& data ) : _data( data ), _nthread( 1 ) {
                         return;
                 }
-		
+
+                /**
+                 * @brief Set the number of threads.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                RunLengthEncoder<T>& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
+
+                /**
+                 * @brief Encode runs of voxels whose values are 1.
+                 *
+                 * The index of the first run of each row and the number of runs are appended to idx.
+                 * @return The number of runs in codes.
+                 */
                 int encode ( std::vector< RunLengthCodeBinary >& codes , std::vector<int>& idx ) {
-                        int count = 0;
                         const mi::Point3i& size = const_cast< VolumeData<T>& >( this->_data ).getInfo().getSize();
-                        idx.reserve( size.y() * size.z() );
-                        for( short int z = 0 ; z < size.z() ; ++z ) {
-                                for( short int y = 0 ; y < size.y() ; ++y ) {
-                                        idx.push_back( count );
-                                        short int start = 0;
-                                        char value0 = this->_data.get( 0,y,z );
-                                        short int length = 1;
-
-                                        for( int x = 1 ; x < size.x() ; ++x ) {
-                                                T value1 = this->_data.get( x,y,z );
-                                                if ( value0 == value1 ) {
-                                                        ++length;
-                                                } else {
-                                                        if ( value0 == 1 ) {
-                                                                RunLengthCodeBinary code( start, y, z, length );
-                                                                codes.push_back( code );
-                                                                ++count;
-                                                        }
-                                                        start = x;
-                                                        value0 = value1;
-                                                        length = 1;
+                        this->encode_slices( codes, idx, is_one(), 0, size.z() );
+                        idx.push_back( static_cast<int>( codes.size() ) );
+                        return static_cast<int>( codes.size() );
+                }
+
+                /**
+                 * @brief Encode runs of voxels at or above an isovalue in slices [zbegin, zend).
+                 *
+                 * The volume is thresholded while it is encoded, so no binary volume is needed. Runs and row
+                 * indices are appended, so slices can be encoded slab by slab in z order. The last index
+                 * ( the number of runs ) is not appended.
+                 * @return The number of runs in codes.
+                 */
+                int encode ( std::vector< RunLengthCodeBinary >& codes , std::vector<int>& idx, const T isovalue, const int zbegin, const int zend ) {
+                        this->encode_slices( codes, idx, is_above( isovalue ), zbegin, zend );
+                        return static_cast<int>( codes.size() );
+                }
+        private:
+                class is_one
+                {
+                public:
+                        bool operator () ( const T v ) const {
+                                return v == 1;
+                        }
+                };
+
+                class is_above
+                {
+                private:
+                        const T _isovalue;
+                public:
+                        explicit is_above ( const T isovalue ) : _isovalue( isovalue ) {
+                                return;
+                        }
+
+                        bool operator () ( const T v ) const {
+                                return !( v < this->_isovalue );
+                        }
+                };
+
+                template <class Predicate>
+                void encode_slices ( std::vector< RunLengthCodeBinary >& codes , std::vector<int>& idx, const Predicate& pred, const int zbegin, const int zend ) {
+                        if ( zend <= zbegin ) return;
+                        const mi::Point3i& size = const_cast< VolumeData<T>& >( this->_data ).getInfo().getSize();
+                        const int n = std::max( 1, std::min( this->_nthread, zend - zbegin ) );
+                        std::vector<std::vector<RunLengthCodeBinary> > buffers( n );
+                        std::vector<int> counts( static_cast<size_t>( zend - zbegin ) * size.y(), 0 ); // the number of runs of each row.
+                        std::vector<int> chunks( n );
+                        for ( int i = 0 ; i < n ; ++i ) chunks[i] = i;
+                        encode_fn<Predicate> fn( this->_data, pred, zbegin, zend, buffers, counts );
+                        if ( n == 1 ) fn( 0 );
+                        else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+
+                        // prefix sum
+                        int offset = static_cast<int>( codes.size() );
+                        idx.reserve( idx.size() + counts.size() + 1 );
+                        for ( size_t i = 0 ; i < counts.size() ; ++i ) {
+                                idx.push_back( offset );
+                                offset += counts[i];
+                        }
+                        if ( codes.empty() && n == 1 ) {
+                                codes.swap( buffers[0] );
+                                return;
+                        }
+                        codes.reserve( static_cast<size_t>( offset ) );
+                        for ( int i = 0 ; i < n ; ++i ) {
+                                codes.insert( codes.end(), buffers[i].begin(), buffers[i].end() );
+                                std::vector<RunLengthCodeBinary>().swap( buffers[i] );
+                        }
+                        return;
+                }
+
+                /**
+                 * @brief Encode a range of slices into the buffer of a chunk.
+                 */
+                template <class Predicate>
+                class encode_fn
+                {
+                private:
+                        const VolumeData<T>& _data;
+                        const Predicate& _pred;
+                        const int _zbegin;
+                        const int _zend;
+                        std::vector<std::vector<RunLengthCodeBinary> >& _buffers;
+                        std::vector<int>& _counts;
+                public:
+                        encode_fn ( const VolumeData<T>& data, const Predicate& pred, const int zbegin, const int zend,
+                                    std::vector<std::vector<RunLengthCodeBinary> >& buffers, std::vector<int>& counts ) :
+                                _data( data ), _pred( pred ), _zbegin( zbegin ), _zend( zend ), _buffers( buffers ), _counts( counts ) {
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                const mi::Point3i& size = const_cast< VolumeData<T>& >( this->_data ).getInfo().getSize();
+                                const int n = static_cast<int>( this->_buffers.size() );
+                                const int nz = this->_zend - this->_zbegin;
+                                const int zbegin = this->_zbegin + static_cast<int>( static_cast<long long>( nz ) * chunk / n );
+                                const int zend   = this->_zbegin + static_cast<int>( static_cast<long long>( nz ) * ( chunk + 1 ) / n );
+                                std::vector<RunLengthCodeBinary>& codes = this->_buffers[chunk];
+                                for( int z = zbegin ; z < zend ; ++z ) {
+                                        for( int y = 0 ; y < size.y() ; ++y ) {
+                                                const size_t before = codes.size();
+                                                const T* row = this->_data.getPointer( y, z );
+                                                int x = 0;
+                                                while ( x < size.x() ) {
+                                                        while ( x < size.x() && !this->_pred( row[x] ) ) ++x;
+                                                        if ( x == size.x() ) break;
+                                                        const int start = x;
+                                                        while ( x < size.x() && this->_pred( row[x] ) ) ++x;
+                                                        codes.push_back( RunLengthCodeBinary( start, x - start ) );
                                                 }
-                                        }
-					
-                                        if ( value0 == 1 ) {
-                                                RunLengthCodeBinary code1( start, y, z, length );
-                                                codes.push_back( code1 );
-                                                ++count;
+                                                this->_counts[ static_cast<size_t>( z - this->_zbegin ) * size.y() + y ] = static_cast<int>( codes.size() - before );
                                         }
                                 }
+                                return;
                         }
-                        idx.push_back( count );
-                        return count;
-                }
+                };
         };
 }
 #endif //MI_RUN_LENGTH_ENCODER_HPP
@@ -0,0 +1,553 @@
+/**
+ * @file RunLengthVolume.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_RUN_LENGTH_VOLUME_HPP
+#define MI_RUN_LENGTH_VOLUME_HPP 1
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include "VolumeInfo.hpp"
+#include "VolumeData.hpp"
+#include "ParallelFor.hpp"
+namespace mi
+{
+        /**
+         * @class RunLengthVolume RunLengthVolume.hpp <mi/RunLengthVolume.hpp>
+         * @brief Binary volume stored as runs of foreground voxels along x.
+         *
+         * Runs of a row are sorted, disjoint and not adjacent ( [begin, end) ). Rows are ordered by y and then z,
+         * and an index holds the first run of each row, as in RunLengthEncoder.
+         * Set operations, complement, and dilation and erosion by the 6-neighborhood or a sphere work row by row on
+         * runs, so no dense volume is expanded between operations. Output rows are computed in parallel by slices.
+         * Voxels outside the volume are background for dilation and foreground for erosion, as in VolumeDataUtility.
+         */
+        class RunLengthVolume
+        {
+        public:
+                struct Run {
+                        int begin; ///< First voxel.
+                        int end;   ///< Last voxel + 1.
+                };
+        private:
+                RunLengthVolume ( const RunLengthVolume& that );
+                void operator = ( const RunLengthVolume& that );
+        private:
+                VolumeInfo _info;
+                std::vector<size_t> _idx; ///< First run of each row ( y + z * sy ). The last one is the number of runs.
+                std::vector<Run> _runs;
+        public:
+                explicit RunLengthVolume ( void ) {
+                        this->init( VolumeInfo() );
+                        return;
+                }
+
+                /**
+                 * @brief Constructor. All voxels are background.
+                 * @param [in] info Volume information.
+                 */
+                explicit RunLengthVolume ( const VolumeInfo& info ) {
+                        this->init( info );
+                        return;
+                }
+
+                RunLengthVolume& init ( const VolumeInfo& info ) {
+                        this->_info.init( info.getSize(), info.getPitch(), info.getOrigin() );
+                        const Point3i& size = this->_info.getSize();
+                        this->_idx.assign( static_cast<size_t>( size.y() ) * size.z() + 1, 0 );
+                        std::vector<Run>().swap( this->_runs );
+                        return *this;
+                }
+
+                void swap ( RunLengthVolume& that ) {
+                        this->_info.swap( that._info );
+                        this->_idx.swap( that._idx );
+                        this->_runs.swap( that._runs );
+                        return;
+                }
+
+                inline VolumeInfo& getInfo ( void ) {
+                        return this->_info;
+                }
+
+                inline const VolumeInfo& getInfo ( void ) const {
+                        return this->_info;
+                }
+
+                inline size_t getNumRuns ( void ) const {
+                        return this->_runs.size();
+                }
+
+                /**
+                 * @brief Get runs of a row.
+                 * @param [in] y Y.
+                 * @param [in] z Z.
+                 * @param [out] n The number of runs.
+                 * @return The first run ( NULL when the row is empty ).
+                 */
+                inline const Run* getRow ( const int y, const int z, size_t& n ) const {
+                        const size_t row = static_cast<size_t>( y ) + static_cast<size_t>( z ) * this->_info.getSize().y();
+                        n = this->_idx[row + 1] - this->_idx[row];
+                        return n == 0 ? NULL : &this->_runs[ this->_idx[row] ];
+                }
+
+                /**
+                 * @brief Count foreground voxels.
+                 * @return The number of voxels.
+                 */
+                size_t getNumVoxels ( void ) const {
+                        size_t count = 0;
+                        for ( size_t i = 0 ; i < this->_runs.size() ; ++i ) count += static_cast<size_t>( this->_runs[i].end - this->_runs[i].begin );
+                        return count;
+                }
+
+                /**
+                 * @brief Encode voxels of value 1.
+                 * @param [in] data Binary data.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                template <class Volume>
+                RunLengthVolume& encode ( Volume& data, const int nthread = 1 ) {
+                        encode_row<Volume> fn( data );
+                        return this->build( data.getInfo(), fn, nthread );
+                }
+
+                /**
+                 * @brief Decode into binary data ( 1 : foreground, 0 : background ).
+                 * @param [out] data Binary data. It is initialized with the information of the runs and keeps its halo setting.
+                 * @param [in] nthread The number of threads.
+                 */
+                void decode ( VolumeData<char>& data, const int nthread = 1 ) const {
+                        data.init( this->_info );
+                        const int sz = this->_info.getSize().z();
+                        const int n = std::max( 1, std::min( nthread, sz ) );
+                        std::vector<int> chunks( n );
+                        for ( int i = 0 ; i < n ; ++i ) chunks[i] = i;
+                        decode_fn fn( *this, data, n );
+                        if ( n == 1 ) fn( 0 );
+                        else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                        return;
+                }
+
+                /**
+                 * @brief Union ( a or b ).
+                 */
+                static bool unite ( const RunLengthVolume& a, const RunLengthVolume& b, RunLengthVolume& out, const int nthread = 1 ) {
+                        return RunLengthVolume::combine<or_op>( a, b, out, nthread );
+                }
+
+                /**
+                 * @brief Intersection ( a and b ).
+                 */
+                static bool intersect ( const RunLengthVolume& a, const RunLengthVolume& b, RunLengthVolume& out, const int nthread = 1 ) {
+                        return RunLengthVolume::combine<and_op>( a, b, out, nthread );
+                }
+
+                /**
+                 * @brief Difference ( a and not b ).
+                 */
+                static bool subtract ( const RunLengthVolume& a, const RunLengthVolume& b, RunLengthVolume& out, const int nthread = 1 ) {
+                        return RunLengthVolume::combine<and_not_op>( a, b, out, nthread );
+                }
+
+                /**
+                 * @brief Complement in the volume.
+                 */
+                static bool complement ( const RunLengthVolume& a, RunLengthVolume& out, const int nthread = 1 ) {
+                        complement_row fn( a );
+                        RunLengthVolume result;
+                        result.build( a.getInfo(), fn, nthread );
+                        out.swap( result );
+                        return true;
+                }
+
+                /**
+                 * @brief Dilation by the 6-neighborhood.
+                 */
+                static bool dilate6 ( const RunLengthVolume& a, RunLengthVolume& out, const int nthread = 1 ) {
+                        std::vector<element> se;
+                        se.push_back( element( 0, 0, 1 ) );
+                        se.push_back( element( -1, 0, 0 ) );
+                        se.push_back( element( 1, 0, 0 ) );
+                        se.push_back( element( 0, -1, 0 ) );
+                        se.push_back( element( 0, 1, 0 ) );
+                        return RunLengthVolume::dilate_by( a, se, out, nthread );
+                }
+
+                /**
+                 * @brief Erosion by the 6-neighborhood.
+                 */
+                static bool erode6 ( const RunLengthVolume& a, RunLengthVolume& out, const int nthread = 1 ) {
+                        RunLengthVolume tmp;
+                        RunLengthVolume::complement( a, tmp, nthread );
+                        RunLengthVolume::dilate6( tmp, out, nthread );
+                        return RunLengthVolume::complement( out, out, nthread );
+                }
+
+                /**
+                 * @brief Dilation by a sphere. Rows of the input are expanded by the half width of the sphere at each ( dy, dz ).
+                 * @param [in] a Input.
+                 * @param [out] out Output.
+                 * @param [in] r Radius ( the same unit as the pitch ). The sphere is the same as mi::dilate_padded.
+                 * @param [in] nthread The number of threads.
+                 */
+                static bool dilate ( const RunLengthVolume& a, RunLengthVolume& out, const double r, const int nthread = 1 ) {
+                        std::vector<element> se;
+                        RunLengthVolume::create_sphere( a.getInfo().getPitch(), r, false, se );
+                        return RunLengthVolume::dilate_by( a, se, out, nthread );
+                }
+
+                /**
+                 * @brief Erosion by a sphere ( complement of the dilation of the complement ).
+                 * @param [in] a Input.
+                 * @param [out] out Output.
+                 * @param [in] r Radius. The sphere is the same as mi::erode_padded.
+                 * @param [in] nthread The number of threads.
+                 */
+                static bool erode ( const RunLengthVolume& a, RunLengthVolume& out, const double r, const int nthread = 1 ) {
+                        std::vector<element> se;
+                        RunLengthVolume::create_sphere( a.getInfo().getPitch(), r, true, se );
+                        RunLengthVolume tmp;
+                        RunLengthVolume::complement( a, tmp, nthread );
+                        RunLengthVolume::dilate_by( tmp, se, out, nthread );
+                        return RunLengthVolume::complement( out, out, nthread );
+                }
+
+                /**
+                 * @brief Build runs from a row function. fn( y, z, runs, work ) appends canonical runs of row ( y, z ).
+                 * work is a buffer kept by each thread.
+                 * Each chunk of slices is built into its own buffer, and buffers are concatenated.
+                 * @param [in] info Volume information.
+                 * @param [in] fn Row function. It is called from several threads.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                template <class RowFunction>
+                RunLengthVolume& build ( const VolumeInfo& info, RowFunction& fn, const int nthread ) {
+                        this->init( info );
+                        const Point3i& size = this->_info.getSize();
+                        const int n = std::max( 1, std::min( nthread, size.z() ) );
+                        std::vector<std::vector<Run> > buffers( n );
+                        std::vector<int> chunks( n );
+                        for ( int i = 0 ; i < n ; ++i ) chunks[i] = i;
+                        build_fn<RowFunction> bfn( fn, size, this->_idx, buffers );
+                        if ( n == 1 ) bfn( 0 );
+                        else mi::parallel_for_each( chunks.begin(), chunks.end(), bfn, 1 );
+
+                        // counts of rows -> positions.
+                        const size_t numRows = this->_idx.size() - 1;
+                        size_t count = 0;
+                        for ( size_t i = 0 ; i < numRows ; ++i ) {
+                                const size_t c = this->_idx[i];
+                                this->_idx[i] = count;
+                                count += c;
+                        }
+                        this->_idx[numRows] = count;
+                        if ( n == 1 ) {
+                                this->_runs.swap( buffers[0] );
+                        } else {
+                                this->_runs.reserve( count );
+                                for ( int i = 0 ; i < n ; ++i ) {
+                                        this->_runs.insert( this->_runs.end(), buffers[i].begin(), buffers[i].end() );
+                                        std::vector<Run>().swap( buffers[i] );
+                                }
+                        }
+                        return *this;
+                }
+        private:
+                /**
+                 * @brief Row offset and half width of a structuring element.
+                 */
+                struct element {
+                        int dy;
+                        int dz;
+                        int w; ///< Runs are expanded by w voxels on both sides.
+                        element ( const int y, const int z, const int width ) : dy( y ), dz( z ), w( width ) {
+                                return;
+                        }
+                };
+
+                struct or_op {
+                        static bool apply ( const bool a, const bool b ) {
+                                return a || b;
+                        }
+                };
+
+                struct and_op {
+                        static bool apply ( const bool a, const bool b ) {
+                                return a && b;
+                        }
+                };
+
+                struct and_not_op {
+                        static bool apply ( const bool a, const bool b ) {
+                                return a && !b;
+                        }
+                };
+
+                /**
+                 * @brief Rows of the sphere. isErosion selects the expression of mi::erode_padded, otherwise that of mi::dilate_padded.
+                 */
+                static void create_sphere ( const Point3d& pitch, const double r, const bool isErosion, std::vector<element>& se ) {
+                        const int rx = static_cast<int>( std::ceil ( r * 1.0 / pitch.x() ) );
+                        const int ry = static_cast<int>( std::ceil ( r * 1.0 / pitch.y() ) );
+                        const int rz = static_cast<int>( std::ceil ( r * 1.0 / pitch.z() ) );
+                        for ( int dz = -rz ; dz <= rz ; ++dz ) {
+                                for ( int dy = -ry ; dy <= ry ; ++dy ) {
+                                        int w = -1;
+                                        for ( int dx = 0 ; dx <= rx ; ++dx ) {
+                                                double d;
+                                                if ( isErosion ) {
+                                                        d = dx * dx * pitch.x() * pitch.x() + dy * dy * pitch.y() * pitch.y()+ dz * dz * pitch.z() * pitch.z();
+                                                } else {
+                                                        const double vx = dx * pitch.x();
+                                                        const double vy = dy * pitch.y();
+                                                        const double vz = dz * pitch.z();
+                                                        d = vx * vx + vy * vy + vz * vz;
+                                                }
+                                                if ( r * r < d ) break;
+                                                w = dx;
+                                        }
+                                        if ( w >= 0 ) se.push_back( element( dy, dz, w ) );
+                                }
+                        }
+                        return;
+                }
+
+                template <class Op>
+                static bool combine ( const RunLengthVolume& a, const RunLengthVolume& b, RunLengthVolume& out, const int nthread ) {
+                        if ( a.getInfo().getSize() != b.getInfo().getSize() ) {
+                                std::cerr<<"sizes of run-length volumes are different."<<std::endl;
+                                return false;
+                        }
+                        combine_row<Op> fn( a, b );
+                        RunLengthVolume result;
+                        result.build( a.getInfo(), fn, nthread );
+                        out.swap( result );
+                        return true;
+                }
+
+                static bool dilate_by ( const RunLengthVolume& a, const std::vector<element>& se, RunLengthVolume& out, const int nthread ) {
+                        dilate_row fn( a, se );
+                        RunLengthVolume result;
+                        result.build( a.getInfo(), fn, nthread );
+                        out.swap( result );
+                        return true;
+                }
+
+                template <class RowFunction>
+                class build_fn
+                {
+                private:
+                        RowFunction& _fn;
+                        const Point3i _size;
+                        std::vector<size_t>& _count;
+                        std::vector<std::vector<Run> >& _buffers;
+                public:
+                        build_fn ( RowFunction& fn, const Point3i& size, std::vector<size_t>& count, std::vector<std::vector<Run> >& buffers ) :
+                                _fn( fn ), _size( size ), _count( count ), _buffers( buffers ) {
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                const int n = static_cast<int>( this->_buffers.size() );
+                                const int zbegin = static_cast<int>( static_cast<long long>( this->_size.z() ) * chunk / n );
+                                const int zend   = static_cast<int>( static_cast<long long>( this->_size.z() ) * ( chunk + 1 ) / n );
+                                std::vector<Run>& runs = this->_buffers[chunk];
+                                std::vector<Run> work; // buffer of row functions.
+                                for ( int z = zbegin ; z < zend ; ++z ) {
+                                        for ( int y = 0 ; y < this->_size.y() ; ++y ) {
+                                                const size_t before = runs.size();
+                                                this->_fn( y, z, runs, work );
+                                                this->_count[ static_cast<size_t>( y ) + static_cast<size_t>( z ) * this->_size.y() ] = runs.size() - before;
+                                        }
+                                }
+                                return;
+                        }
+                };
+
+                template <class Volume>
+                class encode_row
+                {
+                private:
+                        Volume& _data;
+                public:
+                        explicit encode_row ( Volume& data ) : _data( data ) {
+                                return;
+                        }
+
+                        void operator () ( const int y, const int z, std::vector<Run>& runs, std::vector<Run>& /*work*/ ) const {
+                                const int sx = this->_data.getInfo().getSize().x();
+                                const char* row = this->_data.getPointer( y, z );
+                                int x = 0;
+                                while ( x < sx ) {
+                                        while ( x < sx && row[x] != 1 ) ++x;
+                                        if ( x == sx ) break;
+                                        Run run;
+                                        run.begin = x;
+                                        while ( x < sx && row[x] == 1 ) ++x;
+                                        run.end = x;
+                                        runs.push_back( run );
+                                }
+                                return;
+                        }
+                };
+
+                class decode_fn
+                {
+                private:
+                        const RunLengthVolume& _runs;
+                        VolumeData<char>& _data;
+                        const int _numChunks;
+                public:
+                        decode_fn ( const RunLengthVolume& runs, VolumeData<char>& data, const int numChunks ) : _runs( runs ), _data( data ), _numChunks( numChunks ) {
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                const Point3i& size = this->_runs.getInfo().getSize();
+                                const int zbegin = static_cast<int>( static_cast<long long>( size.z() ) * chunk / this->_numChunks );
+                                const int zend   = static_cast<int>( static_cast<long long>( size.z() ) * ( chunk + 1 ) / this->_numChunks );
+                                for ( int z = zbegin ; z < zend ; ++z ) {
+                                        for ( int y = 0 ; y < size.y() ; ++y ) {
+                                                size_t n;
+                                                const Run* r = this->_runs.getRow( y, z, n );
+                                                char* row = this->_data.getPointer( y, z );
+                                                for ( size_t i = 0 ; i < n ; ++i ) std::fill( row + r[i].begin, row + r[i].end, 1 );
+                                        }
+                                }
+                                return;
+                        }
+                };
+
+                /**
+                 * @brief Merge boundaries of two rows and keep intervals where Op is true.
+                 */
+                template <class Op>
+                class combine_row
+                {
+                private:
+                        const RunLengthVolume& _a;
+                        const RunLengthVolume& _b;
+                public:
+                        combine_row ( const RunLengthVolume& a, const RunLengthVolume& b ) : _a( a ), _b( b ) {
+                                return;
+                        }
+
+                        void operator () ( const int y, const int z, std::vector<Run>& runs, std::vector<Run>& /*work*/ ) const {
+                                size_t na, nb;
+                                const Run* ra = this->_a.getRow( y, z, na );
+                                const Run* rb = this->_b.getRow( y, z, nb );
+                                const int inf = std::numeric_limits<int>::max();
+                                size_t i = 0, j = 0; // boundaries : 2k = begin of run k, 2k + 1 = end of run k.
+                                bool inA = false, inB = false, current = false;
+                                Run run;
+                                run.begin = 0;
+                                for ( ;; ) {
+                                        const int pa = i < 2 * na ? ( ( i & 1 ) ? ra[i / 2].end : ra[i / 2].begin ) : inf;
+                                        const int pb = j < 2 * nb ? ( ( j & 1 ) ? rb[j / 2].end : rb[j / 2].begin ) : inf;
+                                        const int p = std::min( pa, pb );
+                                        if ( p == inf ) break;
+                                        if ( pa == p ) {
+                                                inA = !inA;
+                                                ++i;
+                                        }
+                                        if ( pb == p ) {
+                                                inB = !inB;
+                                                ++j;
+                                        }
+                                        const bool v = Op::apply( inA, inB );
+                                        if ( v == current ) continue;
+                                        if ( v ) {
+                                                run.begin = p;
+                                        } else {
+                                                run.end = p;
+                                                runs.push_back( run );
+                                        }
+                                        current = v;
+                                }
+                                return;
+                        }
+                };
+
+                class complement_row
+                {
+                private:
+                        const RunLengthVolume& _a;
+                public:
+                        explicit complement_row ( const RunLengthVolume& a ) : _a( a ) {
+                                return;
+                        }
+
+                        void operator () ( const int y, const int z, std::vector<Run>& runs, std::vector<Run>& /*work*/ ) const {
+                                const int sx = this->_a.getInfo().getSize().x();
+                                size_t n;
+                                const Run* r = this->_a.getRow( y, z, n );
+                                Run run;
+                                run.begin = 0;
+                                for ( size_t i = 0 ; i < n ; ++i ) {
+                                        run.end = r[i].begin;
+                                        if ( run.begin < run.end ) runs.push_back( run );
+                                        run.begin = r[i].end;
+                                }
+                                run.end = sx;
+                                if ( run.begin < run.end ) runs.push_back( run );
+                                return;
+                        }
+                };
+
+                /**
+                 * @brief Union of rows at ( y + dy, z + dz ) expanded by w. Expanded runs are sorted and merged.
+                 */
+                class dilate_row
+                {
+                private:
+                        const RunLengthVolume& _a;
+                        const std::vector<element>& _se;
+                public:
+                        dilate_row ( const RunLengthVolume& a, const std::vector<element>& se ) : _a( a ), _se( se ) {
+                                return;
+                        }
+
+                        void operator () ( const int y, const int z, std::vector<Run>& runs, std::vector<Run>& work ) const {
+                                const Point3i& size = this->_a.getInfo().getSize();
+                                std::vector<Run>& expanded = work;
+                                expanded.clear();
+                                for ( size_t k = 0 ; k < this->_se.size() ; ++k ) {
+                                        const element& e = this->_se[k];
+                                        const int ny = y + e.dy;
+                                        const int nz = z + e.dz;
+                                        if ( ny < 0 || ny >= size.y() || nz < 0 || nz >= size.z() ) continue;
+                                        size_t n;
+                                        const Run* r = this->_a.getRow( ny, nz, n );
+                                        for ( size_t i = 0 ; i < n ; ++i ) {
+                                                Run run;
+                                                run.begin = std::max( 0, r[i].begin - e.w );
+                                                run.end = std::min( size.x(), r[i].end + e.w );
+                                                expanded.push_back( run );
+                                        }
+                                }
+                                if ( expanded.empty() ) return;
+                                std::sort( expanded.begin(), expanded.end(), dilate_row::less );
+                                Run current = expanded[0];
+                                for ( size_t i = 1 ; i < expanded.size() ; ++i ) {
+                                        if ( expanded[i].begin <= current.end ) { // overlapping or adjacent.
+                                                current.end = std::max( current.end, expanded[i].end );
+                                        } else {
+                                                runs.push_back( current );
+                                                current = expanded[i];
+                                        }
+                                }
+                                runs.push_back( current );
+                                return;
+                        }
+                private:
+                        static bool less ( const Run& a, const Run& b ) {
+                                return a.begin < b.begin;
+                        }
+                };
+        };
+}
+#endif// MI_RUN_LENGTH_VOLUME_HPP
@@ -0,0 +1,240 @@
+/**
+ * @file SparseVolumeData.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_SPARSE_VOLUME_DATA_HPP
+#define MI_SPARSE_VOLUME_DATA_HPP 1
+#include <vector>
+#include <algorithm>
+#include "VolumeInfo.hpp"
+#include "VolumeData.hpp"
+namespace mi
+{
+        /**
+         * @class SparseVolumeData SparseVolumeData.hpp <mi/SparseVolumeData.hpp>
+         * @brief Volume data that stores only bricks containing non-background voxels.
+         *
+         * The volume is divided into B x B x B bricks. A brick is allocated when a non-background value is
+         * set in it; voxels in other bricks read as the background value. A directory of brick indices
+         * ( 4 bytes per brick ) gives constant-time access, so read accessors ( get(), getInfo(), getSize()
+         * and isReadable() ) can replace those of VolumeData in read-only stages such as masks.
+         * set() is not thread-safe. B must be a power of two.
+         */
+        template <typename T, int B = 16>
+        class SparseVolumeData
+        {
+                static_assert( B > 0 && ( B & ( B - 1 ) ) == 0, "brick size must be a power of two." );
+        private:
+                SparseVolumeData ( const SparseVolumeData<T, B>& that );
+                void operator = ( const SparseVolumeData<T, B>& that );
+        private:
+                static const int SHIFT = ( B >= 64 ) ? 6 : ( B >= 32 ) ? 5 : ( B >= 16 ) ? 4 : ( B >= 8 ) ? 3 : ( B >= 4 ) ? 2 : ( B >= 2 ) ? 1 : 0;
+                static const int MASK = B - 1;
+                static_assert( ( 1 << SHIFT ) == B, "brick size is too large." );
+        private:
+                VolumeInfo _info;
+                T _background; ///< Value of voxels in unallocated bricks.
+                std::vector<int> _directory; ///< Index to _bricks per brick ( -1 : not allocated ).
+                std::vector< std::vector<T> > _bricks; ///< Allocated bricks.
+                size_t _nbx; ///< The number of bricks ( x ).
+                size_t _nby; ///< The number of bricks ( y ).
+                bool _isReadable;
+        public:
+                explicit SparseVolumeData ( void ) : _background( T() ), _nbx( 0 ), _nby( 0 ), _isReadable( false ) {
+                        return;
+                }
+
+                explicit SparseVolumeData ( const VolumeInfo& info, const T background = T() ) : _background( background ), _nbx( 0 ), _nby( 0 ), _isReadable( false ) {
+                        this->init( info, background );
+                        return;
+                }
+
+                /**
+                 * @brief Initialize the volume. All voxels become the background value.
+                 * @param [in] info Volume information.
+                 * @param [in] background Background value.
+                 * @return Instance itself.
+                 */
+                SparseVolumeData& init ( const VolumeInfo& info, const T background = T() ) {
+                        this->_info.init( info.getSize(), info.getPitch(), info.getOrigin() );
+                        this->_background = background;
+                        const Point3i& size = this->_info.getSize();
+                        this->_nbx = static_cast<size_t>( ( size.x() + MASK ) >> SHIFT );
+                        this->_nby = static_cast<size_t>( ( size.y() + MASK ) >> SHIFT );
+                        const size_t nbz = static_cast<size_t>( ( size.z() + MASK ) >> SHIFT );
+                        this->_directory.assign( this->_nbx * this->_nby * nbz, -1 );
+                        std::vector< std::vector<T> >().swap( this->_bricks );
+                        this->_isReadable = true;
+                        return *this;
+                }
+
+                /**
+                 * @brief Release all bricks.
+                 */
+                void clear ( void ) {
+                        std::fill( this->_directory.begin(), this->_directory.end(), -1 );
+                        std::vector< std::vector<T> >().swap( this->_bricks );
+                        return;
+                }
+
+                inline bool isReadable ( void ) const {
+                        return this->_isReadable;
+                }
+
+                inline VolumeInfo& getInfo ( void ) {
+                        return this->_info;
+                }
+
+                inline Point3i getSize ( void ) {
+                        return this->getInfo().getSize();
+                }
+
+                inline T getBackground ( void ) const {
+                        return this->_background;
+                }
+
+                /**
+                 * @brief Get the number of bricks covering the volume.
+                 * @return The number of bricks.
+                 */
+                inline size_t getNumBricks ( void ) const {
+                        return this->_directory.size();
+                }
+
+                /**
+                 * @brief Get the number of allocated bricks.
+                 * @return The number of bricks.
+                 */
+                inline size_t getNumAllocatedBricks ( void ) const {
+                        return this->_bricks.size();
+                }
+
+                /**
+                 * @brief Get memory used by the directory and the bricks.
+                 * @return Size ( byte ).
+                 */
+                size_t getBytes ( void ) const {
+                        return sizeof( int ) * this->_directory.size() + ( sizeof( T ) << ( 3 * SHIFT ) ) * this->_bricks.size();
+                }
+
+                /**
+                 * @brief Get the brick size.
+                 * @return B.
+                 */
+                static inline int getBrickSize ( void ) {
+                        return B;
+                }
+
+                /**
+                 * @brief Get the brick containing a voxel.
+                 * @param [in] x X coordinate.
+                 * @param [in] y Y coordinate.
+                 * @param [in] z Z coordinate.
+                 * @return Pointer to the first voxel of the brick ( x-fastest, B voxels per row and B * B voxels per slice ). NULL if it is not allocated.
+                 */
+                inline const T* getBrick ( const int x, const int y, const int z ) const {
+                        const int id = this->_directory[ this->get_brick( x, y, z ) ];
+                        if ( id < 0 ) return NULL;
+                        return &this->_bricks[ static_cast<size_t>( id ) ][0];
+                }
+
+                inline T get ( const Point3i& p ) const {
+                        return this->get( p.x(), p.y(), p.z() );
+                }
+
+                inline T get ( const int x, const int y, const int z ) const {
+                        const int id = this->_directory[ this->get_brick( x, y, z ) ];
+                        if ( id < 0 ) return this->_background;
+                        return this->_bricks[ static_cast<size_t>( id ) ][ SparseVolumeData<T, B>::get_local( x, y, z ) ];
+                }
+
+                /**
+                 * @brief Get the value at a neighbor.
+                 * @param [in] p Position.
+                 * @param [in] d Offset to the neighbor.
+                 * @return Value at p + d.
+                 */
+                inline T get ( const Point3i& p, const Point3i& d ) const {
+                        return this->get( p.x() + d.x(), p.y() + d.y(), p.z() + d.z() );
+                }
+
+                inline void set ( const Point3i& p, const T v ) {
+                        this->set( p.x(), p.y(), p.z(), v );
+                        return;
+                }
+
+                /**
+                 * @brief Set a value. Setting the background value to an unallocated brick allocates nothing.
+                 * @param [in] x X coordinate.
+                 * @param [in] y Y coordinate.
+                 * @param [in] z Z coordinate.
+                 * @param [in] v Value.
+                 */
+                inline void set ( const int x, const int y, const int z, const T v ) {
+                        int& id = this->_directory[ this->get_brick( x, y, z ) ];
+                        if ( id < 0 ) {
+                                if ( v == this->_background ) return;
+                                id = static_cast<int>( this->_bricks.size() );
+                                this->_bricks.push_back( std::vector<T>( static_cast<size_t>( 1 ) << ( 3 * SHIFT ), this->_background ) );
+                        }
+                        this->_bricks[ static_cast<size_t>( id ) ][ SparseVolumeData<T, B>::get_local( x, y, z ) ] = v;
+                        return;
+                }
+
+                /**
+                 * @brief Copy non-background voxels from volume data.
+                 * @param [in] src Source.
+                 * @param [in] background Background value.
+                 * @retval true Success.
+                 * @retval false Source is not readable.
+                 */
+                bool copyFrom ( const VolumeData<T>& src, const T background = T() ) {
+                        if ( !src.isReadable() ) return false;
+                        this->init( const_cast<VolumeData<T>&>( src ).getInfo(), background );
+                        const Point3i size = this->_info.getSize();
+                        for ( int z = 0 ; z < size.z() ; ++z ) {
+                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                        const T* row = src.getPointer( y, z );
+                                        for ( int x = 0 ; x < size.x() ; ++x ) {
+                                                if ( row[x] != background ) this->set( x, y, z, row[x] );
+                                        }
+                                }
+                        }
+                        return true;
+                }
+
+                /**
+                 * @brief Copy voxels to volume data.
+                 * @param [out] dst Destination. It is initialized with the same information.
+                 * @retval true Success.
+                 * @retval false This volume is not readable.
+                 */
+                bool copyTo ( VolumeData<T>& dst ) {
+                        if ( !this->isReadable() ) return false;
+                        dst.init( this->_info );
+                        dst.fill( this->_background );
+                        const Point3i size = this->_info.getSize();
+                        for ( int z = 0 ; z < size.z() ; ++z ) {
+                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                        T* row = dst.getPointer( y, z );
+                                        for ( int x = 0 ; x < size.x() ; x += B ) {
+                                                const int id = this->_directory[ this->get_brick( x, y, z ) ];
+                                                if ( id < 0 ) continue;
+                                                const T* src = &this->_bricks[ static_cast<size_t>( id ) ][ SparseVolumeData<T, B>::get_local( x, y, z ) ];
+                                                std::copy( src, src + std::min( B, size.x() - x ), row + x );
+                                        }
+                                }
+                        }
+                        return true;
+                }
+        private:
+                inline size_t get_brick ( const int x, const int y, const int z ) const {
+                        return ( static_cast<size_t>( z >> SHIFT ) * this->_nby + static_cast<size_t>( y >> SHIFT ) ) * this->_nbx + static_cast<size_t>( x >> SHIFT );
+                }
+
+                static inline size_t get_local ( const int x, const int y, const int z ) {
+                        return ( static_cast<size_t>( ( ( z & MASK ) << SHIFT ) | ( y & MASK ) ) << SHIFT ) | static_cast<size_t>( x & MASK );
+                }
+        };
+}
+#endif// MI_SPARSE_VOLUME_DATA_HPP
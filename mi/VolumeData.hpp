@@ -6,49 +6,74 @@
 #define MI_VOLUME_DATA_HPP 1
 #include <iterator>
 #include <iostream>
+#include <utility>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <cstddef>
 #include "VolumeInfo.hpp"
 
 namespace mi
 {
         /**
          * @class VolumeData VolumeData.hpp <mi/VolumeData.hpp>
+         * @brief Volume data.
+         *
+         * Voxels are stored in x-fastest order. Optionally the volume is surrounded by a halo of
+         * padding voxels ( setHalo() ) holding a border value, so that kernels can read neighbors
+         * of any voxel through linear offsets ( getStrideY(), getStrideZ() ) without bounds checks.
+         * With a halo, each row is contiguous but rows are separated by padding voxels.
          */
         template <typename T>
         class VolumeData
         {
         public :
+                /**
+                 * @brief Iterator over rows of voxels. Padding voxels between rows are skipped.
+                 */
                 class iterator :  public std::iterator<std::input_iterator_tag, T>
                 {
                 private:
-                        std::vector<std::vector<std::vector<T> > >* _data;
-                        typename std::vector<T>::iterator _iterX;
-                        typename std::vector<std::vector<T> >::iterator _iterY;
-                        typename std::vector<std::vector<std::vector<T> > >::iterator _iterZ;
+                        T* _ptr;
+                        T* _rowEnd; ///< End of the current row.
+                        ptrdiff_t _length; ///< Voxels in a row.
+                        ptrdiff_t _strideY;
+                        ptrdiff_t _strideZ;
+                        size_t _row; ///< Index of the current row.
+                        size_t _numRowsY; ///< Rows in a slice.
+                        size_t _numRows;
                 public:
-                        explicit iterator( std::vector<std::vector<std::vector<T> > >* data, bool isBegin = true ) : _data( data ) {
-                                if( isBegin ) {
-                                        this->_iterZ = this->_data->begin();
-                                        if( this->_iterZ != this->_data->end() ) {
-                                                this->_iterY = this->_iterZ->begin();
-                                                if( this->_iterY != this->_iterZ->end() ) {
-                                                        this->_iterX = this->_iterY->begin();
-                                                }
-                                        }
-                                } else {
-                                        this->_iterZ = this->_data->end();
-                                }
+                        /**
+                         * @brief Constructor.
+                         * @param [in] ptr First voxel of the row.
+                         * @param [in] row Index of the row.
+                         * @param [in] length Voxels in a row.
+                         * @param [in] strideY Distance between rows.
+                         * @param [in] strideZ Distance between slices.
+                         * @param [in] numRowsY Rows in a slice.
+                         * @param [in] numRows Rows in the volume.
+                         */
+                        explicit iterator( T* ptr, const size_t row = 0, const ptrdiff_t length = 0, const ptrdiff_t strideY = 0, const ptrdiff_t strideZ = 0,
+                                           const size_t numRowsY = 1, const size_t numRows = 0 ) :
+                                _ptr( ptr ), _rowEnd( ptr + length ), _length( length ), _strideY( strideY ), _strideZ( strideZ ),
+                                _row( row ), _numRowsY( numRowsY ), _numRows( numRows ) {
                                 return;
                         }
 
-                        iterator( const iterator& that ) : _data( that._data ), _iterX( that._iterX ), _iterY( that._iterY ), _iterZ( that._iterZ ) {
+                        iterator( const iterator& that ) : _ptr( that._ptr ), _rowEnd( that._rowEnd ), _length( that._length ), _strideY( that._strideY ),
+                                _strideZ( that._strideZ ), _row( that._row ), _numRowsY( that._numRowsY ), _numRows( that._numRows ) {
                                 return;
                         }
 
                         iterator& operator = ( const iterator& that ) {
-                                this->_data = that._data;
-                                this->_iterX = that._iterX;
-                                this->_iterY = that._iterY;
-                                this->_iterZ = that._iterZ;
+                                this->_ptr = that._ptr;
+                                this->_rowEnd = that._rowEnd;
+                                this->_length = that._length;
+                                this->_strideY = that._strideY;
+                                this->_strideZ = that._strideZ;
+                                this->_row = that._row;
+                                this->_numRowsY = that._numRowsY;
+                                this->_numRows = that._numRows;
                                 return *this;
                         }
 
@@ -57,19 +82,14 @@ namespace mi
                         }
 
                         iterator& operator++() {
-                                if( this->_iterZ == this->_data->end() ) return *this;
-                                //if( this->_iterY == this->_iterZ->end() ) return *this;
-                                //if( this->_iterX == this->_iterY->end() ) return *this;
-
-                                ++ ( this->_iterX );
-                                if( this->_iterX == this->_iterY->end() ) {
-                                        ++ ( this->_iterY );
-                                        if( this->_iterY == this->_iterZ->end() ) {
-                                                ++ ( this->_iterZ );
-                                                if ( this->_iterZ == this->_data->end() ) return *this;
-                                                this->_iterY = this->_iterZ->begin();
-                                        }
-                                        this->_iterX = this->_iterY->begin();
+                                ++ ( this->_ptr );
+                                if ( this->_ptr == this->_rowEnd && this->_row + 1 < this->_numRows ) { // the end stays at the end of the last row.
+                                        ++ ( this->_row );
+                                        T* start = this->_rowEnd - this->_length;
+                                        if ( this->_row % this->_numRowsY == 0 ) start += this->_strideZ - static_cast<ptrdiff_t>( this->_numRowsY - 1 ) * this->_strideY;
+                                        else start += this->_strideY;
+                                        this->_ptr = start;
+                                        this->_rowEnd = start + this->_length;
                                 }
                                 return *this;
                         }
@@ -80,12 +100,12 @@ namespace mi
                                 return tmp;
                         }
 
-                        bool operator == ( const iterator& rhs ) {
-                                return this->is_same( rhs );
+                        bool operator == ( const iterator& rhs ) const {
+                                return this->_ptr == rhs._ptr;
                         }
 
-                        bool operator != ( const iterator& rhs ) {
-                                return ! this->is_same( rhs );
+                        bool operator != ( const iterator& rhs ) const {
+                                return this->_ptr != rhs._ptr;
                         }
 
                         iterator operator + ( const int n ) {
@@ -95,55 +115,88 @@ namespace mi
                         }
 
                         iterator& operator += ( const int n ) {
-                                for ( int i = 0 ; i < n ; ++i ) {
-                                        ++ ( *this );
+                                ptrdiff_t m = n;
+                                while ( m > 0 ) {
+                                        const ptrdiff_t left = this->_rowEnd - this->_ptr;
+                                        if ( m < left || this->_row + 1 >= this->_numRows ) {
+                                                this->_ptr += m;
+                                                break;
+                                        }
+                                        this->_ptr += left - 1;
+                                        m -= left;
+                                        this->operator++();
                                 }
                                 return *this;
                         }
 
                         T& operator*( void ) {
-                                return *( this->_iterX );
-                        }
-                private:
-                        bool is_same ( const iterator& rhs ) {
-                                if ( this->is_end() ) {
-                                        return rhs.is_end();
-                                } else {
-                                        return ( this->_iterX == rhs._iterX &&
-                                                 this->_iterY == rhs._iterY &&
-                                                 this->_iterZ == rhs._iterZ );
-                                }
-                        }
-                        bool is_end() const {
-                                return ( this->_iterZ == this->_data->end() );
+                                return *( this->_ptr );
                         }
                 };
         private:
                 VolumeData( const VolumeData<T>& that );
                 void operator = ( const VolumeData<T>& that );
         public:
-                explicit VolumeData ( void ) : _isReadable ( false ) {
+                explicit VolumeData ( void ) : _sx ( 0 ), _sxy ( 0 ), _base ( 0 ), _halo ( 0 ), _border ( T() ), _isReadable ( false ) {
                         return;
                 }
 
-                explicit VolumeData ( const int x, const int y, const int z , const bool allocateMemory = true ) : _isReadable ( false ) {
+                explicit VolumeData ( const int x, const int y, const int z , const bool allocateMemory = true ) : _sx ( 0 ), _sxy ( 0 ), _base ( 0 ), _halo ( 0 ), _border ( T() ), _isReadable ( false ) {
                         const Point3i size( x,y,z );
                         const VolumeInfo info( size );
                         this->init ( info, allocateMemory );
                         return;
                 }
 
-                explicit VolumeData ( const Point3i& size, const bool allocateMemory = true ) : _isReadable ( false ) {
+                explicit VolumeData ( const Point3i& size, const bool allocateMemory = true ) : _sx ( 0 ), _sxy ( 0 ), _base ( 0 ), _halo ( 0 ), _border ( T() ), _isReadable ( false ) {
                         const VolumeInfo info( size );
                         this->init ( info, allocateMemory );
                         return;
                 }
 
-                explicit VolumeData ( const VolumeInfo& info, const bool allocateMemory = true ) : _isReadable ( false ) {
+                explicit VolumeData ( const VolumeInfo& info, const bool allocateMemory = true ) : _sx ( 0 ), _sxy ( 0 ), _base ( 0 ), _halo ( 0 ), _border ( T() ), _isReadable ( false ) {
                         this->init ( info, allocateMemory );
                         return;
                 }
 
+                /**
+                 * @brief Move constructor. The source becomes empty.
+                 * @param [in,out] that Instance.
+                 */
+                VolumeData ( VolumeData<T>&& that ) : _sx ( 0 ), _sxy ( 0 ), _base ( 0 ), _halo ( 0 ), _border ( T() ), _isReadable ( false ) {
+                        this->swap( that );
+                        return;
+                }
+
+                /**
+                 * @brief Move assignment. The source becomes empty.
+                 * @param [in,out] that Instance.
+                 * @return Instance itself.
+                 */
+                VolumeData<T>& operator = ( VolumeData<T>&& that ) {
+                        if ( this != &that ) {
+                                this->init( VolumeInfo(), false );
+                                this->swap( that );
+                        }
+                        return *this;
+                }
+
+                /**
+                 * @brief Exchange the contents ( information and voxels ) with another volume without copying voxels.
+                 * @param [in,out] that Instance.
+                 */
+                void swap ( VolumeData<T>& that ) {
+                        this->_info.swap( that._info );
+                        this->_data.swap( that._data );
+                        std::swap( this->_sx, that._sx );
+                        std::swap( this->_sxy, that._sxy );
+                        std::swap( this->_base, that._base );
+                        std::swap( this->_halo, that._halo );
+                        std::swap( this->_border, that._border );
+                        std::swap( this->_isReadable, that._isReadable );
+                        return;
+                }
+
                 virtual ~VolumeData ( void ) {
                         return;
                 }
@@ -160,13 +213,90 @@ namespace mi
                         return *this;
                 }
 
+                /**
+                 * @brief Fill voxels with a value. The halo keeps the border value.
+                 * @param [in] value Value.
+                 * @return Instance itself.
+                 */
                 VolumeData& fill ( const T& value ) {
-                        for ( VolumeData::iterator iter = this->begin() ; iter != this->end() ; ++iter ) {
-                                *iter = value;
+                        if ( this->_halo == 0 ) {
+                                std::fill( this->_data.begin(), this->_data.end(), value );
+                                return *this;
+                        }
+                        const Point3i& size = this->_info.getSize();
+                        for ( int z = 0 ; z < size.z() ; ++z ) {
+                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                        T* row = this->getPointer( y, z );
+                                        std::fill( row, row + size.x(), value );
+                                }
+                        }
+                        return *this;
+                }
+
+                /**
+                 * @brief Surround the volume with padding voxels.
+                 *
+                 * Voxels in the halo can be read by get() and at() with coordinates in [-halo, size + halo).
+                 * Existing voxels are kept.
+                 * @param [in] halo Width of the halo ( voxels ).
+                 * @param [in] border Value of padding voxels.
+                 * @return Instance itself.
+                 */
+                VolumeData& setHalo ( const int halo, const T border = T() ) {
+                        const int h = halo < 0 ? 0 : halo;
+                        if ( h == this->_halo && border == this->_border ) return *this;
+                        if ( !this->isReadable() ) {
+                                this->_halo = h;
+                                this->_border = border;
+                                return *this;
+                        }
+                        VolumeData<T> tmp;
+                        tmp._halo = h;
+                        tmp._border = border;
+                        tmp.init( this->_info );
+                        const Point3i& size = this->_info.getSize();
+                        for ( int z = 0 ; z < size.z() ; ++z ) {
+                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                        const T* src = this->getPointer( y, z );
+                                        std::copy( src, src + size.x(), tmp.getPointer( y, z ) );
+                                }
                         }
+                        this->swap( tmp );
                         return *this;
                 }
 
+                /**
+                 * @brief Get the width of the halo.
+                 * @return Width ( voxels ).
+                 */
+                inline int getHalo ( void ) const {
+                        return this->_halo;
+                }
+
+                /**
+                 * @brief Get the value of padding voxels.
+                 * @return Border value.
+                 */
+                inline T getBorderValue ( void ) const {
+                        return this->_border;
+                }
+
+                /**
+                 * @brief Get the distance between (x, y, z) and (x, y + 1, z) in voxels.
+                 * @return Stride.
+                 */
+                inline ptrdiff_t getStrideY ( void ) const {
+                        return static_cast<ptrdiff_t>( this->_sx );
+                }
+
+                /**
+                 * @brief Get the distance between (x, y, z) and (x, y, z + 1) in voxels.
+                 * @return Stride.
+                 */
+                inline ptrdiff_t getStrideZ ( void ) const {
+                        return static_cast<ptrdiff_t>( this->_sxy );
+                }
+
                 inline VolumeInfo& getInfo ( void ) {
                         return this->_info;
                 }
@@ -183,6 +313,16 @@ namespace mi
                         return this->at( x, y, z );
                 }
 
+                /**
+                 * @brief Get the value at a neighbor.
+                 * @param [in] p Position.
+                 * @param [in] d Offset to the neighbor.
+                 * @return Value at p + d.
+                 */
+                inline T get ( const Point3i& p, const Point3i& d ) const {
+                        return this->at ( p.x() + d.x(), p.y() + d.y(), p.z() + d.z() );
+                }
+
                 inline void set ( const Point3i& p, const T v ) {
                         this->set ( p.x(), p.y(), p.z(), v );
                         return;
@@ -202,49 +342,67 @@ namespace mi
                 }
 
                 inline T at ( const int x, const int y, const int z ) const {
-                        return this->_data[z][y][x];
+                        return this->_data[ this->get_offset( x, y, z ) ];
                 }
 
                 inline T& at ( const int x, const int y, const int z ) {
-                        return this->_data[z][y][x];
+                        return this->_data[ this->get_offset( x, y, z ) ];
+                }
+
+                /**
+                 * @brief Get the pointer to the first voxel of a row.
+                 *
+                 * A row of size.x() voxels can be accessed through the pointer. Rows are contiguous
+                 * to each other only without a halo; otherwise use getStrideY() and getStrideZ().
+                 * @param [in] y Y coordinate.
+                 * @param [in] z Z coordinate.
+                 * @return Pointer to (0, y, z).
+                 */
+                inline T* getPointer ( const int y = 0, const int z = 0 ) {
+                        return &( this->_data[ this->get_offset( 0, y, z ) ] );
+                }
+
+                inline const T* getPointer ( const int y = 0, const int z = 0 ) const {
+                        return &( this->_data[ this->get_offset( 0, y, z ) ] );
                 }
 
                 void clear( void ) {
-                        const Point3i& size = this->getSize();
-                        for( int z = 0 ; z < size.z() ; ++z ) {
-                                for( int y = 0 ; y < size.y() ; ++y ) {
-                                        for( int x = 0 ; x < size.x() ; ++x ) {
-                                                this->set( x,y,z,T() );
-                                        }
-                                }
-                        }
+                        this->fill( T() );
                         return;
                 }
                 bool clone( VolumeData<T>& that ) {
                         if ( that.getSize() != this->getSize() ) return false;
-                        const Point3i& size = this->getSize();
-                        for( int z = 0 ; z < size.z() ; ++z ) {
-                                for( int y = 0 ; y < size.y() ; ++y ) {
-                                        for( int x = 0 ; x < size.x() ; ++x ) {
-                                                this->set( x,y,z,that.get( x,y,z ) );
-                                        }
-                                }
-                        }
+                        this->_data = that._data;
+                        this->_sx = that._sx;
+                        this->_sxy = that._sxy;
+                        this->_base = that._base;
+                        this->_halo = that._halo;
+                        this->_border = that._border;
+                        this->_isReadable = that._isReadable;
                         return true;
                 }
                 bool allocate ( void ) {
                         if ( ! this->isReadable() ) {
                                 const Point3i& size = this->_info.getSize ();
+                                const size_t h = static_cast<size_t>( this->_halo );
                                 this->_isReadable = false;
-                                this->_data.assign( size.z() , std::vector<std::vector<T> >( size.y(), std::vector<T>( size.x(), T() ) ) );
-                                if ( this->_data.size() != static_cast<size_t>( size.z() ) ) return false;
+                                this->_sx = static_cast<size_t>( size.x() ) + 2 * h;
+                                this->_sxy = this->_sx * ( static_cast<size_t>( size.y() ) + 2 * h );
+                                this->_base = h + this->_sx * h + this->_sxy * h;
+                                if ( h == 0 ) {
+                                        this->_data.assign( this->_sxy * static_cast<size_t>( size.z() ), T() );
+                                } else {
+                                        this->_data.assign( this->_sxy * ( static_cast<size_t>( size.z() ) + 2 * h ), this->_border );
+                                        this->_isReadable = true;
+                                        this->fill( T() );
+                                }
                                 this->_isReadable = true;
                         }
                         return true;
                 }
 
                 bool deallocate ( void ) {
-                        this->_data.erase( this->_data.begin(), this->_data.end() );
+                        std::vector<T>().swap( this->_data );
                         this->_isReadable = false;
                         return true;
                 }
@@ -255,26 +413,45 @@ namespace mi
 
                 bool check ( void ) {
                         const Point3i& size = this->_info.getSize();
-                        const size_t sx = static_cast<size_t>( size.x() );
-                        const size_t sy = static_cast<size_t>( size.y() );
-                        const size_t sz = static_cast<size_t>( size.z() );
-                        if ( this->_data.size() != sz ) return false;
-                        for ( int z = 0 ; z < size.z() ; ++z ) {
-                                if ( this->_data.at( z ).size() != sy ) return false;
-                                for( int y = 0 ; y < size.y() ; ++y ) {
-                                        if ( this->_data.at( z ).at( y ).size() != sx ) return false;
-                                }
-                        }
-                        return true;
+                        const size_t h  = static_cast<size_t>( this->_halo );
+                        const size_t sx = static_cast<size_t>( size.x() ) + 2 * h;
+                        const size_t sy = static_cast<size_t>( size.y() ) + 2 * h;
+                        const size_t sz = static_cast<size_t>( size.z() ) + 2 * h;
+                        return ( this->_data.size() == sx * sy * sz );
                 }
 
+                /**
+                 * @brief Iterator of voxels in x-fastest order. Voxels in the halo are skipped.
+                 */
                 iterator begin( void ) {
-                        return iterator( &( this->_data ), true );
+                        if ( this->_data.empty() ) return iterator( NULL );
+                        if ( this->_halo == 0 ) return this->rawBegin();
+                        const Point3i& size = this->_info.getSize();
+                        if ( size.x() <= 0 || size.y() <= 0 || size.z() <= 0 ) return iterator( NULL );
+                        return iterator( this->getPointer( 0, 0 ), 0, size.x(), this->getStrideY(), this->getStrideZ(), static_cast<size_t>( size.y() ),
+                                         static_cast<size_t>( size.y() ) * static_cast<size_t>( size.z() ) );
                 }
 
 
                 iterator end( void ) {
-                        return iterator( &( this->_data ), false );
+                        if ( this->_data.empty() ) return iterator( NULL );
+                        if ( this->_halo == 0 ) return this->rawEnd();
+                        const Point3i& size = this->_info.getSize();
+                        if ( size.x() <= 0 || size.y() <= 0 || size.z() <= 0 ) return iterator( NULL );
+                        return iterator( this->getPointer( size.y() - 1, size.z() - 1 ) + size.x() );
+                }
+
+                /**
+                 * @brief Iterator of all allocated voxels including the halo, for kernels that treat padding voxels as the others.
+                 */
+                iterator rawBegin( void ) {
+                        if ( this->_data.empty() ) return iterator( NULL );
+                        return iterator( &( this->_data[0] ), 0, static_cast<ptrdiff_t>( this->_data.size() ), 0, 0, 1, 1 );
+                }
+
+                iterator rawEnd( void ) {
+                        if ( this->_data.empty() ) return iterator( NULL );
+                        return iterator( &( this->_data[0] ) + this->_data.size() );
                 }
 
                 std::string createFileName( const std::string& name, const std::string ext = std::string( "raw" ) ) {
@@ -284,9 +461,18 @@ namespace mi
                         ss<<name<<"-"<<size.x()<<"x"<<size.y()<<"x"<<size.z()<<"-"<<pitch.x()<<"x"<<pitch.y()<<"x"<<pitch.z()<<"."<<ext;
                         return ss.str();
                 }
+        private:
+                inline size_t get_offset ( const int x, const int y, const int z ) const {
+                        return this->_base + static_cast<size_t>( static_cast<ptrdiff_t>( x ) + static_cast<ptrdiff_t>( this->_sx ) * y + static_cast<ptrdiff_t>( this->_sxy ) * z );
+                }
         private:
                 VolumeInfo _info;
-                std::vector<std::vector<std::vector<T> > > _data;
+                std::vector<T> _data; ///< Voxels ( x-fastest ).
+                size_t _sx;  ///< Stride of y.
+                size_t _sxy; ///< Stride of z.
+                size_t _base; ///< Offset of (0, 0, 0).
+                int _halo; ///< Width of the halo.
+                T _border; ///< Value of the halo.
                 bool _isReadable;
         };
 };
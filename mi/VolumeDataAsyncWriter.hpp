@@ -0,0 +1,229 @@
+/**
+ * @file VolumeDataAsyncWriter.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_VOLUME_DATA_ASYNC_WRITER_HPP
+#define MI_VOLUME_DATA_ASYNC_WRITER_HPP 1
+#include <string>
+#include <deque>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "VolumeData.hpp"
+#include "VolumeDataExporter.hpp"
+#include "VolumeDataBrickExporter.hpp"
+#include "FileNameConverter.hpp"
+namespace mi
+{
+        /**
+         * @class VolumeDataAsyncWriter VolumeDataAsyncWriter.hpp <mi/VolumeDataAsyncWriter.hpp>
+         * @brief Write volume data on a background thread.
+         *
+         * push() takes a snapshot of the volume and returns immediately, so the caller may modify
+         * or release the volume afterwards. Snapshots waiting for writing are limited by the memory budget;
+         * push() blocks while the budget is exhausted, and a volume larger than the budget is written
+         * synchronously. Volumes are written as raw files, or in the chunked compressed format when
+         * setBrickFormat() is on ( ".raw" is replaced by ".mivb" ).
+         */
+        class VolumeDataAsyncWriter
+        {
+        private:
+                VolumeDataAsyncWriter ( const VolumeDataAsyncWriter& that );
+                void operator = ( const VolumeDataAsyncWriter& that );
+        private:
+                class job
+                {
+                public:
+                        virtual ~job ( void ) {
+                                return;
+                        }
+                        virtual bool write ( const bool isBrick, const int nthread ) = 0;
+                        virtual size_t getBytes ( void ) const = 0;
+                        virtual std::string getFileName ( void ) const = 0;
+                };
+
+                template <typename T>
+                class volume_job : public job
+                {
+                private:
+                        VolumeData<T> _data;
+                        const std::string _filename;
+                public:
+                        volume_job ( VolumeData<T>& data, const std::string& filename ) : _data( data.getInfo(), false ), _filename( filename ) {
+                                this->_data.clone( data );
+                                return;
+                        }
+
+                        bool write ( const bool isBrick, const int nthread ) {
+                                if ( isBrick ) return VolumeDataBrickExporter<T>( this->_data ).setNumThread( nthread ).write( this->_filename );
+                                return VolumeDataExporter<T>( this->_data ).write( this->_filename );
+                        }
+
+                        size_t getBytes ( void ) const {
+                                return VolumeDataAsyncWriter::get_bytes( const_cast<VolumeData<T>&>( this->_data ) );
+                        }
+
+                        std::string getFileName ( void ) const {
+                                return this->_filename;
+                        }
+                };
+        private:
+                size_t _budget; ///< Memory budget ( byte ).
+                bool _isBrick; ///< Write in the chunked compressed format.
+                int _nthread; ///< The number of threads for compression.
+
+                std::thread _thread;
+                std::mutex _mutex;
+                std::condition_variable _cond;
+                std::deque<job*> _queue;
+                size_t _used; ///< Bytes of queued snapshots and the snapshot being written.
+                bool _isBusy;
+                bool _quit;
+        public:
+                /**
+                 * @brief Constructor.
+                 * @param [in] budget Memory budget ( byte ).
+                 */
+                explicit VolumeDataAsyncWriter ( const size_t budget = static_cast<size_t>( 1024 ) * 1024 * 1024 )
+                        : _budget( budget ), _isBrick( false ), _nthread( 1 ), _used( 0 ), _isBusy( false ), _quit( false ) {
+                        return;
+                }
+
+                /**
+                 * @brief Destructor. Queued volumes are written before the thread stops.
+                 */
+                ~VolumeDataAsyncWriter ( void ) {
+                        this->flush();
+                        {
+                                std::lock_guard<std::mutex> lock( this->_mutex );
+                                this->_quit = true;
+                        }
+                        this->_cond.notify_all();
+                        if ( this->_thread.joinable() ) this->_thread.join();
+                        return;
+                }
+
+                /**
+                 * @brief Set memory budget for snapshots. 0 means synchronous writing.
+                 * @param [in] budget Budget ( byte ).
+                 * @return Instance itself.
+                 */
+                VolumeDataAsyncWriter& setMemoryBudget ( const size_t budget ) {
+                        std::lock_guard<std::mutex> lock( this->_mutex );
+                        this->_budget = budget;
+                        return *this;
+                }
+
+                /**
+                 * @brief Write volumes in the chunked compressed format.
+                 * @param [in] isBrick Set true to use the chunked compressed format.
+                 * @return Instance itself.
+                 */
+                VolumeDataAsyncWriter& setBrickFormat ( const bool isBrick = true ) {
+                        std::lock_guard<std::mutex> lock( this->_mutex );
+                        this->_isBrick = isBrick;
+                        return *this;
+                }
+
+                /**
+                 * @brief Set the number of threads used for compression.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                VolumeDataAsyncWriter& setNumThread ( const int nthread ) {
+                        std::lock_guard<std::mutex> lock( this->_mutex );
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
+
+                /**
+                 * @brief Write volume data in background.
+                 * @param [in] data Volume data. A snapshot is taken.
+                 * @param [in] filename File name.
+                 * @retval true The volume was queued or written.
+                 * @retval false Writing failed.
+                 */
+                template <typename T>
+                bool push ( VolumeData<T>& data, const std::string& filename ) {
+                        const size_t bytes = VolumeDataAsyncWriter::get_bytes( data );
+                        std::unique_lock<std::mutex> lock( this->_mutex );
+                        const std::string name = this->get_file_name( filename );
+                        if ( bytes > this->_budget ) {
+                                // the snapshot cannot be kept.
+                                const bool isBrick = this->_isBrick;
+                                const int nthread = this->_nthread;
+                                lock.unlock();
+                                volume_job<T> j( data, name );
+                                return VolumeDataAsyncWriter::write( j, isBrick, nthread );
+                        }
+                        this->_cond.wait( lock, [this, bytes] { return this->_used + bytes <= this->_budget; } );
+                        this->_used += bytes;
+                        lock.unlock();
+                        job* j = new volume_job<T>( data, name );
+                        lock.lock();
+                        this->_queue.push_back( j );
+                        if ( !this->_thread.joinable() ) this->_thread = std::thread( &VolumeDataAsyncWriter::run, this );
+                        lock.unlock();
+                        this->_cond.notify_all();
+                        return true;
+                }
+
+                /**
+                 * @brief Wait until all queued volumes are written.
+                 */
+                void flush ( void ) {
+                        std::unique_lock<std::mutex> lock( this->_mutex );
+                        this->_cond.wait( lock, [this] { return this->_queue.empty() && !this->_isBusy; } );
+                        return;
+                }
+        private:
+                template <typename T>
+                static size_t get_bytes ( VolumeData<T>& data ) {
+                        const Point3i size = data.getSize();
+                        return sizeof( T ) * static_cast<size_t>( size.x() ) * static_cast<size_t>( size.y() ) * static_cast<size_t>( size.z() );
+                }
+
+                std::string get_file_name ( const std::string& filename ) const {
+                        if ( !this->_isBrick ) return filename;
+                        FileNameConverter converter( filename );
+                        if ( converter.checkExtension( "raw" ) ) return converter.getNewFileName( "mivb" );
+                        return filename + ".mivb";
+                }
+
+                static bool write ( job& j, const bool isBrick, const int nthread ) {
+                        if ( !j.write( isBrick, nthread ) ) {
+                                std::cerr<<"[debug] writing "<<j.getFileName()<<" failed."<<std::endl;
+                                return false;
+                        }
+                        std::cerr<<"[debug] the result was saved to "<<j.getFileName()<<std::endl;
+                        return true;
+                }
+
+                /**
+                 * @brief Body of the writer thread.
+                 */
+                void run ( void ) {
+                        std::unique_lock<std::mutex> lock( this->_mutex );
+                        for ( ;; ) {
+                                this->_cond.wait( lock, [this] { return !this->_queue.empty() || this->_quit; } );
+                                if ( this->_queue.empty() ) break;
+                                job* j = this->_queue.front();
+                                this->_queue.pop_front();
+                                this->_isBusy = true;
+                                const bool isBrick = this->_isBrick;
+                                const int nthread = this->_nthread;
+                                lock.unlock();
+                                VolumeDataAsyncWriter::write( *j, isBrick, nthread );
+                                const size_t bytes = j->getBytes();
+                                delete j;
+                                lock.lock();
+                                this->_used -= bytes;
+                                this->_isBusy = false;
+                                this->_cond.notify_all();
+                        }
+                        return;
+                }
+        };
+}
+#endif// MI_VOLUME_DATA_ASYNC_WRITER_HPP
@@ -0,0 +1,208 @@
+/**
+ * @file VolumeDataBrickExporter.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_VOLUME_DATA_BRICK_EXPORTER_HPP
+#define MI_VOLUME_DATA_BRICK_EXPORTER_HPP 1
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+#include "Exporter.hpp"
+#include "VolumeData.hpp"
+#include "BrickCodec.hpp"
+#include "ParallelFor.hpp"
+
+namespace mi
+{
+        /**
+         * @class VolumeDataBrickExporter VolumeDataBrickExporter.hpp <mi/VolumeDataBrickExporter.hpp>
+         * @brief Exporter for the chunked compressed volume format.
+         *
+         * The volume is divided into cubic bricks, and each brick is compressed by BrickCodec independently.
+         * File layout ( little-endian ):
+         * - header : "MIVB", version ( uint32 ), value size ( uint32 ), size ( int32 x 3 ),
+         *   pitch ( double x 3 ), origin ( double x 3 ), brick size ( uint32 ), the number of bricks ( uint32 ).
+         * - index : offset ( uint64 ), compressed size ( uint32 ) and codec ( uint32, 0:stored, 1:BrickCodec ) per brick.
+         * - bricks : bricks are ordered in z, y, x order of brick positions.
+         *   Values in a brick are ordered in z, y, x order and clipped by the volume boundary.
+         *
+         * Bricks are compressed by setNumThread() threads. Memory usage is bounded by a few bricks per thread.
+         */
+        template <typename T>
+        class VolumeDataBrickExporter : public Exporter
+        {
+        private:
+                VolumeData<T>& _data; ///< Volume data.
+                int _brickSize; ///< Brick size.
+                int _nthread; ///< The number of threads.
+        public:
+                /**
+                 * @brief Constructor.
+                 * @param [in] data Volume data.
+                 * @param [in] brickSize Brick size.
+                 */
+                explicit VolumeDataBrickExporter ( VolumeData<T>& data, const int brickSize = 64 ) : Exporter ( true ), _data ( data ), _brickSize( 64 ), _nthread( 1 ) {
+                        this->setBrickSize( brickSize );
+                        return;
+                }
+
+                /**
+                 * @brief Set brick size.
+                 * @param [in] brickSize Brick size.
+                 * @return Instance itself.
+                 */
+                VolumeDataBrickExporter<T>& setBrickSize ( const int brickSize ) {
+                        this->_brickSize = brickSize < 1 ? 1 : brickSize;
+                        return *this;
+                }
+
+                /**
+                 * @brief Set the number of threads.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                VolumeDataBrickExporter<T>& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
+        protected:
+                bool writeHeader ( std::ofstream& fout ) {
+                        VolumeInfo& info = this->_data.getInfo();
+                        const Point3i size = info.getSize();
+                        const Point3d pitch = info.getPitch();
+                        const Point3d origin = info.getOrigin();
+                        const uint32_t version = 1;
+                        const uint32_t valueSize = sizeof( T );
+                        const int32_t sz[3] = { size.x(), size.y(), size.z() };
+                        const double p[3] = { pitch.x(), pitch.y(), pitch.z() };
+                        const double o[3] = { origin.x(), origin.y(), origin.z() };
+                        const uint32_t brickSize = static_cast<uint32_t>( this->_brickSize );
+                        const uint32_t numBricks = static_cast<uint32_t>( this->get_num_bricks() );
+                        fout.write( "MIVB", 4 );
+                        fout.write( reinterpret_cast<const char*>( &version ), sizeof( version ) );
+                        fout.write( reinterpret_cast<const char*>( &valueSize ), sizeof( valueSize ) );
+                        fout.write( reinterpret_cast<const char*>( sz ), sizeof( sz ) );
+                        fout.write( reinterpret_cast<const char*>( p ), sizeof( p ) );
+                        fout.write( reinterpret_cast<const char*>( o ), sizeof( o ) );
+                        fout.write( reinterpret_cast<const char*>( &brickSize ), sizeof( brickSize ) );
+                        fout.write( reinterpret_cast<const char*>( &numBricks ), sizeof( numBricks ) );
+                        return fout.good();
+                }
+
+                bool writeBody ( std::ofstream& fout ) {
+                        if ( ! this->_data.isReadable() ) {
+                                std::cerr<<"volume data is not readable."<<std::endl;
+                                return false;
+                        }
+                        const size_t numBricks = this->get_num_bricks();
+                        const std::streamoff indexPos = fout.tellp();
+                        std::vector<uint64_t> offset( numBricks, 0 );
+                        std::vector<uint32_t> csize( numBricks, 0 );
+                        std::vector<uint32_t> codec( numBricks, 0 );
+                        if ( !this->write_index( fout, offset, csize, codec ) ) return false; // placeholder.
+
+                        const int nthread = this->_nthread;
+                        const size_t batchSize = static_cast<size_t>( nthread ) * 4;
+                        std::vector<std::vector<char> > buf( batchSize );
+                        std::vector<int> chunks( nthread );
+                        for ( int i = 0 ; i < nthread ; ++i ) chunks[i] = i;
+                        for ( size_t batch = 0 ; batch < numBricks ; batch += batchSize ) {
+                                const size_t num = std::min( batchSize, numBricks - batch );
+                                compress_fn fn( *this, buf, codec, batch, num, nthread );
+                                if ( nthread == 1 ) fn( 0 );
+                                else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                                for ( size_t i = 0 ; i < num ; ++i ) {
+                                        offset[ batch + i ] = static_cast<uint64_t>( fout.tellp() );
+                                        csize[ batch + i ] = static_cast<uint32_t>( buf[i].size() );
+                                        if ( !buf[i].empty() && !fout.write( &buf[i][0], static_cast<std::streamsize>( buf[i].size() ) ) ) {
+                                                std::cerr<<"writing data failed. "<<std::endl;
+                                                return false;
+                                        }
+                                }
+                        }
+                        fout.seekp( indexPos, std::ios::beg );
+                        if ( !this->write_index( fout, offset, csize, codec ) ) return false;
+                        fout.seekp( 0, std::ios::end );
+                        return fout.good();
+                }
+
+                std::string toString ( void ) const {
+                        return std::string ( "brick" );
+                }
+        private:
+                size_t get_num_bricks ( void ) {
+                        const Point3i& size = this->_data.getInfo().getSize();
+                        const int bs = this->_brickSize;
+                        return static_cast<size_t>( ( size.x() + bs - 1 ) / bs ) * static_cast<size_t>( ( size.y() + bs - 1 ) / bs ) * static_cast<size_t>( ( size.z() + bs - 1 ) / bs );
+                }
+
+                bool write_index ( std::ofstream& fout, const std::vector<uint64_t>& offset, const std::vector<uint32_t>& csize, const std::vector<uint32_t>& codec ) {
+                        for ( size_t i = 0 ; i < offset.size() ; ++i ) {
+                                fout.write( reinterpret_cast<const char*>( &offset[i] ), sizeof( uint64_t ) );
+                                fout.write( reinterpret_cast<const char*>( &csize[i] ), sizeof( uint32_t ) );
+                                fout.write( reinterpret_cast<const char*>( &codec[i] ), sizeof( uint32_t ) );
+                        }
+                        return fout.good();
+                }
+
+                /**
+                 * @brief Copy a brick to a buffer and compress it.
+                 * @param [in] id Brick ID.
+                 * @param [out] raw Work buffer.
+                 * @param [out] buf Compressed ( or stored ) data.
+                 * @return Codec.
+                 */
+                uint32_t compress_brick ( const size_t id, std::vector<T>& raw, std::vector<char>& buf ) {
+                        const Point3i& size = this->_data.getInfo().getSize();
+                        const int bs = this->_brickSize;
+                        const size_t nbx = static_cast<size_t>( ( size.x() + bs - 1 ) / bs );
+                        const size_t nby = static_cast<size_t>( ( size.y() + bs - 1 ) / bs );
+                        const int x0 = static_cast<int>( id % nbx ) * bs;
+                        const int y0 = static_cast<int>( ( id / nbx ) % nby ) * bs;
+                        const int z0 = static_cast<int>( id / ( nbx * nby ) ) * bs;
+                        const int ex = std::min( bs, size.x() - x0 );
+                        const int ey = std::min( bs, size.y() - y0 );
+                        const int ez = std::min( bs, size.z() - z0 );
+                        raw.resize( static_cast<size_t>( ex ) * static_cast<size_t>( ey ) * static_cast<size_t>( ez ) );
+                        T* dst = &raw[0];
+                        for ( int z = z0 ; z < z0 + ez ; ++z ) {
+                                for ( int y = y0 ; y < y0 + ey ; ++y ) {
+                                        std::memcpy( dst, this->_data.getPointer( y, z ) + x0, sizeof( T ) * ex );
+                                        dst += ex;
+                                }
+                        }
+                        const size_t bytes = sizeof( T ) * raw.size();
+                        BrickCodec::compress( reinterpret_cast<const char*>( &raw[0] ), bytes, sizeof( T ), buf );
+                        if ( buf.size() < bytes ) return 1;
+                        buf.assign( reinterpret_cast<const char*>( &raw[0] ), reinterpret_cast<const char*>( &raw[0] ) + bytes );
+                        return 0;
+                }
+
+                class compress_fn
+                {
+                private:
+                        VolumeDataBrickExporter<T>& _exporter;
+                        std::vector<std::vector<char> >& _buf;
+                        std::vector<uint32_t>& _codec;
+                        const size_t _batch;
+                        const size_t _num;
+                        const int _nthread;
+                public:
+                        compress_fn ( VolumeDataBrickExporter<T>& exporter, std::vector<std::vector<char> >& buf, std::vector<uint32_t>& codec,
+                                      const size_t batch, const size_t num, const int nthread ) :
+                                _exporter( exporter ), _buf( buf ), _codec( codec ), _batch( batch ), _num( num ), _nthread( nthread ) {
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                std::vector<T> raw;
+                                for ( size_t i = static_cast<size_t>( chunk ) ; i < this->_num ; i += this->_nthread ) {
+                                        this->_codec[ this->_batch + i ] = this->_exporter.compress_brick( this->_batch + i, raw, this->_buf[i] );
+                                }
+                                return;
+                        }
+                };
+        };
+};
+#endif// MI_VOLUME_DATA_BRICK_EXPORTER_HPP
@@ -0,0 +1,307 @@
+/**
+ * @file VolumeDataBrickImporter.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_VOLUME_DATA_BRICK_IMPORTER_HPP
+#define MI_VOLUME_DATA_BRICK_IMPORTER_HPP 1
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <stdint.h>
+#include "Importer.hpp"
+#include "VolumeData.hpp"
+#include "BrickCodec.hpp"
+#include "ParallelFor.hpp"
+
+namespace mi
+{
+        /**
+         * @class VolumeDataBrickImporter VolumeDataBrickImporter.hpp <mi/VolumeDataBrickImporter.hpp>
+         * @brief Importer for the chunked compressed volume format written by VolumeDataBrickExporter.
+         *
+         * read() decodes the whole volume. The volume data is initialized by size, pitch and origin in the file.
+         * After open(), readSlab() and readBrick() decode only bricks overlapping the requested region.
+         * Bricks are decoded by setNumThread() threads.
+         */
+        template <typename T>
+        class VolumeDataBrickImporter : public Importer
+        {
+        private:
+                VolumeData<T>& _data; ///< Data.
+                int _nthread; ///< The number of threads.
+
+                VolumeInfo _info; ///< Volume information in the file.
+                int _brickSize; ///< Brick size.
+                Point3i _numBricks; ///< The number of bricks along each axis.
+                std::vector<uint64_t> _offset; ///< Offset of each brick.
+                std::vector<uint32_t> _csize; ///< Compressed size of each brick.
+                std::vector<uint32_t> _codec; ///< Codec of each brick.
+                std::ifstream _fin; ///< File stream for random access.
+        public:
+                /**
+                 * @brief Constructor.
+                 * @param [out] data Data.
+                 */
+                explicit VolumeDataBrickImporter ( VolumeData<T>& data ) : Importer ( true ), _data ( data ), _nthread( 1 ), _brickSize( 0 ) {
+                        return;
+                }
+
+                /**
+                 * @brief Set the number of threads.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                VolumeDataBrickImporter<T>& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
+
+                /**
+                 * @brief Open a file for random access.
+                 * @param [in] filename File name.
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                bool open ( const std::string& filename ) {
+                        if ( this->_fin.is_open() ) this->_fin.close();
+                        this->_fin.clear();
+                        this->_fin.open( filename.c_str(), std::ios::in | std::ios::binary );
+                        if ( !this->_fin ) {
+                                std::cerr<<filename<<" cannot be open."<<std::endl;
+                                return false;
+                        }
+                        if ( !this->readHeader( this->_fin ) ) {
+                                std::cerr<<filename<<" has an invalid header."<<std::endl;
+                                this->_fin.close();
+                                return false;
+                        }
+                        return true;
+                }
+
+                /**
+                 * @brief Get volume information of the opened file.
+                 * @return Volume information.
+                 */
+                VolumeInfo& getInfo ( void ) {
+                        return this->_info;
+                }
+
+                /**
+                 * @brief Get brick size of the opened file.
+                 * @return Brick size.
+                 */
+                int getBrickSize ( void ) const {
+                        return this->_brickSize;
+                }
+
+                /**
+                 * @brief Read slices [zbegin, zend) of the opened file.
+                 * @param [in] zbegin First slice.
+                 * @param [in] zend End slice ( exclusive ).
+                 * @param [out] slab Data. Origin is moved to the first slice.
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                bool readSlab ( const int zbegin, const int zend, VolumeData<T>& slab ) {
+                        const Point3i& size = this->_info.getSize();
+                        return this->read_region( Point3i( 0, 0, zbegin ), Point3i( size.x(), size.y(), zend ), slab );
+                }
+
+                /**
+                 * @brief Read a brick of the opened file.
+                 * @param [in] bx Brick position ( x ).
+                 * @param [in] by Brick position ( y ).
+                 * @param [in] bz Brick position ( z ).
+                 * @param [out] brick Data. Origin is moved to the first voxel of the brick.
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                bool readBrick ( const int bx, const int by, const int bz, VolumeData<T>& brick ) {
+                        const Point3i& size = this->_info.getSize();
+                        const int bs = this->_brickSize;
+                        const Point3i bmin( bx * bs, by * bs, bz * bs );
+                        const Point3i bmax( std::min( bmin.x() + bs, size.x() ), std::min( bmin.y() + bs, size.y() ), std::min( bmin.z() + bs, size.z() ) );
+                        return this->read_region( bmin, bmax, brick );
+                }
+        protected:
+                bool readHeader ( std::ifstream& fin ) {
+                        char magic[4];
+                        uint32_t version, valueSize, brickSize, numBricks;
+                        int32_t sz[3];
+                        double p[3], o[3];
+                        if ( !fin.read( magic, 4 ) || std::memcmp( magic, "MIVB", 4 ) != 0 ) return false;
+                        fin.read( reinterpret_cast<char*>( &version ), sizeof( version ) );
+                        fin.read( reinterpret_cast<char*>( &valueSize ), sizeof( valueSize ) );
+                        fin.read( reinterpret_cast<char*>( sz ), sizeof( sz ) );
+                        fin.read( reinterpret_cast<char*>( p ), sizeof( p ) );
+                        fin.read( reinterpret_cast<char*>( o ), sizeof( o ) );
+                        fin.read( reinterpret_cast<char*>( &brickSize ), sizeof( brickSize ) );
+                        fin.read( reinterpret_cast<char*>( &numBricks ), sizeof( numBricks ) );
+                        if ( !fin || version != 1 ) return false;
+                        if ( valueSize != sizeof( T ) ) {
+                                std::cerr<<"value size "<<valueSize<<" does not match "<<sizeof( T )<<"."<<std::endl;
+                                return false;
+                        }
+                        if ( brickSize == 0 || sz[0] < 0 || sz[1] < 0 || sz[2] < 0 ) return false;
+                        const int bs = static_cast<int>( brickSize );
+                        const Point3i nb( ( sz[0] + bs - 1 ) / bs, ( sz[1] + bs - 1 ) / bs, ( sz[2] + bs - 1 ) / bs );
+                        if ( static_cast<size_t>( nb.x() ) * static_cast<size_t>( nb.y() ) * static_cast<size_t>( nb.z() ) != numBricks ) return false;
+                        this->_info.init( Point3i( sz[0], sz[1], sz[2] ), Point3d( p[0], p[1], p[2] ), Point3d( o[0], o[1], o[2] ) );
+                        this->_brickSize = bs;
+                        this->_numBricks = nb;
+                        this->_offset.resize( numBricks );
+                        this->_csize.resize( numBricks );
+                        this->_codec.resize( numBricks );
+                        for ( size_t i = 0 ; i < numBricks ; ++i ) {
+                                fin.read( reinterpret_cast<char*>( &this->_offset[i] ), sizeof( uint64_t ) );
+                                fin.read( reinterpret_cast<char*>( &this->_csize[i] ), sizeof( uint32_t ) );
+                                fin.read( reinterpret_cast<char*>( &this->_codec[i] ), sizeof( uint32_t ) );
+                        }
+                        return fin.good();
+                }
+
+                bool readBody ( std::ifstream& fin ) {
+                        return this->read_region( fin, Point3i( 0, 0, 0 ), this->_info.getSize(), this->_data );
+                }
+
+                std::string toString ( void ) const {
+                        return std::string ( "brick" );
+                }
+        private:
+                bool read_region ( const Point3i& bmin, const Point3i& bmax, VolumeData<T>& out ) {
+                        if ( !this->_fin.is_open() ) {
+                                std::cerr<<"error : file is not open."<<std::endl;
+                                return false;
+                        }
+                        return this->read_region( this->_fin, bmin, bmax, out );
+                }
+
+                /**
+                 * @brief Decode bricks overlapping [bmin, bmax) into out.
+                 */
+                bool read_region ( std::ifstream& fin, const Point3i& bmin, const Point3i& bmax, VolumeData<T>& out ) {
+                        const Point3i& size = this->_info.getSize();
+                        if ( bmin.x() < 0 || bmin.y() < 0 || bmin.z() < 0 || bmax.x() > size.x() || bmax.y() > size.y() || bmax.z() > size.z() ||
+                             bmin.x() > bmax.x() || bmin.y() > bmax.y() || bmin.z() > bmax.z() ) {
+                                std::cerr<<"error : region is out of the volume."<<std::endl;
+                                return false;
+                        }
+                        const Point3d pitch = this->_info.getPitch();
+                        const Point3d origin = this->_info.getOrigin();
+                        const Point3d regionOrigin( origin.x() + pitch.x() * bmin.x(), origin.y() + pitch.y() * bmin.y(), origin.z() + pitch.z() * bmin.z() );
+                        const Point3i regionSize( bmax.x() - bmin.x(), bmax.y() - bmin.y(), bmax.z() - bmin.z() );
+                        out.init( VolumeInfo( regionSize, pitch, regionOrigin ) );
+                        if ( regionSize.x() == 0 || regionSize.y() == 0 || regionSize.z() == 0 ) return true;
+
+                        const int bs = this->_brickSize;
+                        std::vector<size_t> ids;
+                        for ( int bz = bmin.z() / bs ; bz * bs < bmax.z() ; ++bz ) {
+                                for ( int by = bmin.y() / bs ; by * bs < bmax.y() ; ++by ) {
+                                        for ( int bx = bmin.x() / bs ; bx * bs < bmax.x() ; ++bx ) {
+                                                ids.push_back( ( static_cast<size_t>( bz ) * this->_numBricks.y() + by ) * this->_numBricks.x() + bx );
+                                        }
+                                }
+                        }
+
+                        const int nthread = this->_nthread;
+                        const size_t batchSize = static_cast<size_t>( nthread ) * 4;
+                        std::vector<std::vector<char> > buf( batchSize );
+                        std::vector<int> chunks( nthread );
+                        for ( int i = 0 ; i < nthread ; ++i ) chunks[i] = i;
+                        std::vector<char> failed( nthread, 0 );
+                        for ( size_t batch = 0 ; batch < ids.size() ; batch += batchSize ) {
+                                const size_t num = std::min( batchSize, ids.size() - batch );
+                                for ( size_t i = 0 ; i < num ; ++i ) {
+                                        const size_t id = ids[ batch + i ];
+                                        buf[i].resize( this->_csize[id] );
+                                        fin.clear();
+                                        fin.seekg( static_cast<std::streamoff>( this->_offset[id] ), std::ios::beg );
+                                        if ( !buf[i].empty() && !fin.read( &buf[i][0], static_cast<std::streamsize>( buf[i].size() ) ) ) {
+                                                std::cerr<<"reading brick "<<id<<" failed."<<std::endl;
+                                                return false;
+                                        }
+                                }
+                                decompress_fn fn( *this, ids, buf, batch, num, nthread, bmin, bmax, out, failed );
+                                if ( nthread == 1 ) fn( 0 );
+                                else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                                for ( int i = 0 ; i < nthread ; ++i ) {
+                                        if ( failed[i] ) {
+                                                std::cerr<<"broken brick data."<<std::endl;
+                                                return false;
+                                        }
+                                }
+                        }
+                        return true;
+                }
+
+                /**
+                 * @brief Decompress a brick and copy the part inside [bmin, bmax).
+                 */
+                bool decompress_brick ( const size_t id, const std::vector<char>& buf, std::vector<T>& raw, const Point3i& bmin, const Point3i& bmax, VolumeData<T>& out ) const {
+                        const Point3i& size = const_cast<VolumeInfo&>( this->_info ).getSize();
+                        const int bs = this->_brickSize;
+                        const int x0 = static_cast<int>( id % this->_numBricks.x() ) * bs;
+                        const int y0 = static_cast<int>( ( id / this->_numBricks.x() ) % this->_numBricks.y() ) * bs;
+                        const int z0 = static_cast<int>( id / ( static_cast<size_t>( this->_numBricks.x() ) * this->_numBricks.y() ) ) * bs;
+                        const int ex = std::min( bs, size.x() - x0 );
+                        const int ey = std::min( bs, size.y() - y0 );
+                        const int ez = std::min( bs, size.z() - z0 );
+                        const size_t bytes = sizeof( T ) * static_cast<size_t>( ex ) * static_cast<size_t>( ey ) * static_cast<size_t>( ez );
+                        raw.resize( bytes / sizeof( T ) );
+                        char* dst = reinterpret_cast<char*>( &raw[0] );
+                        if ( this->_codec[id] == 0 ) {
+                                if ( buf.size() != bytes ) return false;
+                                std::memcpy( dst, &buf[0], bytes );
+                        } else if ( this->_codec[id] == 1 ) {
+                                if ( !BrickCodec::decompress( buf.empty() ? NULL : &buf[0], buf.size(), sizeof( T ), dst, bytes ) ) return false;
+                        } else return false;
+
+                        const int xb = std::max( x0, bmin.x() ), xe = std::min( x0 + ex, bmax.x() );
+                        const int yb = std::max( y0, bmin.y() ), ye = std::min( y0 + ey, bmax.y() );
+                        const int zb = std::max( z0, bmin.z() ), ze = std::min( z0 + ez, bmax.z() );
+                        for ( int z = zb ; z < ze ; ++z ) {
+                                for ( int y = yb ; y < ye ; ++y ) {
+                                        const T* src = &raw[ ( static_cast<size_t>( z - z0 ) * ey + ( y - y0 ) ) * ex + ( xb - x0 ) ];
+                                        std::memcpy( out.getPointer( y - bmin.y(), z - bmin.z() ) + ( xb - bmin.x() ), src, sizeof( T ) * ( xe - xb ) );
+                                }
+                        }
+                        return true;
+                }
+
+                class decompress_fn
+                {
+                private:
+                        const VolumeDataBrickImporter<T>& _importer;
+                        const std::vector<size_t>& _ids;
+                        const std::vector<std::vector<char> >& _buf;
+                        const size_t _batch;
+                        const size_t _num;
+                        const int _nthread;
+                        const Point3i _bmin;
+                        const Point3i _bmax;
+                        VolumeData<T>& _out;
+                        std::vector<char>& _failed;
+                public:
+                        decompress_fn ( const VolumeDataBrickImporter<T>& importer, const std::vector<size_t>& ids, const std::vector<std::vector<char> >& buf,
+                                        const size_t batch, const size_t num, const int nthread, const Point3i& bmin, const Point3i& bmax,
+                                        VolumeData<T>& out, std::vector<char>& failed ) :
+                                _importer( importer ), _ids( ids ), _buf( buf ), _batch( batch ), _num( num ), _nthread( nthread ),
+                                _bmin( bmin ), _bmax( bmax ), _out( out ), _failed( failed ) {
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                std::vector<T> raw;
+                                for ( size_t i = static_cast<size_t>( chunk ) ; i < this->_num ; i += this->_nthread ) {
+                                        if ( !this->_importer.decompress_brick( this->_ids[ this->_batch + i ], this->_buf[i], raw, this->_bmin, this->_bmax, this->_out ) ) {
+                                                this->_failed[chunk] = 1;
+                                        }
+                                }
+                                return;
+                        }
+                };
+        };
+};
+#endif// MI_VOLUME_DATA_BRICK_IMPORTER_HPP
@@ -0,0 +1,305 @@
+/**
+ * @file VolumeDataCache.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_VOLUME_DATA_CACHE_HPP
+#define MI_VOLUME_DATA_CACHE_HPP 1
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <stdint.h>
+#include "VolumeData.hpp"
+#include "ParallelFor.hpp"
+namespace mi
+{
+        /**
+         * @class VolumeDataCache VolumeDataCache.hpp <mi/VolumeDataCache.hpp>
+         * @brief On-disk cache of intermediate volumes addressed by content.
+         *
+         * A key is a 64-bit hash of input voxels ( hash() ) combined with the parameters a stage depends on
+         * ( combine() ). Volumes are stored as "<directory>/<stage>-<key>.mivc".
+         * File layout ( little-endian ) : "MIVC", version ( uint32 ), value size ( uint32 ), size ( int32 x 3 ),
+         * pitch ( double x 3 ), origin ( double x 3 ), key ( uint64 ), zero padding up to 4096 bytes, and voxels
+         * in z, y, x order. The voxels start at a page boundary, so the body can be mapped as it is.
+         * Files are written to a temporary name and renamed, so an interrupted run never leaves a broken entry.
+         * The hash is not cryptographic; it only tells different inputs and parameters apart.
+         */
+        class VolumeDataCache
+        {
+        private:
+                VolumeDataCache ( const VolumeDataCache& that );
+                void operator = ( const VolumeDataCache& that );
+        private:
+                std::string _directory; ///< Cache directory ( empty : disabled ).
+                int _nthread; ///< The number of threads.
+        public:
+                /**
+                 * @brief Constructor.
+                 * @param [in] directory Cache directory. The cache is disabled when it is empty.
+                 */
+                explicit VolumeDataCache ( const std::string& directory = std::string() ) : _directory( directory ), _nthread( 1 ) {
+                        return;
+                }
+
+                VolumeDataCache& setDirectory ( const std::string& directory ) {
+                        this->_directory = directory;
+                        return *this;
+                }
+
+                /**
+                 * @brief Set the number of threads used by hash().
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                VolumeDataCache& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
+
+                bool isEnabled ( void ) const {
+                        return !this->_directory.empty();
+                }
+
+                /**
+                 * @brief Hash volume information and voxels. Slices are hashed in parallel.
+                 * @param [in] data Volume data ( VolumeData or VolumeView ).
+                 * @return Hash value. It does not depend on the number of threads.
+                 */
+                template <class Volume>
+                uint64_t hash ( Volume& data ) const {
+                        VolumeInfo& info = data.getInfo();
+                        const Point3i size = info.getSize();
+                        uint64_t h = VolumeDataCache::combine( 0, VolumeDataCache::header_of( info ) );
+                        std::vector<uint64_t> slices( static_cast<size_t>( size.z() ), 0 );
+                        const int n = std::max( 1, std::min( this->_nthread, size.z() ) );
+                        std::vector<int> chunks( n );
+                        for ( int i = 0 ; i < n ; ++i ) chunks[i] = i;
+                        hash_fn<Volume> fn( data, slices, n );
+                        if ( n == 1 ) fn( 0 );
+                        else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                        if ( !slices.empty() ) h = VolumeDataCache::hash_bytes( &slices[0], slices.size() * sizeof( uint64_t ), h );
+                        return h;
+                }
+
+                /**
+                 * @brief Combine a parameter with a key.
+                 * @param [in] key Key.
+                 * @param [in] value Parameter ( arithmetic values or std::string ).
+                 * @return New key.
+                 */
+                template <typename V>
+                static uint64_t combine ( const uint64_t key, const V& value ) {
+                        return VolumeDataCache::hash_bytes( &value, sizeof( V ), key );
+                }
+
+                static uint64_t combine ( const uint64_t key, const std::string& value ) {
+                        return VolumeDataCache::hash_bytes( value.c_str(), value.size(), VolumeDataCache::combine( key, value.size() ) );
+                }
+
+                /**
+                 * @brief Get the file name of an entry.
+                 * @param [in] stage Stage name.
+                 * @param [in] key Key.
+                 * @return File name.
+                 */
+                std::string getFileName ( const std::string& stage, const uint64_t key ) const {
+                        std::stringstream ss;
+                        ss<<this->_directory;
+                        const char last = this->_directory.empty() ? '/' : this->_directory[ this->_directory.size() - 1 ];
+                        if ( last != '/' && last != '\\' ) ss<<"/";
+                        ss<<stage<<"-"<<std::hex<<std::setw( 16 )<<std::setfill( '0' )<<key<<".mivc";
+                        return ss.str();
+                }
+
+                /**
+                 * @brief Load an entry.
+                 * @param [in] stage Stage name.
+                 * @param [in] key Key.
+                 * @param [out] data Volume data. It is initialized by the information in the file and keeps its halo setting.
+                 * @retval true The entry is loaded.
+                 * @retval false The cache is disabled, or the entry is missing or invalid.
+                 */
+                template <typename T>
+                bool load ( const std::string& stage, const uint64_t key, VolumeData<T>& data ) const {
+                        if ( !this->isEnabled() ) return false;
+                        const std::string filename = this->getFileName( stage, key );
+                        std::ifstream fin( filename.c_str(), std::ios::in | std::ios::binary );
+                        if ( !fin ) return false;
+                        header h;
+                        if ( !fin.read( reinterpret_cast<char*>( &h ), sizeof( h ) ) || std::memcmp( h.magic, "MIVC", 4 ) != 0 ||
+                             h.version != 1 || h.valueSize != sizeof( T ) || h.key != key ||
+                             h.size[0] < 1 || h.size[1] < 1 || h.size[2] < 1 ) {
+                                std::cerr<<"warning : "<<filename<<" is not a valid cache file."<<std::endl;
+                                return false;
+                        }
+                        const Point3i size( h.size[0], h.size[1], h.size[2] );
+                        data.init( VolumeInfo( size, Point3d( h.pitch[0], h.pitch[1], h.pitch[2] ), Point3d( h.origin[0], h.origin[1], h.origin[2] ) ) );
+                        fin.seekg( VolumeDataCache::body_offset(), std::ios::beg );
+                        const std::streamsize rowSize = static_cast<std::streamsize>( sizeof( T ) ) * size.x();
+                        for ( int z = 0 ; z < size.z() ; ++z ) {
+                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                        if ( !fin.read( reinterpret_cast<char*>( data.getPointer( y, z ) ), rowSize ) ) {
+                                                std::cerr<<"warning : "<<filename<<" is truncated."<<std::endl;
+                                                data.deallocate();
+                                                return false;
+                                        }
+                                }
+                        }
+                        return true;
+                }
+
+                /**
+                 * @brief Save an entry.
+                 * @param [in] stage Stage name.
+                 * @param [in] key Key.
+                 * @param [in] data Volume data.
+                 * @retval true The entry is saved.
+                 * @retval false The cache is disabled or writing failed. Callers may go on without the cache.
+                 */
+                template <typename T>
+                bool save ( const std::string& stage, const uint64_t key, VolumeData<T>& data ) const {
+                        if ( !this->isEnabled() || !data.isReadable() ) return false;
+                        const std::string filename = this->getFileName( stage, key );
+                        const std::string tmpname = filename + ".tmp";
+                        std::ofstream fout( tmpname.c_str(), std::ios::out | std::ios::binary );
+                        if ( !fout ) {
+                                std::cerr<<"warning : "<<tmpname<<" cannot be written."<<std::endl;
+                                return false;
+                        }
+                        header h = VolumeDataCache::header_of( data.getInfo() );
+                        std::memcpy( h.magic, "MIVC", 4 );
+                        h.version = 1;
+                        h.valueSize = sizeof( T );
+                        h.key = key;
+                        fout.write( reinterpret_cast<const char*>( &h ), sizeof( h ) );
+                        const std::vector<char> padding( VolumeDataCache::body_offset() - sizeof( h ), 0 );
+                        fout.write( &padding[0], static_cast<std::streamsize>( padding.size() ) );
+                        const Point3i size = data.getInfo().getSize();
+                        const std::streamsize rowSize = static_cast<std::streamsize>( sizeof( T ) ) * size.x();
+                        for ( int z = 0 ; z < size.z() && fout ; ++z ) {
+                                for ( int y = 0 ; y < size.y() && fout ; ++y ) {
+                                        fout.write( reinterpret_cast<const char*>( data.getPointer( y, z ) ), rowSize );
+                                }
+                        }
+                        fout.close();
+                        if ( !fout ) {
+                                std::cerr<<"warning : "<<tmpname<<" cannot be written."<<std::endl;
+                                std::remove( tmpname.c_str() );
+                                return false;
+                        }
+                        std::remove( filename.c_str() ); // rename() does not replace files on some platforms.
+                        if ( std::rename( tmpname.c_str(), filename.c_str() ) != 0 ) {
+                                std::cerr<<"warning : "<<filename<<" cannot be written."<<std::endl;
+                                std::remove( tmpname.c_str() );
+                                return false;
+                        }
+                        return true;
+                }
+        private:
+                struct header {
+                        char magic[4];
+                        uint32_t version;
+                        uint32_t valueSize;
+                        int32_t size[3];
+                        double pitch[3];
+                        double origin[3];
+                        uint64_t key;
+                };
+
+                static size_t body_offset ( void ) {
+                        return 4096;
+                }
+
+                /**
+                 * @brief Header with volume information. Other fields and padding bytes are zero, so that it can be hashed.
+                 */
+                static header header_of ( VolumeInfo& info ) {
+                        header h;
+                        std::memset( &h, 0, sizeof( h ) );
+                        const Point3i size = info.getSize();
+                        const Point3d pitch = info.getPitch();
+                        const Point3d origin = info.getOrigin();
+                        h.size[0] = size.x();
+                        h.size[1] = size.y();
+                        h.size[2] = size.z();
+                        h.pitch[0] = pitch.x();
+                        h.pitch[1] = pitch.y();
+                        h.pitch[2] = pitch.z();
+                        h.origin[0] = origin.x();
+                        h.origin[1] = origin.y();
+                        h.origin[2] = origin.z();
+                        return h;
+                }
+
+                static uint64_t rotl ( const uint64_t x, const int r ) {
+                        return ( x << r ) | ( x >> ( 64 - r ) );
+                }
+
+                static uint64_t mix ( uint64_t h, uint64_t k ) {
+                        k *= 0x87c37b91114253d5ULL;
+                        k = VolumeDataCache::rotl( k, 31 );
+                        k *= 0x4cf5ad432745937fULL;
+                        h ^= k;
+                        return VolumeDataCache::rotl( h, 27 ) * 5 + 0x52dce729ULL;
+                }
+
+                /**
+                 * @brief Hash bytes 8 bytes at a time ( MurmurHash3-like mixing ).
+                 */
+                static uint64_t hash_bytes ( const void* ptr, const size_t n, const uint64_t seed ) {
+                        const unsigned char* p = static_cast<const unsigned char*>( ptr );
+                        uint64_t h = seed ^ ( n * 0x9e3779b97f4a7c15ULL );
+                        size_t i = 0;
+                        for ( ; i + 8 <= n ; i += 8 ) {
+                                uint64_t k;
+                                std::memcpy( &k, p + i, 8 );
+                                h = VolumeDataCache::mix( h, k );
+                        }
+                        uint64_t k = 0;
+                        for ( size_t j = 0 ; i + j < n ; ++j ) k |= static_cast<uint64_t>( p[i + j] ) << ( 8 * j );
+                        h = VolumeDataCache::mix( h, k );
+                        h ^= h >> 33;
+                        h *= 0xff51afd7ed558ccdULL;
+                        h ^= h >> 33;
+                        h *= 0xc4ceb9fe1a85ec53ULL;
+                        h ^= h >> 33;
+                        return h;
+                }
+
+                /**
+                 * @brief Hash a range of slices. Rows of a slice are chained.
+                 */
+                template <class Volume>
+                class hash_fn
+                {
+                private:
+                        Volume& _data;
+                        std::vector<uint64_t>& _slices;
+                        const int _numChunks;
+                public:
+                        hash_fn ( Volume& data, std::vector<uint64_t>& slices, const int numChunks ) : _data( data ), _slices( slices ), _numChunks( numChunks ) {
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                const Point3i size = this->_data.getInfo().getSize();
+                                const int zbegin = static_cast<int>( static_cast<long long>( size.z() ) * chunk / this->_numChunks );
+                                const int zend   = static_cast<int>( static_cast<long long>( size.z() ) * ( chunk + 1 ) / this->_numChunks );
+                                const size_t rowSize = sizeof( *this->_data.getPointer( 0, 0 ) ) * static_cast<size_t>( size.x() );
+                                for ( int z = zbegin ; z < zend ; ++z ) {
+                                        uint64_t h = static_cast<uint64_t>( z );
+                                        for ( int y = 0 ; y < size.y() ; ++y ) h = VolumeDataCache::hash_bytes( this->_data.getPointer( y, z ), rowSize, h );
+                                        this->_slices[ static_cast<size_t>( z ) ] = h;
+                                }
+                                return;
+                        }
+                };
+        };
+}
+#endif// MI_VOLUME_DATA_CACHE_HPP
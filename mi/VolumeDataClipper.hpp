@@ -10,7 +10,7 @@
 #include <cstdlib>
 
 #include "VolumeData.hpp"
-#include "FunctionObject.hpp"
+#include "VolumeView.hpp"
 namespace mi
 {
         /**
@@ -45,35 +45,39 @@ namespace mi
                  * @retval true Succeeded.
                  * @retval false Failed.
                  */
-                int clip ( const  mi::Point3d& bmin, const mi::Point3d& bmax, mi::VolumeData<T>& clippedImage, const int nthread = 1 ) {
+                bool clip ( const  mi::Point3d& bmin, const mi::Point3d& bmax, mi::VolumeData<T>& clippedImage, const int nthread = 1 ) {
                         const mi::Point3i &minp = this->_data.getInfo().getPointInVoxel( bmin );
                         const mi::Point3i &maxp = this->_data.getInfo().getPointInVoxel( bmax );
-                        return this->clip( minp, maxp, clippedImage );
+                        return this->clip( minp, maxp, clippedImage, nthread );
                 }
                 /**
                  * @brief Clip volume data.
                  * @param [in] bmin Bounding box ( min ) .
                  * @param [in] bmax Bounding box ( max ) .
-                 * @param [out] clippedImage Clipped result.
+                 * @param [out] clippedImage Clipped result. It is initialized with the size of the box.
+                 * @param [in] nthread The number of threads.
                  * @retval true Succeeded.
                  * @retval false Failed.
                  */
-                bool clip ( const  mi::Point3i& bmin, const mi::Point3i& bmax, mi::VolumeData<T>& clippedImage ) {
-                        const mi::VolumeInfo& info = this->_data.getInfo();
-                        if ( !info.isValid( bmin ) || !info.isValid( bmax ) ) {
-                                std::cerr<<"error. bounding box is out-of-range."<<std::endl;
-                                return false;
-                        }
+                bool clip ( const  mi::Point3i& bmin, const mi::Point3i& bmax, mi::VolumeData<T>& clippedImage, const int nthread = 1 ) {
+                        mi::VolumeView<T> view;
+                        if ( !this->clip( bmin, bmax, view ) ) return false;
+                        return view.copyTo( clippedImage, nthread );
+                }
+                /**
+                 * @brief Clip volume data without copying voxels.
+                 * @param [in] bmin Bounding box ( min ) .
+                 * @param [in] bmax Bounding box ( max ) .
+                 * @param [out] view View of the box. It refers to the original volume.
+                 * @retval true Succeeded.
+                 * @retval false Failed.
+                 */
+                bool clip ( const  mi::Point3i& bmin, const mi::Point3i& bmax, mi::VolumeView<T>& view ) {
                         if( bmax.x() < bmin.x() || bmax.y() < bmin.y() || bmax.z() < bmin.z() ) {
                                 std::cerr<<"bmin and bmax are invalid"<<std::endl;
                                 return false;
                         }
-                        const mi::Point3i size   = bmax - bmin + mi::Point3i( 1,1,1 );
-                        const mi::Point3d &pitch  = this->_data.getInfo().getPitch();
-                        const mi::Point3d &origin = this->_data.getInfo().getPointInSpace( bmin );
-                        mi::VolumeInfo newInfo( size, pitch, origin );
-                        std::for_each( newInfo.begin(), newInfo.end(), copy_voxel<T>( this->_data, clippedImage, bmin ) );
-                        return true;
+                        return view.init( this->_data, bmin, bmax );
                 }
         private:
                 VolumeData<T>& _data; ///< Original image.
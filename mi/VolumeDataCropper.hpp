@@ -0,0 +1,149 @@
+/**
+ * @file VolumeDataCropper.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_VOLUME_DATA_CROPPER_HPP
+#define MI_VOLUME_DATA_CROPPER_HPP 1
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include "VolumeData.hpp"
+#include "VolumeView.hpp"
+#include "ParallelFor.hpp"
+namespace mi
+{
+        /**
+         * @class VolumeDataCropper VolumeDataCropper.hpp <mi/VolumeDataCropper.hpp>
+         * @brief Crop volume data to the active region.
+         *
+         * compute() finds the bounding box of voxels whose values are the iso-value or more, and crop()
+         * copies the box. The origin of the cropped volume is moved to the corner of the box, so that
+         * positions in space ( VolumeInfo::getPointInSpace() ) are the same as those in the original volume.
+         */
+        template <typename T>
+        class VolumeDataCropper
+        {
+        private:
+                VolumeDataCropper ( const VolumeDataCropper& that );
+                void operator = ( const VolumeDataCropper& that );
+        private:
+                VolumeData<T>& _data; ///< Original volume.
+                int _nthread; ///< The number of threads.
+                Point3i _bmin; ///< Bounding box ( min ).
+                Point3i _bmax; ///< Bounding box ( max ).
+        public:
+                /**
+                 * @brief Constructor.
+                 * @param [in] data Volume data.
+                 */
+                explicit VolumeDataCropper ( VolumeData<T>& data ) : _data( data ), _nthread( 1 ), _bmin( 0, 0, 0 ), _bmax( data.getInfo().getMax() ) {
+                        return;
+                }
+
+                /**
+                 * @brief Set the number of threads.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                VolumeDataCropper<T>& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
+
+                /**
+                 * @brief Compute the bounding box of the active region.
+                 * @param [in] isovalue Voxels of this value or more are active.
+                 * @param [in] margin Margin added to each side of the box ( voxels ). The box is clamped by the volume.
+                 * @retval true Success.
+                 * @retval false There is no active voxel.
+                 */
+                bool compute ( const T isovalue, const int margin = 0 ) {
+                        const Point3i size = this->_data.getInfo().getSize();
+                        const int n = std::max( 1, std::min( this->_nthread, size.z() ) );
+                        std::vector<Point3i> bmin( n, size );
+                        std::vector<Point3i> bmax( n, Point3i( -1, -1, -1 ) );
+                        std::vector<int> chunks( n );
+                        for ( int i = 0 ; i < n ; ++i ) chunks[i] = i;
+                        bbox_fn fn( this->_data, isovalue, bmin, bmax );
+                        if ( n == 1 ) fn( 0 );
+                        else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+
+                        Point3i lo = size;
+                        Point3i hi( -1, -1, -1 );
+                        for ( int i = 0 ; i < n ; ++i ) {
+                                if ( bmax[i].x() < 0 ) continue; // no active voxel in the chunk.
+                                lo = Point3i( std::min( lo.x(), bmin[i].x() ), std::min( lo.y(), bmin[i].y() ), std::min( lo.z(), bmin[i].z() ) );
+                                hi = Point3i( std::max( hi.x(), bmax[i].x() ), std::max( hi.y(), bmax[i].y() ), std::max( hi.z(), bmax[i].z() ) );
+                        }
+                        if ( hi.x() < 0 ) return false;
+                        const int m = std::max( 0, margin );
+                        this->_bmin = Point3i( std::max( 0, lo.x() - m ), std::max( 0, lo.y() - m ), std::max( 0, lo.z() - m ) );
+                        this->_bmax = Point3i( std::min( size.x() - 1, hi.x() + m ), std::min( size.y() - 1, hi.y() + m ), std::min( size.z() - 1, hi.z() + m ) );
+                        return true;
+                }
+
+                inline Point3i getMin ( void ) const {
+                        return this->_bmin;
+                }
+
+                inline Point3i getMax ( void ) const {
+                        return this->_bmax;
+                }
+
+                /**
+                 * @brief Copy voxels in the bounding box. Use VolumeView to refer to the box without copying.
+                 * @param [out] outData Cropped volume. It keeps its halo setting.
+                 * @retval true Success.
+                 * @retval false The volume is not readable.
+                 */
+                bool crop ( VolumeData<T>& outData ) {
+                        if ( !this->_data.isReadable() ) {
+                                std::cerr<<"volume data is not readable."<<std::endl;
+                                return false;
+                        }
+                        return VolumeView<T>( this->_data, this->_bmin, this->_bmax ).copyTo( outData, this->_nthread );
+                }
+        private:
+                /**
+                 * @brief Bounding box of active voxels in a range of slices.
+                 */
+                class bbox_fn
+                {
+                private:
+                        const VolumeData<T>& _data;
+                        const T _isovalue;
+                        std::vector<Point3i>& _bmin;
+                        std::vector<Point3i>& _bmax;
+                public:
+                        bbox_fn ( const VolumeData<T>& data, const T isovalue, std::vector<Point3i>& bmin, std::vector<Point3i>& bmax ) :
+                                _data( data ), _isovalue( isovalue ), _bmin( bmin ), _bmax( bmax ) {
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                const Point3i size = const_cast<VolumeData<T>&>( this->_data ).getInfo().getSize();
+                                const int n = static_cast<int>( this->_bmin.size() );
+                                const int zbegin = static_cast<int>( static_cast<long long>( size.z() ) * chunk / n );
+                                const int zend   = static_cast<int>( static_cast<long long>( size.z() ) * ( chunk + 1 ) / n );
+                                Point3i lo = size;
+                                Point3i hi( -1, -1, -1 );
+                                for ( int z = zbegin ; z < zend ; ++z ) {
+                                        for ( int y = 0 ; y < size.y() ; ++y ) {
+                                                const T* row = this->_data.getPointer( y, z );
+                                                int x0 = 0;
+                                                while ( x0 < size.x() && row[x0] < this->_isovalue ) ++x0;
+                                                if ( x0 == size.x() ) continue;
+                                                int x1 = size.x() - 1;
+                                                while ( row[x1] < this->_isovalue ) --x1;
+                                                lo = Point3i( std::min( lo.x(), x0 ), std::min( lo.y(), y ), std::min( lo.z(), z ) );
+                                                hi = Point3i( std::max( hi.x(), x1 ), std::max( hi.y(), y ), std::max( hi.z(), z ) );
+                                        }
+                                }
+                                this->_bmin[chunk] = lo;
+                                this->_bmax[chunk] = hi;
+                                return;
+                        }
+                };
+        };
+}
+#endif// MI_VOLUME_DATA_CROPPER_HPP
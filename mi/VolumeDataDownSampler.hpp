@@ -0,0 +1,214 @@
+/**
+ * @file VolumeDataDownSampler.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_VOLUME_DATA_DOWN_SAMPLER_HPP
+#define MI_VOLUME_DATA_DOWN_SAMPLER_HPP 1
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <iostream>
+#include <algorithm>
+#include <type_traits>
+#include "VolumeData.hpp"
+#include "ParallelFor.hpp"
+namespace mi
+{
+        /**
+         * @class VolumeDataDownSampler VolumeDataDownSampler.hpp <mi/VolumeDataDownSampler.hpp>
+         * @brief Reduce volume data by an integer factor.
+         *
+         * Each output voxel is the mean ( BOX ), maximum ( MAX ) or minimum ( MIN ) of a factor^3 block of
+         * input voxels. Blocks at the upper boundary are truncated. The rows of a block are first reduced
+         * into a row buffer ( contiguous loops ), then groups of factor voxels of the buffer are reduced.
+         * Output slices are processed in parallel. The origin is moved to the center of the first block, so
+         * that output voxels are placed at the centers of their blocks in space.
+         * MAX of binary data keeps thin structures ( e.g. walls ) and MIN keeps thin cavities.
+         */
+        template <typename T>
+        class VolumeDataDownSampler
+        {
+        public:
+                enum Mode {
+                        BOX = 0, ///< Mean.
+                        MAX = 1, ///< Maximum.
+                        MIN = 2  ///< Minimum.
+                };
+        private:
+                VolumeDataDownSampler ( const VolumeDataDownSampler& that );
+                void operator = ( const VolumeDataDownSampler& that );
+        private:
+                VolumeData<T>& _inData;
+                VolumeData<T>& _outData;
+                int _nthread; ///< The number of threads.
+        public:
+                explicit VolumeDataDownSampler ( VolumeData<T>& inData, VolumeData<T>& outData ) : _inData( inData ), _outData( outData ), _nthread( 1 ) {
+                        return;
+                }
+
+                /**
+                 * @brief Set the number of threads.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                VolumeDataDownSampler<T>& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
+
+                /**
+                 * @brief Downsample volume data.
+                 * @param [in] factor Reduction factor ( 2 : half size ).
+                 * @param [in] mode Reduction.
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                bool sample ( const int factor, const Mode mode = BOX ) {
+                        if ( !this->_inData.isReadable() ) {
+                                std::cerr<<"volume data is not readable."<<std::endl;
+                                return false;
+                        }
+                        if ( factor < 1 ) {
+                                std::cerr<<"invalid factor : "<<factor<<std::endl;
+                                return false;
+                        }
+                        VolumeInfo newInfo;
+                        VolumeDataDownSampler<T>::create_new_volume_info( factor, this->_inData.getInfo(), newInfo );
+                        this->_outData.init( newInfo );
+
+                        const int sz = newInfo.getSize().z();
+                        const int n = std::max( 1, std::min( this->_nthread, sz ) );
+                        std::vector<int> chunks( n );
+                        for ( int i = 0 ; i < n ; ++i ) chunks[i] = i;
+                        if ( mode == MAX ) {
+                                reduce_fn<max_op> fn( this->_inData, this->_outData, factor, n );
+                                if ( n == 1 ) fn( 0 );
+                                else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                        } else if ( mode == MIN ) {
+                                reduce_fn<min_op> fn( this->_inData, this->_outData, factor, n );
+                                if ( n == 1 ) fn( 0 );
+                                else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                        } else {
+                                reduce_fn<box_op> fn( this->_inData, this->_outData, factor, n );
+                                if ( n == 1 ) fn( 0 );
+                                else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                        }
+                        return true;
+                }
+
+                /**
+                 * @brief Compute information of the downsampled volume.
+                 * @param [in] factor Reduction factor.
+                 * @param [in] info Information of the input volume.
+                 * @param [out] newInfo Information of the output volume.
+                 */
+                static void create_new_volume_info ( const int factor, VolumeInfo& info, VolumeInfo& newInfo ) {
+                        const Point3i& size  = info.getSize();
+                        const Point3d& pitch = info.getPitch();
+                        const Point3i newSize( ( size.x() + factor - 1 ) / factor, ( size.y() + factor - 1 ) / factor, ( size.z() + factor - 1 ) / factor );
+                        const Point3d newPitch = pitch * factor;
+                        const Point3d newOrigin = info.getOrigin() + pitch * ( 0.5 * ( factor - 1 ) );
+                        newInfo.init( newSize, newPitch, newOrigin );
+                        return;
+                }
+        private:
+                /**
+                 * @brief Mean. Values are accumulated in double.
+                 */
+                struct box_op {
+                        typedef double value_type;
+                        static value_type init ( void ) {
+                                return 0;
+                        }
+                        static value_type apply ( const value_type a, const value_type b ) {
+                                return a + b;
+                        }
+                        static T finish ( const value_type v, const int count ) {
+                                const double mean = v / count;
+                                if ( std::is_integral<T>::value ) return static_cast<T>( std::floor( mean + 0.5 ) );
+                                return static_cast<T>( mean );
+                        }
+                };
+
+                struct max_op {
+                        typedef T value_type;
+                        static value_type init ( void ) {
+                                return std::numeric_limits<T>::lowest();
+                        }
+                        static value_type apply ( const value_type a, const value_type b ) {
+                                return a < b ? b : a;
+                        }
+                        static T finish ( const value_type v, const int /*count*/ ) {
+                                return v;
+                        }
+                };
+
+                struct min_op {
+                        typedef T value_type;
+                        static value_type init ( void ) {
+                                return std::numeric_limits<T>::max();
+                        }
+                        static value_type apply ( const value_type a, const value_type b ) {
+                                return b < a ? b : a;
+                        }
+                        static T finish ( const value_type v, const int /*count*/ ) {
+                                return v;
+                        }
+                };
+
+                /**
+                 * @brief Reduce blocks of a range of output slices.
+                 */
+                template <class Op>
+                class reduce_fn
+                {
+                private:
+                        VolumeData<T>& _inData;
+                        VolumeData<T>& _outData;
+                        const int _factor;
+                        const int _numChunks;
+                public:
+                        reduce_fn ( VolumeData<T>& inData, VolumeData<T>& outData, const int factor, const int numChunks ) :
+                                _inData( inData ), _outData( outData ), _factor( factor ), _numChunks( numChunks ) {
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                typedef typename Op::value_type value_type;
+                                const Point3i isize = this->_inData.getInfo().getSize();
+                                const Point3i osize = this->_outData.getInfo().getSize();
+                                const int f = this->_factor;
+                                const int zbegin = static_cast<int>( static_cast<long long>( osize.z() ) * chunk / this->_numChunks );
+                                const int zend   = static_cast<int>( static_cast<long long>( osize.z() ) * ( chunk + 1 ) / this->_numChunks );
+                                std::vector<value_type> acc( static_cast<size_t>( isize.x() ) );
+                                for ( int z = zbegin ; z < zend ; ++z ) {
+                                        const int z0 = z * f;
+                                        const int z1 = std::min( z0 + f, isize.z() );
+                                        for ( int y = 0 ; y < osize.y() ; ++y ) {
+                                                const int y0 = y * f;
+                                                const int y1 = std::min( y0 + f, isize.y() );
+                                                std::fill( acc.begin(), acc.end(), Op::init() );
+                                                value_type* a = &acc[0];
+                                                for ( int iz = z0 ; iz < z1 ; ++iz ) {
+                                                        for ( int iy = y0 ; iy < y1 ; ++iy ) {
+                                                                const T* row = this->_inData.getPointer( iy, iz );
+                                                                for ( int x = 0 ; x < isize.x() ; ++x ) a[x] = Op::apply( a[x], static_cast<value_type>( row[x] ) );
+                                                        }
+                                                }
+                                                const int nyz = ( z1 - z0 ) * ( y1 - y0 );
+                                                T* out = this->_outData.getPointer( y, z );
+                                                for ( int x = 0 ; x < osize.x() ; ++x ) {
+                                                        const int x0 = x * f;
+                                                        const int x1 = std::min( x0 + f, isize.x() );
+                                                        value_type v = Op::init();
+                                                        for ( int ix = x0 ; ix < x1 ; ++ix ) v = Op::apply( v, a[ix] );
+                                                        out[x] = Op::finish( v, nyz * ( x1 - x0 ) );
+                                                }
+                                        }
+                                }
+                                return;
+                        }
+                };
+        };
+}
+#endif// MI_VOLUME_DATA_DOWN_SAMPLER_HPP
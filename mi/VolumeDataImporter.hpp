@@ -5,13 +5,65 @@
 #ifndef MI_VOLUME_DATA_IMPORTER_HPP
 #define MI_VOLUME_DATA_IMPORTER_HPP 1
 #include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <limits>
+#include <cmath>
 #include "VolumeData.hpp"
 #include "Importer.hpp"
+#include "ParallelFor.hpp"
+#ifndef OS_WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#endif
 namespace mi
 {
+        /**
+         * @enum RawValueType
+         * @brief Value type of voxels stored in raw files.
+         */
+        enum RawValueType {
+                RAW_NATIVE = 0, ///< Same type as the volume data.
+                RAW_CHAR,
+                RAW_UCHAR,
+                RAW_SHORT,
+                RAW_USHORT,
+                RAW_INT,
+                RAW_UINT,
+                RAW_FLOAT,
+                RAW_DOUBLE
+        };
+
+        /**
+         * @brief Convert type name ( "char", "uchar", "short", "ushort", "int", "uint", "float", "double" ) to RawValueType.
+         * @param [in] name Type name. Empty string means RAW_NATIVE.
+         * @param [out] type Value type.
+         * @retval true Success.
+         * @retval false Unknown type name.
+         */
+        inline bool getRawValueType ( const std::string& name, RawValueType& type ) {
+                const char* names[] = { "", "char", "uchar", "short", "ushort", "int", "uint", "float", "double" };
+                for ( int i = 0 ; i < 9 ; ++i ) {
+                        if ( name.compare( names[i] ) == 0 ) {
+                                type = static_cast<RawValueType>( i );
+                                return true;
+                        }
+                }
+                std::cerr<<"unknown value type "<<name<<std::endl;
+                return false;
+        }
+
         /**
          * @class VolumeDataImporter
          * @brief Importer for raw file.
+         *
+         * Voxels can be stored in another type ( setValueType() ) and/or in big-endian order ( setBigEndian() ).
+         * They are converted as static_cast<T>( value + offset ) ( setOffset() ).
+         * The file is read in large blocks by setNumThread() threads in parallel, and each block is converted
+         * directly into the storage of the volume data.
          */
         template <typename T>
         class VolumeDataImporter : public Importer
@@ -19,6 +71,10 @@ namespace mi
         private:
                 VolumeData<T>& _data; ///< Data.
                 const size_t   _header_size; ///< Header size ( byte ).
+                RawValueType   _type; ///< Value type in the file.
+                bool           _isBigEndian; ///< Byte order in the file.
+                double         _offset; ///< Offset added to values.
+                int            _nthread; ///< The number of threads.
         public:
                 /**
                  * @brief Constructor.
@@ -26,7 +82,136 @@ namespace mi
                  * @param [in] header_size Header size (byte).
                  */
                 explicit VolumeDataImporter ( VolumeData<T>& data, const size_t header_size = 0 )
-                        : Importer ( true ), _data ( data ), _header_size ( header_size ) {
+                        : Importer ( true ), _data ( data ), _header_size ( header_size ), _type( RAW_NATIVE ), _isBigEndian( false ), _offset( 0 ), _nthread( 1 ) {
+                        return;
+                }
+
+                /**
+                 * @brief Set value type of the file.
+                 * @param [in] type Value type.
+                 * @return Instance itself.
+                 */
+                VolumeDataImporter<T>& setValueType ( const RawValueType type ) {
+                        this->_type = type;
+                        return *this;
+                }
+
+                /**
+                 * @brief Set byte order of the file.
+                 * @param [in] isBigEndian Set true if values are stored in big-endian.
+                 * @return Instance itself.
+                 */
+                VolumeDataImporter<T>& setBigEndian ( const bool isBigEndian = true ) {
+                        this->_isBigEndian = isBigEndian;
+                        return *this;
+                }
+
+                /**
+                 * @brief Set offset added to values.
+                 * @param [in] offset Offset.
+                 * @return Instance itself.
+                 */
+                VolumeDataImporter<T>& setOffset ( const double offset ) {
+                        this->_offset = offset;
+                        return *this;
+                }
+
+                /**
+                 * @brief Set the number of threads.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                VolumeDataImporter<T>& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
+
+                /**
+                 * @brief Read data from a file.
+                 * @param [in] filename File name.
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                bool read ( const std::string& filename ) {
+                        if ( !this->_data.isReadable() ) {
+                                std::cerr<<"error : volume data cannot be read. memory space is not allocated yet."<<std::endl;
+                                return false;
+                        }
+                        if ( this->_data.getHalo() > 0 ) return Importer::read( filename ); // rows are not contiguous.
+                        const Point3i& size = this->_data.getInfo().getSize ();
+                        const size_t numVoxels = static_cast<size_t>( size.x() ) * static_cast<size_t>( size.y() ) * static_cast<size_t>( size.z() );
+                        const size_t bytes = this->get_value_size() * numVoxels;
+                        {
+                                std::ifstream fin ( filename.c_str(), std::ios::in | std::ios::binary );
+                                if ( !fin ) {
+                                        std::cerr<<filename<<" cannot be open."<<std::endl;
+                                        return false;
+                                }
+                                fin.seekg( 0, std::ios::end );
+                                const std::streamoff fileSize = fin.tellg();
+                                if ( fileSize < 0 || static_cast<size_t>( fileSize ) < this->_header_size + bytes ) {
+                                        std::cerr<<"reading data failed. file size "<<fileSize<<" is smaller than "<<this->_header_size + bytes<<" bytes."<<std::endl;
+                                        return false;
+                                }
+                        }
+                        std::cerr<<"reading data from "<<filename<<" as "<<this->toString()<<" format ... ";
+
+#ifndef OS_WINDOWS
+                        const int fd = ::open( filename.c_str(), O_RDONLY );
+                        if ( fd < 0 ) {
+                                std::cerr<<"failed."<<std::endl;
+                                return false;
+                        }
+#else
+                        const int fd = -1;
+#endif
+                        const int nthread = static_cast<int>( std::min<size_t>( static_cast<size_t>( this->_nthread ), std::max<size_t>( numVoxels / ( 1 << 16 ), 1 ) ) );
+                        std::vector<int> result( nthread, 0 );
+                        read_fn fn( *this, filename, fd, numVoxels, nthread, result );
+                        if ( nthread == 1 ) {
+                                fn( 0 );
+                        } else {
+                                std::vector<int> chunks;
+                                for ( int i = 0 ; i < nthread ; ++i ) chunks.push_back( i );
+                                mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                        }
+#ifndef OS_WINDOWS
+                        ::close( fd );
+#endif
+                        for ( int i = 0 ; i < nthread ; ++i ) {
+                                if ( result[i] == 0 ) {
+                                        std::cerr<<"failed."<<std::endl<<"reading data failed."<<std::endl;
+                                        return false;
+                                }
+                        }
+                        std::cerr<<"done."<<std::endl;
+                        return true;
+                }
+                /**
+                 * @brief Get the size of a value in the file.
+                 * @return Size (byte).
+                 */
+                size_t getValueSize ( void ) const {
+                        return this->get_value_size();
+                }
+
+                /**
+                 * @brief Check if values in the file can be copied to the volume without conversion.
+                 * @retval true No conversion is needed.
+                 * @retval false Conversion is needed.
+                 */
+                bool isDirect ( void ) const {
+                        return this->is_direct();
+                }
+
+                /**
+                 * @brief Convert values in the file format to T.
+                 * @param [in,out] src Values in the file format. It is overwritten when bytes are swapped.
+                 * @param [out] dst Destination.
+                 * @param [in] n The number of values.
+                 */
+                void decode ( char* src, T* dst, const size_t n ) const {
+                        this->convert( src, dst, n );
                         return;
                 }
         protected:
@@ -53,19 +238,16 @@ namespace mi
                         }
 
                         const Point3i& size = this->_data.getInfo().getSize ();
-                        std::vector<T> buffer ( size.x() * size.y(), T() );
-                        const size_t bufSize = sizeof ( T ) * buffer.size();
-
+                        const size_t sx = static_cast<size_t>( size.x() );
+                        const size_t rowBytes = this->get_value_size() * sx;
+                        std::vector<char> buffer ( rowBytes * static_cast<size_t>( size.y() ) );
                         for ( int z = 0 ; z < size.z() ; ++z ) {
-                                if( !fin.read ( ( char* ) & ( buffer[0] ), bufSize ) ) {
-					std::cerr<<"size"<<sizeof (T)<<std::endl;
+                                if( !fin.read ( &buffer[0], static_cast<std::streamsize>( buffer.size() ) ) ) {
                                         std::cerr<<"reading data failed."<<z<<"/"<<size.z()<<std::endl;
                                         return false;
                                 }
                                 for ( int y = 0 ; y < size.y() ; ++y ) {
-                                        for ( int x = 0 ; x < size.x() ; ++x ) {
-                                                this->_data.at ( x, y, z ) = buffer[ x +  y * size.x() ];
-                                        }
+                                        this->convert( &buffer[ rowBytes * y ], this->_data.getPointer( y, z ), sx );
                                 }
                         }
                         return true;
@@ -84,7 +266,230 @@ namespace mi
                 std::string toString ( void ) const {
                         return std::string ( "raw" );
                 }
+        private:
+                /**
+                 * @brief Read a part of voxels in a thread.
+                 */
+                class read_fn
+                {
+                private:
+                        VolumeDataImporter<T>& _importer;
+                        const std::string& _filename;
+                        const int _fd;
+                        const size_t _numVoxels;
+                        const int _numChunks;
+                        std::vector<int>& _result;
+                public:
+                        read_fn ( VolumeDataImporter<T>& importer, const std::string& filename, const int fd, const size_t numVoxels, const int numChunks, std::vector<int>& result )
+                                : _importer( importer ), _filename( filename ), _fd( fd ), _numVoxels( numVoxels ), _numChunks( numChunks ), _result( result ) {
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                this->_result[chunk] = this->_importer.read_range( this->_filename, this->_fd,
+                                                       this->_numVoxels * chunk / this->_numChunks,
+                                                       this->_numVoxels * ( chunk + 1 ) / this->_numChunks ) ? 1 : 0;
+                                return;
+                        }
+                };
+
+                /**
+                 * @brief Read voxels [begin, end) in x-fastest order.
+                 */
+                bool read_range ( const std::string& filename, const int fd, const size_t begin, const size_t end ) {
+                        const size_t blockSize = 1 << 20; // voxels per read.
+                        const size_t valueSize = this->get_value_size();
+                        const bool isDirect = this->is_direct();
+                        std::vector<char> buffer;
+                        if ( !isDirect ) buffer.resize( valueSize * std::min( blockSize, end - begin ) );
+#ifdef OS_WINDOWS
+                        std::ifstream fin( filename.c_str(), std::ios::in | std::ios::binary );
+                        if ( !fin ) return false;
+#endif
+                        T* dst = this->_data.getPointer() ;
+                        for ( size_t i = begin ; i < end ; i += blockSize ) {
+                                const size_t n = std::min( blockSize, end - i );
+                                char* buf = isDirect ? reinterpret_cast<char*>( dst + i ) : &buffer[0];
+                                const size_t offset = this->_header_size + valueSize * i;
+#ifndef OS_WINDOWS
+                                size_t done = 0;
+                                while ( done < valueSize * n ) {
+                                        const ssize_t r = ::pread( fd, buf + done, valueSize * n - done, static_cast<off_t>( offset + done ) );
+                                        if ( r <= 0 ) break;
+                                        done += static_cast<size_t>( r );
+                                }
+                                const bool isRead = ( done == valueSize * n );
+#else
+                                fin.seekg( static_cast<std::streamoff>( offset ), std::ios::beg );
+                                const bool isRead = !!fin.read( buf, static_cast<std::streamsize>( valueSize * n ) );
+#endif
+                                if ( !isRead ) {
+                                        std::cerr<<filename<<" : reading bytes from "<<offset<<" failed."<<std::endl;
+                                        return false;
+                                }
+                                if ( !isDirect ) this->convert( buf, dst + i, n );
+                        }
+                        return true;
+                }
+
+                /**
+                 * @brief Check if the file can be read into the volume without conversion.
+                 */
+                bool is_direct ( void ) const {
+                        return ( this->_type == RAW_NATIVE && this->_offset == 0 && !this->need_swap() );
+                }
+
+                bool need_swap ( void ) const {
+                        const unsigned short one = 1;
+                        const bool isLittleEndianHost = ( *reinterpret_cast<const unsigned char*>( &one ) == 1 );
+                        return ( this->_isBigEndian == isLittleEndianHost ) && this->get_value_size() > 1;
+                }
+
+                size_t get_value_size ( void ) const {
+                        switch ( this->_type ) {
+                        case RAW_CHAR:
+                        case RAW_UCHAR:
+                                return 1;
+                        case RAW_SHORT:
+                        case RAW_USHORT:
+                                return 2;
+                        case RAW_INT:
+                        case RAW_UINT:
+                        case RAW_FLOAT:
+                                return 4;
+                        case RAW_DOUBLE:
+                                return 8;
+                        default:
+                                return sizeof( T );
+                        }
+                }
+
+                /**
+                 * @brief Convert n values in the file format to T. src is overwritten when bytes are swapped.
+                 */
+                void convert ( char* src, T* dst, const size_t n ) const {
+                        switch ( this->_type ) {
+                        case RAW_CHAR:
+                                this->convert_values<char>( src, dst, n );
+                                break;
+                        case RAW_UCHAR:
+                                this->convert_values<unsigned char>( src, dst, n );
+                                break;
+                        case RAW_SHORT:
+                                this->convert_values<short>( src, dst, n );
+                                break;
+                        case RAW_USHORT:
+                                this->convert_values<unsigned short>( src, dst, n );
+                                break;
+                        case RAW_INT:
+                                this->convert_values<int>( src, dst, n );
+                                break;
+                        case RAW_UINT:
+                                this->convert_values<unsigned int>( src, dst, n );
+                                break;
+                        case RAW_FLOAT:
+                                this->convert_values<float>( src, dst, n );
+                                break;
+                        case RAW_DOUBLE:
+                                this->convert_values<double>( src, dst, n );
+                                break;
+                        default:
+                                this->convert_values<T>( src, dst, n );
+                                break;
+                        }
+                        return;
+                }
 
+                /**
+                 * @brief Convert values.
+                 *
+                 * Values of the same type without offset are copied after byte swapping. When every value of S plus
+                 * the offset fits in T, values are converted by a loop without branches. Otherwise values out of the
+                 * range of T are clamped to it, and values are rounded to the nearest integer when T is an integer
+                 * type. NaN becomes 0. Infinity and NaN are kept when T is a floating point type as wide as S.
+                 */
+                template <typename S>
+                void convert_values ( char* src, T* dst, const size_t n ) const {
+                        if ( this->need_swap() ) swap_bytes( src, n, sizeof( S ) );
+                        const S* values = reinterpret_cast<const S*>( src );
+                        const double offset = this->_offset;
+                        if ( is_same_type<S>() && offset == 0 ) {
+                                std::memcpy( dst, values, n * sizeof( T ) );
+                        } else if ( this->fits<S>() ) {
+                                if ( std::numeric_limits<T>::is_integer ) {
+                                        const long long ioffset = static_cast<long long>( offset );
+                                        for ( size_t i = 0 ; i < n ; ++i ) dst[i] = static_cast<T>( static_cast<long long>( values[i] ) + ioffset );
+                                } else {
+                                        for ( size_t i = 0 ; i < n ; ++i ) dst[i] = static_cast<T>( static_cast<double>( values[i] ) + offset );
+                                }
+                        } else {
+                                for ( size_t i = 0 ; i < n ; ++i ) dst[i] = clamp_value( static_cast<double>( values[i] ) + offset );
+                        }
+                        return;
+                }
+
+                template <typename S>
+                static bool is_same_type ( void ) {
+                        return sizeof( S ) == sizeof( T ) && std::numeric_limits<S>::is_integer == std::numeric_limits<T>::is_integer &&
+                               std::numeric_limits<S>::is_signed == std::numeric_limits<T>::is_signed;
+                }
+
+                /**
+                 * @brief Check if every value of S plus the offset is a value of T, so no clamping or rounding is needed.
+                 */
+                template <typename S>
+                bool fits ( void ) const {
+                        const double offset = this->_offset;
+                        if ( std::numeric_limits<T>::is_integer ) {
+                                if ( !std::numeric_limits<S>::is_integer || offset != std::floor( offset ) ) return false; // rounding.
+                        } else if ( !std::numeric_limits<S>::is_integer && sizeof( S ) > sizeof( T ) ) {
+                                return false; // double to float can overflow.
+                        }
+                        const double lo = static_cast<double>( std::numeric_limits<S>::lowest() ) + offset;
+                        const double hi = static_cast<double>( std::numeric_limits<S>::max() ) + offset;
+                        return ( static_cast<double>( std::numeric_limits<T>::lowest() ) <= lo && hi <= static_cast<double>( std::numeric_limits<T>::max() ) );
+                }
+
+                static T clamp_value ( double v ) {
+                        const double lo = static_cast<double>( std::numeric_limits<T>::lowest() );
+                        const double hi = static_cast<double>( std::numeric_limits<T>::max() );
+                        if ( std::numeric_limits<T>::is_integer ) v = std::floor( v + 0.5 );
+                        if ( v >= hi ) return std::numeric_limits<T>::max();
+                        if ( v <= lo ) return std::numeric_limits<T>::lowest();
+                        if ( v != v ) return T( 0 );
+                        return static_cast<T>( v );
+                }
+
+                /**
+                 * @brief Reverse byte order of n values in place.
+                 */
+                static void swap_bytes ( char* buf, const size_t n, const size_t valueSize ) {
+                        switch ( valueSize ) {
+                        case 2:
+                                for ( size_t i = 0 ; i < n ; ++i ) {
+                                        const char c0 = buf[ 2 * i + 0 ];
+                                        buf[ 2 * i + 0 ] = buf[ 2 * i + 1 ];
+                                        buf[ 2 * i + 1 ] = c0;
+                                }
+                                break;
+                        case 4:
+                                for ( size_t i = 0 ; i < n ; ++i ) {
+                                        const char c0 = buf[ 4 * i + 0 ];
+                                        const char c1 = buf[ 4 * i + 1 ];
+                                        buf[ 4 * i + 0 ] = buf[ 4 * i + 3 ];
+                                        buf[ 4 * i + 1 ] = buf[ 4 * i + 2 ];
+                                        buf[ 4 * i + 2 ] = c1;
+                                        buf[ 4 * i + 3 ] = c0;
+                                }
+                                break;
+                        default:
+                                for ( size_t i = 0 ; i < n ; ++i ) {
+                                        std::reverse( buf + valueSize * i, buf + valueSize * ( i + 1 ) );
+                                }
+                                break;
+                        }
+                        return;
+                }
         };
 }
 #endif// MI_VOLUME_DATA_IMPORTER_HPP
@@ -14,6 +14,7 @@
 #include "mc_table.hpp"
 #include "Mesh.hpp"
 #include "Range.hpp"
+#include "SparseVolumeData.hpp"
 namespace mi
 {
         /**
@@ -36,21 +37,31 @@ namespace mi
                 private:
                         S _value;
                         mi::VolumeData<S>* _data;
+                        mi::SparseVolumeData<S>* _sparse;
                         bool _isMonotone;
                 public:
                         Data( mi::VolumeData<S>& data ) {
                                 this->_data = &data;
+                                this->_sparse = NULL;
+                                this->_isMonotone = false;
+                        }
+
+                        Data( mi::SparseVolumeData<S>& data ) {
+                                this->_data = NULL;
+                                this->_sparse = &data;
                                 this->_isMonotone = false;
                         }
 
                         Data( const S value ) {
                                 this->_value = value;
                                 this->_data = NULL;
+                                this->_sparse = NULL;
                                 this->_isMonotone = true;
                         }
 
                         S get ( const mi::Point3i &p ) {
                                 if ( this->_isMonotone ) return this->_value;
+                                else if ( this->_sparse != NULL ) return this->_sparse->get( p );
                                 else return this->_data->get( p );
                         }
                 };
@@ -132,44 +143,117 @@ namespace mi
                         return this->polygonize( iso, maskdata, mesh );
                 }
 
+                /**
+                * @brief Polygonize the volume data with a sparse mask.
+                * @param [in] isovalue Iso value ot the volume data.
+                * @param [out] mesh Mesh object.
+                * @param [in] mask Mask image. Only cells touching allocated bricks are visited.
+                * @return The number of triangles.
+                */
+                int polygonize( const float isovalue, Mesh& mesh, mi::SparseVolumeData<char>& mask ) {
+                        if ( mask.isReadable() == false ) return 0;
+                        Data<float> iso( isovalue );
+                        const int b = mi::SparseVolumeData<char>::getBrickSize();
+                        const mi::Range range = this->get_range();
+                        const mi::Point3i bmin = range.getMin();
+                        const mi::Point3i bmax = range.getMax();
+                        const int nbx = ( mask.getSize().x() + b - 1 ) / b;
+                        std::vector<char> columns( nbx ); // bricks touched by cells of a row are allocated.
+                        int numTriangles = 0;
+                        // cells are visited in the same order as polygonize( Data<float>&, Data<char>&, Mesh& ).
+                        for( int z = bmin.z() ; z <= bmax.z() ; ++z ) {
+                                for( int y = bmin.y() ; y <= bmax.y() ; ++y ) {
+                                        bool isAllocated = false;
+                                        for( int bx = 0 ; bx < nbx ; ++bx ) {
+                                                columns[bx] = 0;
+                                                for( int i = 0 ; i < 4 ; ++i ) {
+                                                        if ( mask.getBrick( bx * b, y + ( i & 1 ), z + ( i >> 1 ) ) != NULL ) columns[bx] = 1;
+                                                }
+                                                if ( columns[bx] ) isAllocated = true;
+                                        }
+                                        if ( !isAllocated ) continue;
+                                        for( int x = bmin.x() ; x <= bmax.x() ; ++x ) {
+                                                if ( !columns[ x / b ] && !columns[ ( x + 1 ) / b ] ) continue;
+                                                if ( !this->is_masked( mask, x, y, z ) ) continue;
+                                                numTriangles += this->polygonize_at( mi::Point3i( x, y, z ), iso, mesh );
+                                        }
+                                }
+                        }
+                        return numTriangles;
+                }
+
 
                 int polygonize( Data<float>& isovalue, Data<char>& mask, Mesh& mesh ) {
                         int numTriangles = 0;
                         mi::Range range = this->get_range();
-                        mi::Range drange( mi::Point3i( 0,0,0 ),  mi::Point3i( 1, 1, 1 ) );
                         for( mi::Range::iterator iter = range.begin() ; iter != range.end() ; ++iter ) {
                                 const mi::Point3i& p = *iter;
-                                std::vector<double> iso;
-                                iso.reserve( 8 );
                                 bool isPolygonized = false;
-                                std::vector<std::pair<Point3d, double> > cell;
-                                cell.reserve( 8 );
-                                for( mi::Range::iterator diter = drange.begin() ; diter != drange.end() ; ++diter ) {
-                                        const Point3i dp = *diter;
-                                        const Point3i np = p + dp;
-                                        const Point3d pd = this->_data.getInfo().getPointInSpace( np );
-                                        const double v = this->_data.get( np );
-                                        cell.push_back( std::make_pair( pd, v ) );
-                                        iso.push_back( static_cast<double>( isovalue.get( np ) ) );
+                                for( int i = 0 ; i < 8 && !isPolygonized ; ++i ) {
+                                        const Point3i np( p.x() + ( i & 1 ), p.y() + ( ( i >> 1 ) & 1 ), p.z() + ( i >> 2 ) );
                                         if( mask.get( np ) > 0 ) isPolygonized = true;
                                 }
-                                if ( isPolygonized ) numTriangles += this->polygonize_cell( cell, iso, mesh );
+                                if ( !isPolygonized ) continue;
+                                numTriangles += this->polygonize_at( p, isovalue, mesh );
                         }
                         return numTriangles;
                 }
         private:
+                /**
+                * @brief Polygonize the cell whose minimum corner is p.
+                */
+                int polygonize_at( const mi::Point3i& p, Data<float>& isovalue, Mesh& mesh ) {
+                        double iso[8];
+                        Point3d pos[8];
+                        double value[8];
+                        int i = 0;
+                        for( int dz = 0 ; dz <= 1 ; ++dz ) {
+                                for( int dy = 0 ; dy <= 1 ; ++dy ) {
+                                        for( int dx = 0 ; dx <= 1 ; ++dx, ++i ) {
+                                                const Point3i np( p.x() + dx, p.y() + dy, p.z() + dz );
+                                                pos[i]   = this->_data.getInfo().getPointInSpace( np );
+                                                value[i] = this->_data.get( np );
+                                                iso[i]   = static_cast<double>( isovalue.get( np ) );
+                                        }
+                                }
+                        }
+                        return this->polygonize_cell( pos, value, iso, mesh );
+                }
+
+                /**
+                * @brief Check if a corner of the cell is in the sparse mask. A cell inside a brick is read from the brick directly.
+                */
+                static bool is_masked( const mi::SparseVolumeData<char>& mask, const int x, const int y, const int z ) {
+                        const int b = mi::SparseVolumeData<char>::getBrickSize();
+                        const int m = b - 1;
+                        if ( ( x & m ) != m && ( y & m ) != m && ( z & m ) != m ) {
+                                const char* brick = mask.getBrick( x, y, z );
+                                if ( brick == NULL ) return false;
+                                const char* v = brick + ( ( ( z & m ) * b + ( y & m ) ) * b + ( x & m ) );
+                                for( int i = 0 ; i < 8 ; ++i ) {
+                                        if ( v[ ( i & 1 ) + ( ( i >> 1 ) & 1 ) * b + ( i >> 2 ) * b * b ] > 0 ) return true;
+                                }
+                                return false;
+                        }
+                        for( int i = 0 ; i < 8 ; ++i ) {
+                                if ( mask.get( x + ( i & 1 ), y + ( ( i >> 1 ) & 1 ), z + ( i >> 2 ) ) > 0 ) return true;
+                        }
+                        return false;
+                }
+
                 /**
                 * @brief Polygonize a cell.
-                * @param [in] cell Cell.
+                * @param [in] pos Positions of the cell corners.
+                * @param [in,out] value Values at the cell corners.
                 * @param [in] isovalue Iso value ot the volume data.
                 * @param [out] mesh Mesh object.
                 * @return The number of triangles in a cell .
                 */
-                int polygonize_cell( std::vector< std::pair<Point3d, double> >& cell, const std::vector<double>& isovalue, Mesh& mesh ) {
+                int polygonize_cell( const Point3d* pos, double* value, const double* isovalue, Mesh& mesh ) {
                         unsigned char tableid = 0x00;
                         for( int i = 0 ; i < 8 ; ++i ) {
-                                if ( std::fabs( cell[i].second - isovalue[i] ) < this->_iso_eps ) cell[i].second = isovalue[i] + this->_iso_eps ;
-                                if ( isovalue[i] <=  cell[i].second ) tableid += ( 0x01 <<i );
+                                if ( std::fabs( value[i] - isovalue[i] ) < this->_iso_eps ) value[i] = isovalue[i] + this->_iso_eps ;
+                                if ( isovalue[i] <=  value[i] ) tableid += ( 0x01 <<i );
                         }
                         if ( tableid == 0x00 || tableid == 0xFF ) return 0;
                         Vector3d ep[12];
@@ -177,8 +261,8 @@ namespace mi
                                 const int& id0 = mc_edtable[ 2 * i + 0];
                                 const int& id1 = mc_edtable[ 2 * i + 1];
 
-                                const double& v0 = cell[id0].second;
-                                const double& v1 = cell[id1].second;
+                                const double& v0 = value[id0];
+                                const double& v1 = value[id1];
                                 if ( ( ( tableid >> id0 ) & 0x01 )  == ( ( tableid >> id1 )& 0x01 ) ) continue;
 
                                 const double& iso0 = isovalue[id0];
@@ -186,8 +270,8 @@ namespace mi
 
                                 double t  = -( v0 - iso0 )  / ( ( v1 - v0 ) - ( iso1 - iso0 ) ) ;	 ///@todo check 0 division
 
-                                const Point3d& p0 = cell[id0].first;
-                                const Point3d& p1 = cell[id1].first;
+                                const Point3d& p0 = pos[id0];
+                                const Point3d& p1 = pos[id1];
 
                                 ep[i].x() = ( 1.0 - t ) * p0.x () + t * p1.x();
                                 ep[i].y() = ( 1.0 - t ) * p0.y () + t * p1.y();
@@ -197,7 +281,7 @@ namespace mi
                         int numTriangles = 0;
                         for( int i =  mc_colidx[tableid] ; i < mc_colidx[tableid+1] ; i += 3 ) {
                                 ++numTriangles;
-                                std::vector<int> idx( 3, 0 );
+                                Mesh::Face idx;
                                 // check invert
                                 idx[0] = mesh.addPoint( ep[ mc_idxtable[i  ] ] );
                                 idx[1] = mesh.addPoint( ep[ mc_idxtable[i+2] ] );
@@ -0,0 +1,120 @@
+/**
+ * @file VolumeDataPyramid.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_VOLUME_DATA_PYRAMID_HPP
+#define MI_VOLUME_DATA_PYRAMID_HPP 1
+#include <vector>
+#include <utility>
+#include "VolumeData.hpp"
+#include "VolumeDataDownSampler.hpp"
+namespace mi
+{
+        /**
+         * @class VolumeDataPyramid VolumeDataPyramid.hpp <mi/VolumeDataPyramid.hpp>
+         * @brief Multi-resolution pyramid of volume data.
+         *
+         * Level 0 is the original volume and level k + 1 is level k downsampled by 2. Levels are computed
+         * on the first request and cached until clear() or setMode() is called. The original volume is
+         * referred to, not copied, and must not be modified while the pyramid is in use.
+         * References to levels are invalidated when a coarser level is computed for the first time.
+         */
+        template <typename T>
+        class VolumeDataPyramid
+        {
+        private:
+                VolumeDataPyramid ( const VolumeDataPyramid& that );
+                void operator = ( const VolumeDataPyramid& that );
+        public:
+                typedef typename VolumeDataDownSampler<T>::Mode Mode;
+        private:
+                VolumeData<T>& _data; ///< Level 0.
+                Mode _mode; ///< Reduction.
+                int _nthread; ///< The number of threads.
+                std::vector<VolumeData<T> > _levels; ///< Cached levels ( 1, 2, ... ).
+        public:
+                /**
+                 * @brief Constructor.
+                 * @param [in] data Original volume.
+                 * @param [in] mode Reduction.
+                 */
+                explicit VolumeDataPyramid ( VolumeData<T>& data, const Mode mode = VolumeDataDownSampler<T>::BOX ) : _data( data ), _mode( mode ), _nthread( 1 ) {
+                        return;
+                }
+
+                ~VolumeDataPyramid ( void ) {
+                        return;
+                }
+
+                /**
+                 * @brief Set the number of threads.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                VolumeDataPyramid<T>& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
+
+                /**
+                 * @brief Set the reduction. Cached levels are released when it is changed.
+                 * @param [in] mode Reduction.
+                 * @return Instance itself.
+                 */
+                VolumeDataPyramid<T>& setMode ( const Mode mode ) {
+                        if ( mode != this->_mode ) this->clear();
+                        this->_mode = mode;
+                        return *this;
+                }
+
+                /**
+                 * @brief Get the number of levels whose sizes are minSize or more in all axes.
+                 * @param [in] minSize Minimum size ( voxels ).
+                 * @return The number of levels including level 0.
+                 */
+                int getNumLevels ( const int minSize = 1 ) {
+                        Point3i size = this->_data.getInfo().getSize();
+                        int n = 1;
+                        for ( ;; ) {
+                                size = Point3i( ( size.x() + 1 ) / 2, ( size.y() + 1 ) / 2, ( size.z() + 1 ) / 2 );
+                                if ( size.x() < minSize || size.y() < minSize || size.z() < minSize ) break;
+                                if ( size.x() == 1 && size.y() == 1 && size.z() == 1 ) break;
+                                ++n;
+                        }
+                        return n;
+                }
+
+                /**
+                 * @brief Get a level. Missing levels are computed from the finest cached one.
+                 * @param [in] level Level ( 0 : original ).
+                 * @return Volume data of the level.
+                 */
+                VolumeData<T>& getLevel ( const int level ) {
+                        if ( level <= 0 ) return this->_data;
+                        while ( static_cast<int>( this->_levels.size() ) < level ) {
+                                VolumeData<T> data;
+                                VolumeDataDownSampler<T>( this->getLevel( static_cast<int>( this->_levels.size() ) ), data ).setNumThread( this->_nthread ).sample( 2, this->_mode );
+                                this->_levels.push_back( std::move( data ) );
+                        }
+                        return this->_levels[ static_cast<size_t>( level - 1 ) ];
+                }
+
+                /**
+                 * @brief Get the reduction factor of a level to the original volume.
+                 * @param [in] level Level.
+                 * @return Factor ( 2^level ).
+                 */
+                static int getFactor ( const int level ) {
+                        return level <= 0 ? 1 : ( 1 << level );
+                }
+
+                /**
+                 * @brief Release cached levels.
+                 */
+                void clear ( void ) {
+                        std::vector<VolumeData<T> >().swap( this->_levels );
+                        return;
+                }
+        };
+}
+#endif// MI_VOLUME_DATA_PYRAMID_HPP
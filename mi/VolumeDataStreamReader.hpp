@@ -0,0 +1,284 @@
+/**
+ * @file VolumeDataStreamReader.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_VOLUME_DATA_STREAM_READER_HPP
+#define MI_VOLUME_DATA_STREAM_READER_HPP 1
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "VolumeData.hpp"
+#include "VolumeDataImporter.hpp"
+namespace mi
+{
+        /**
+         * @class VolumeDataStreamReader
+         * @brief Read a raw file slab by slab on a background thread.
+         *
+         * The I/O thread reads a slab of slices while the caller processes the previous one.
+         * Slices are stored into the volume data as they arrive, so the slab being read and the slab
+         * being processed never share memory, and the whole volume is available after the last slab.
+         * Values are converted in the same way as VolumeDataImporter through a slab-sized staging buffer.
+         * @code
+         * mi::VolumeDataStreamReader<short> reader( data );
+         * if ( !reader.open( filename ) ) return false;
+         * int zbegin, zend;
+         * while ( reader.next( zbegin, zend ) ) {
+         *         // process slices [zbegin, zend).
+         * }
+         * if ( !reader.close() ) return false;
+         * @endcode
+         */
+        template <typename T>
+        class VolumeDataStreamReader
+        {
+        private:
+                VolumeDataStreamReader ( const VolumeDataStreamReader<T>& that );
+                void operator = ( const VolumeDataStreamReader<T>& that );
+        private:
+                VolumeData<T>& _data; ///< Data.
+                VolumeDataImporter<T> _importer; ///< Value conversion.
+                const size_t _header_size; ///< Header size ( byte ).
+                int _slab; ///< The number of slices per slab.
+
+                std::string _filename;
+                std::thread _thread;
+                std::mutex _mutex;
+                std::condition_variable _cond;
+                int _ready; ///< Slices [0, _ready) are available.
+                int _consumed; ///< Slices [0, _consumed) are passed to the caller.
+                bool _failed;
+                bool _abort;
+
+                size_t _bytes; ///< Bytes read.
+                double _ioTime; ///< Time spent in the I/O thread ( sec ).
+                double _stallTime; ///< Time the caller waited for data ( sec ).
+        public:
+                /**
+                 * @brief Constructor.
+                 * @param [out] data Data. Memory space must be allocated.
+                 * @param [in] header_size Header size (byte).
+                 */
+                explicit VolumeDataStreamReader ( VolumeData<T>& data, const size_t header_size = 0 )
+                        : _data( data ), _importer( data, header_size ), _header_size( header_size ), _slab( 16 ),
+                          _ready( 0 ), _consumed( 0 ), _failed( false ), _abort( false ),
+                          _bytes( 0 ), _ioTime( 0 ), _stallTime( 0 ) {
+                        return;
+                }
+
+                /**
+                 * @brief Destructor. The I/O thread is stopped.
+                 */
+                ~VolumeDataStreamReader ( void ) {
+                        {
+                                std::lock_guard<std::mutex> lock( this->_mutex );
+                                this->_abort = true;
+                        }
+                        this->_cond.notify_all();
+                        if ( this->_thread.joinable() ) this->_thread.join();
+                        return;
+                }
+
+                /**
+                 * @brief Set value type of the file.
+                 * @param [in] type Value type.
+                 * @return Instance itself.
+                 */
+                VolumeDataStreamReader<T>& setValueType ( const RawValueType type ) {
+                        this->_importer.setValueType( type );
+                        return *this;
+                }
+
+                /**
+                 * @brief Set byte order of the file.
+                 * @param [in] isBigEndian Set true if values are stored in big-endian.
+                 * @return Instance itself.
+                 */
+                VolumeDataStreamReader<T>& setBigEndian ( const bool isBigEndian = true ) {
+                        this->_importer.setBigEndian( isBigEndian );
+                        return *this;
+                }
+
+                /**
+                 * @brief Set offset added to values.
+                 * @param [in] offset Offset.
+                 * @return Instance itself.
+                 */
+                VolumeDataStreamReader<T>& setOffset ( const double offset ) {
+                        this->_importer.setOffset( offset );
+                        return *this;
+                }
+
+                /**
+                 * @brief Set the number of slices per slab.
+                 * @param [in] slab The number of slices.
+                 * @return Instance itself.
+                 */
+                VolumeDataStreamReader<T>& setSlabSize ( const int slab ) {
+                        this->_slab = slab < 1 ? 1 : slab;
+                        return *this;
+                }
+
+                /**
+                 * @brief Open a file and start reading on the background thread.
+                 * @param [in] filename File name.
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                bool open ( const std::string& filename ) {
+                        if ( this->_thread.joinable() ) {
+                                std::cerr<<"error : stream is already open."<<std::endl;
+                                return false;
+                        }
+                        if ( !this->_data.isReadable() ) {
+                                std::cerr<<"error : volume data cannot be read. memory space is not allocated yet."<<std::endl;
+                                return false;
+                        }
+                        if ( this->_data.getHalo() > 0 ) {
+                                std::cerr<<"error : volume data with halo cannot be streamed."<<std::endl;
+                                return false;
+                        }
+                        const Point3i& size = this->_data.getInfo().getSize ();
+                        const size_t bytes = this->_importer.getValueSize() * static_cast<size_t>( size.x() ) * static_cast<size_t>( size.y() ) * static_cast<size_t>( size.z() );
+                        std::ifstream fin ( filename.c_str(), std::ios::in | std::ios::binary );
+                        if ( !fin ) {
+                                std::cerr<<filename<<" cannot be open."<<std::endl;
+                                return false;
+                        }
+                        fin.seekg( 0, std::ios::end );
+                        const std::streamoff fileSize = fin.tellg();
+                        if ( fileSize < 0 || static_cast<size_t>( fileSize ) < this->_header_size + bytes ) {
+                                std::cerr<<"reading data failed. file size "<<fileSize<<" is smaller than "<<this->_header_size + bytes<<" bytes."<<std::endl;
+                                return false;
+                        }
+                        this->_filename = filename;
+                        this->_ready = 0;
+                        this->_consumed = 0;
+                        this->_failed = false;
+                        this->_abort = false;
+                        this->_bytes = 0;
+                        this->_ioTime = 0;
+                        this->_stallTime = 0;
+                        this->_thread = std::thread( &VolumeDataStreamReader<T>::read_slabs, this );
+                        return true;
+                }
+
+                /**
+                 * @brief Wait for the next slab.
+                 * @param [out] zbegin First slice of the slab.
+                 * @param [out] zend End of the slab ( exclusive ).
+                 * @retval true Slices [zbegin, zend) are available.
+                 * @retval false All slices were returned, or reading failed.
+                 */
+                bool next ( int& zbegin, int& zend ) {
+                        const int sz = this->_data.getInfo().getSize().z();
+                        std::unique_lock<std::mutex> lock( this->_mutex );
+                        if ( this->_consumed >= sz ) return false;
+                        if ( this->_ready <= this->_consumed && !this->_failed ) {
+                                const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+                                this->_cond.wait( lock, [this] { return this->_ready > this->_consumed || this->_failed; } );
+                                this->_stallTime += std::chrono::duration<double>( std::chrono::steady_clock::now() - t0 ).count();
+                        }
+                        if ( this->_ready <= this->_consumed ) return false;
+                        zbegin = this->_consumed;
+                        zend   = this->_ready;
+                        this->_consumed = zend;
+                        return true;
+                }
+
+                /**
+                 * @brief Wait for the I/O thread.
+                 * @retval true All slices were read.
+                 * @retval false Reading failed.
+                 */
+                bool close ( void ) {
+                        if ( this->_thread.joinable() ) this->_thread.join();
+                        return !this->_failed && this->_ready == this->_data.getInfo().getSize().z();
+                }
+
+                /**
+                 * @brief Get the number of bytes read.
+                 * @return Bytes.
+                 */
+                size_t getBytes ( void ) const {
+                        return this->_bytes;
+                }
+
+                /**
+                 * @brief Get the reading throughput of the I/O thread.
+                 * @return Bytes per second.
+                 */
+                double getBytesPerSecond ( void ) const {
+                        return this->_ioTime > 0 ? static_cast<double>( this->_bytes ) / this->_ioTime : 0;
+                }
+
+                /**
+                 * @brief Get the time the caller waited for slabs.
+                 * @return Time ( sec ).
+                 */
+                double getStallTime ( void ) const {
+                        return this->_stallTime;
+                }
+
+                /**
+                 * @brief Print statistics.
+                 * @param [in] out Output stream.
+                 */
+                void print ( std::ostream& out ) const {
+                        out<<"stream read : "<<this->_bytes<<" bytes, "
+                           <<this->getBytesPerSecond() / ( 1024.0 * 1024.0 )<<" MB/s, stall "
+                           <<this->_stallTime<<" sec"<<std::endl;
+                        return;
+                }
+        private:
+                /**
+                 * @brief Body of the I/O thread.
+                 */
+                void read_slabs ( void ) {
+                        const Point3i& size = this->_data.getInfo().getSize ();
+                        const size_t valueSize = this->_importer.getValueSize();
+                        const size_t sliceVoxels = static_cast<size_t>( size.x() ) * static_cast<size_t>( size.y() );
+                        const bool isDirect = this->_importer.isDirect();
+                        std::vector<char> staging;
+                        if ( !isDirect ) staging.resize( sliceVoxels * static_cast<size_t>( std::min( this->_slab, size.z() ) ) * valueSize );
+
+                        bool ok = true;
+                        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                        std::ifstream fin ( this->_filename.c_str(), std::ios::in | std::ios::binary );
+                        if ( !fin || !fin.seekg( static_cast<std::streamoff>( this->_header_size ), std::ios::beg ) ) ok = false;
+                        for ( int z = 0 ; ok && z < size.z() ; z += this->_slab ) {
+                                const int zend = std::min( z + this->_slab, size.z() );
+                                const size_t n = sliceVoxels * static_cast<size_t>( zend - z );
+                                T* dst = this->_data.getPointer( 0, z );
+                                char* buf = isDirect ? reinterpret_cast<char*>( dst ) : &staging[0];
+                                if ( !fin.read( buf, static_cast<std::streamsize>( n * valueSize ) ) ) {
+                                        std::cerr<<"reading data failed."<<std::endl;
+                                        ok = false;
+                                        break;
+                                }
+                                if ( !isDirect ) this->_importer.decode( buf, dst, n );
+                                {
+                                        std::lock_guard<std::mutex> lock( this->_mutex );
+                                        this->_bytes += n * valueSize;
+                                        this->_ready = zend;
+                                        if ( this->_abort ) break;
+                                }
+                                this->_cond.notify_all();
+                        }
+                        {
+                                std::lock_guard<std::mutex> lock( this->_mutex );
+                                this->_ioTime = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+                                if ( !ok ) this->_failed = true;
+                        }
+                        this->_cond.notify_all();
+                        return;
+                }
+        };
+}
+#endif// MI_VOLUME_DATA_STREAM_READER_HPP
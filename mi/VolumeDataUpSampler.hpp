@@ -1,10 +1,23 @@
 #ifndef MI_VOLUME_DATA_UP_SAMPLER_HPP
 #define MI_VOLUME_DATA_UP_SAMPLER_HPP 1
 #include <iostream>
+#include <vector>
+#include <algorithm>
 #include "VolumeData.hpp"
+#include "ParallelFor.hpp"
 
 namespace mi
 {
+        /**
+         * @class VolumeDataUpSampler VolumeDataUpSampler.hpp <mi/VolumeDataUpSampler.hpp>
+         * @brief Upsample volume data by trilinear interpolation.
+         *
+         * Interpolation is separable : each input slice is interpolated along x and then along y into a
+         * buffer, and two buffered slices are blended along z into rows of the output. Weights and cell
+         * indices are computed once per axis. Output slices are processed in parallel, and each thread
+         * keeps the two interpolated slices it currently uses. Values are the same as those of the
+         * cell-by-cell interpolation ( the same operations in double in the same order ).
+         */
         template<typename T>
         class VolumeDataUpSampler
         {
@@ -14,11 +27,30 @@ namespace mi
         private:
                 VolumeData<T> &_inData;
                 VolumeData<T> &_outData;
+                int _nthread;
         public:
-                explicit VolumeDataUpSampler( VolumeData<T>& inData, VolumeData<T>& outData ) : _inData( inData ), _outData( outData ) {
+                explicit VolumeDataUpSampler( VolumeData<T>& inData, VolumeData<T>& outData ) : _inData( inData ), _outData( outData ), _nthread( 1 ) {
                         return;
                 }
 
+                /**
+                 * @brief Set the number of threads.
+                 * @param [in] nthread The number of threads.
+                 * @return Instance itself.
+                 */
+                VolumeDataUpSampler<T>& setNumThread ( const int nthread ) {
+                        this->_nthread = nthread < 1 ? 1 : nthread;
+                        return *this;
+                }
+
+                /**
+                 * @brief Upsample volume data.
+                 *
+                 * Output voxel X is at X / scale in the input. Voxels after the last input voxel
+                 * ( X > ( size - 1 ) * scale ) are 0.
+                 * @param [in] scale Scaling factor.
+                 * @retval true Success.
+                 */
                 bool sample ( const int scale ) {
                         VolumeInfo& info     = this->_inData.getInfo();
                         const Point3i& size  = info.getSize();
@@ -26,55 +58,16 @@ namespace mi
                         VolumeInfo newInfo;
                         this->create_new_volume_info( scale, info, newInfo );
                         this->_outData.init( newInfo, true );
-
-                        for( int z = 0 ; z < size.z() - 1; ++z ) {
-                                for( int y = 0 ; y < size.y() - 1; ++y ) {
-                                        for( int x = 0 ; x < size.x() - 1; ++x ) {
-                                                const Point3i p( x,y,z );
-                                                std::vector<T> values;
-                                                for( int dz = 0 ; dz < 2 ; ++dz ) {
-                                                        for( int dy = 0 ; dy < 2 ; ++dy ) {
-                                                                for( int dx = 0 ; dx < 2 ; ++dx ) {
-                                                                        values.push_back( this->_inData.get( x+dx, y+dy, z+dz ) );
-                                                                }
-                                                        }
-                                                }
-
-                                                for( int dz = 0 ; dz <= scale ; ++dz ) {
-                                                        for( int dy = 0 ; dy <= scale ; ++dy ) {
-                                                                for( int dx = 0 ; dx <= scale ; ++dx ) {
-                                                                        Point3i dp( dx, dy, dz );
-                                                                        if( dx == scale && x < size.x() - 2 ) continue;
-                                                                        if( dy == scale && y < size.y() - 2 ) continue;
-                                                                        if( dz == scale && z < size.z() - 2 ) continue;
-
-                                                                        const double s = dx * 1.0 / scale;
-                                                                        const double t = dy * 1.0 / scale;
-                                                                        const double u = dz * 1.0 / scale;
-
-                                                                        const double v0 = ( 1.0 - s ) * values[0] + s * values[1];
-                                                                        const double v1 = ( 1.0 - s ) * values[2] + s * values[3];
-                                                                        const double v2 = ( 1.0 - s ) * values[4] + s * values[5];
-                                                                        const double v3 = ( 1.0 - s ) * values[6] + s * values[7];
-
-                                                                        const double v4 = ( 1.0 - t ) * v0        + t * v1;
-                                                                        const double v5 = ( 1.0 - t ) * v2        + t * v3;
-
-                                                                        const double v6 = ( 1.0 - u ) * v4        + u * v5;
-
-                                                                        const T result = static_cast<T>( v6 );
-
-                                                                        Point3i np;
-                                                                        np.x() = scale * p.x() + dp.x();
-                                                                        np.y() = scale * p.y() + dp.y();
-                                                                        np.z() = scale * p.z() + dp.z();
-                                                                        this->_outData.set( np, result );
-                                                                }
-                                                        }
-                                                }
-                                        }
-                                }
-                        }
+                        if ( size.x() < 2 || size.y() < 2 || size.z() < 2 ) return true;
+
+                        const Point3i osize( ( size.x() - 1 ) * scale + 1, ( size.y() - 1 ) * scale + 1, ( size.z() - 1 ) * scale + 1 ); // written region.
+                        axis_weight wx( size.x(), scale ), wy( size.y(), scale ), wz( size.z(), scale );
+                        const int n = std::max( 1, std::min( this->_nthread, osize.z() ) );
+                        std::vector<int> chunks( n );
+                        for ( int i = 0 ; i < n ; ++i ) chunks[i] = i;
+                        sample_fn fn( this->_inData, this->_outData, osize, wx, wy, wz, n );
+                        if ( n == 1 ) fn( 0 );
+                        else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
                         return true;
                 }
 
@@ -97,7 +90,109 @@ namespace mi
                         return;
                 }
 
+                /**
+                 * @brief Cell index and weight of each output coordinate along an axis.
+                 */
+                class axis_weight
+                {
+                public:
+                        std::vector<int> cell; ///< Lower input voxel.
+                        std::vector<double> s; ///< Weight of the upper voxel.
+                public:
+                        axis_weight ( const int size, const int scale ) {
+                                const int n = ( size - 1 ) * scale + 1;
+                                this->cell.resize( n );
+                                this->s.resize( n );
+                                for ( int i = 0 ; i < n ; ++i ) {
+                                        const int c = std::min( i / scale, size - 2 );
+                                        this->cell[i] = c;
+                                        this->s[i] = ( i - c * scale ) * 1.0 / scale;
+                                }
+                                return;
+                        }
+                };
+
+                /**
+                 * @brief Interpolate a range of output slices.
+                 */
+                class sample_fn
+                {
+                private:
+                        VolumeData<T>& _inData;
+                        VolumeData<T>& _outData;
+                        const Point3i _osize;
+                        const axis_weight& _wx;
+                        const axis_weight& _wy;
+                        const axis_weight& _wz;
+                        const int _numChunks;
+                public:
+                        sample_fn ( VolumeData<T>& inData, VolumeData<T>& outData, const Point3i& osize,
+                                    const axis_weight& wx, const axis_weight& wy, const axis_weight& wz, const int numChunks ) :
+                                _inData( inData ), _outData( outData ), _osize( osize ), _wx( wx ), _wy( wy ), _wz( wz ), _numChunks( numChunks ) {
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                const int ox = this->_osize.x();
+                                const int oy = this->_osize.y();
+                                const int zbegin = static_cast<int>( static_cast<long long>( this->_osize.z() ) * chunk / this->_numChunks );
+                                const int zend   = static_cast<int>( static_cast<long long>( this->_osize.z() ) * ( chunk + 1 ) / this->_numChunks );
+                                const int sy = this->_inData.getInfo().getSize().y();
+                                std::vector<double> rows( static_cast<size_t>( sy ) * ox ); // rows of a slice interpolated along x.
+                                std::vector<double> slice[2]; // slices interpolated along x and y.
+                                slice[0].resize( static_cast<size_t>( oy ) * ox );
+                                slice[1].resize( static_cast<size_t>( oy ) * ox );
+                                int cached[2] = { -1, -1 }; // input slices in the buffers.
+                                for ( int z = zbegin ; z < zend ; ++z ) {
+                                        const int cz = this->_wz.cell[z];
+                                        if ( cached[0] != cz ) {
+                                                if ( cached[1] == cz ) {
+                                                        slice[0].swap( slice[1] );
+                                                        std::swap( cached[0], cached[1] );
+                                                } else {
+                                                        this->interpolate_slice( cz, rows, slice[0] );
+                                                        cached[0] = cz;
+                                                }
+                                        }
+                                        if ( cached[1] != cz + 1 ) {
+                                                this->interpolate_slice( cz + 1, rows, slice[1] );
+                                                cached[1] = cz + 1;
+                                        }
+                                        const double u = this->_wz.s[z];
+                                        for ( int y = 0 ; y < oy ; ++y ) {
+                                                const double* v4 = &slice[0][ static_cast<size_t>( y ) * ox ];
+                                                const double* v5 = &slice[1][ static_cast<size_t>( y ) * ox ];
+                                                T* out = this->_outData.getPointer( y, z );
+                                                for ( int x = 0 ; x < ox ; ++x ) out[x] = static_cast<T>( ( 1.0 - u ) * v4[x] + u * v5[x] );
+                                        }
+                                }
+                                return;
+                        }
+                private:
+                        void interpolate_slice ( const int z, std::vector<double>& rows, std::vector<double>& slice ) const {
+                                const int ox = this->_osize.x();
+                                const int oy = this->_osize.y();
+                                const int sy = this->_inData.getInfo().getSize().y();
+                                for ( int y = 0 ; y < sy ; ++y ) {
+                                        const T* in = this->_inData.getPointer( y, z );
+                                        double* row = &rows[ static_cast<size_t>( y ) * ox ];
+                                        for ( int x = 0 ; x < ox ; ++x ) {
+                                                const int c = this->_wx.cell[x];
+                                                const double s = this->_wx.s[x];
+                                                row[x] = ( 1.0 - s ) * in[c] + s * in[c + 1];
+                                        }
+                                }
+                                for ( int y = 0 ; y < oy ; ++y ) {
+                                        const int c = this->_wy.cell[y];
+                                        const double t = this->_wy.s[y];
+                                        const double* v0 = &rows[ static_cast<size_t>( c ) * ox ];
+                                        const double* v1 = &rows[ static_cast<size_t>( c + 1 ) * ox ];
+                                        double* dst = &slice[ static_cast<size_t>( y ) * ox ];
+                                        for ( int x = 0 ; x < ox ; ++x ) dst[x] = ( 1.0 - t ) * v0[x] + t * v1[x];
+                                }
+                                return;
+                        }
+                };
         };
 }
 #endif//
-
@@ -11,11 +11,18 @@
 #include "ConnectedComponentLabellerRle.hpp"
 #include "DistanceFieldComputer.hpp"
 #include "VolumeData.hpp"
+#include "BrickedVolumeData.hpp"
 #include "VolumeDataImporter.hpp"
 #include "VolumeDataExporter.hpp"
+#include "VolumeDataBrickImporter.hpp"
+#include "VolumeDataBrickExporter.hpp"
+#include "VolumeDataAsyncWriter.hpp"
 #include "VolumeDataPolygonizer.hpp"
 #include "VolumeDataUpSampler.hpp"
+#include "VolumeDataDownSampler.hpp"
 #include "VolumeDataClipper.hpp"
+#include "VolumeView.hpp"
+#include "RunLengthVolume.hpp"
 #include "ParallelFor.hpp"
 #include "FunctionObject.hpp"
 #include "Mesh.hpp"
@@ -79,8 +86,21 @@ namespace mi
                  */
                 template<typename T>
                 static bool clip ( VolumeData<T>& inData, const Point3i& bmin, const Point3i& bmax, VolumeData<T>& clippedData ) {
-                        VolumeDataClipper<T>( inData ).clip( bmin, bmax, clippedData, VolumeDataUtility::getNumThread() );
-                        return true;
+                        return VolumeDataClipper<T>( inData ).clip( bmin, bmax, clippedData, VolumeDataUtility::getNumThread() );
+                }
+
+                /**
+                 * @brief Create a view of a sub-box. Voxels are not copied.
+                 * @param [in] inData Input data.
+                 * @param [in] bmin Bounding box (min).
+                 * @param [in] bmax Bounding box (max).
+                 * @param [out] view View of the box.
+                 * @return true Success.
+                 * @return false Failure.
+                 */
+                template<typename T>
+                static bool clip ( VolumeData<T>& inData, const Point3i& bmin, const Point3i& bmax, VolumeView<T>& view ) {
+                        return VolumeDataClipper<T>( inData ).clip( bmin, bmax, view );
                 }
 
                 /**
@@ -88,12 +108,18 @@ namespace mi
                  * @param [in] filename File name.
                  * @param [in] header_size Header size (byte).
                  * @param [out] data Volume data.
+                 * @param [in] type Value type in the file.
+                 * @param [in] isBigEndian Set true if the file is big-endian.
+                 * @param [in] offset Offset added to values.
                  * @retval true Success.
                  * @retval false Failure.
                  */
                 template< typename T>
-                static bool open ( VolumeData<T>& data,  const std::string& filename, const int header_size = 0 ) {
-                        return VolumeDataImporter<T>( data, header_size ).read( filename ) ;
+                static bool open ( VolumeData<T>& data,  const std::string& filename, const int header_size = 0,
+                                   const RawValueType type = RAW_NATIVE, const bool isBigEndian = false, const double offset = 0 ) {
+                        VolumeDataImporter<T> importer( data, header_size );
+                        importer.setValueType( type ).setBigEndian( isBigEndian ).setOffset( offset ).setNumThread( VolumeDataUtility::getNumThread() );
+                        return importer.read( filename ) ;
                 }
 
                 /**
@@ -108,6 +134,56 @@ namespace mi
                         return VolumeDataExporter<T>( data ).write( filename ) ;
                 }
 
+                /**
+                 * @brief Open volume data in the chunked compressed format.
+                 * @param [out] data Volume data. Size, pitch and origin are read from the file.
+                 * @param [in] filename File name.
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                template< typename T>
+                static bool open_brick ( VolumeData<T>& data, const std::string& filename ) {
+                        VolumeDataBrickImporter<T> importer( data );
+                        importer.setNumThread( VolumeDataUtility::getNumThread() );
+                        return importer.read( filename ) ;
+                }
+
+                /**
+                 * @brief Save volume data in the chunked compressed format.
+                 * @param [in] data Volume data.
+                 * @param [in] filename File name.
+                 * @param [in] brickSize Brick size.
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                template< typename T>
+                static bool save_brick ( VolumeData<T>& data, const std::string& filename, const int brickSize = 64 ) {
+                        VolumeDataBrickExporter<T> exporter( data, brickSize );
+                        exporter.setNumThread( VolumeDataUtility::getNumThread() );
+                        return exporter.write( filename ) ;
+                }
+
+                /**
+                 * @brief Downsample volume data.
+                 * @param [in] inData Input data.
+                 * @param [out] outData Output data.
+                 * @param [in] factor Reduction factor.
+                 * @param [in] mode Reduction ( mean, maximum or minimum of each block ).
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                template <typename T>
+                static bool downsample ( VolumeData<T>& inData, VolumeData<T>& outData, const int factor = 2, const typename VolumeDataDownSampler<T>::Mode mode = VolumeDataDownSampler<T>::BOX ) {
+                        if ( !VolumeDataDownSampler<T> ( inData, outData ).setNumThread( VolumeDataUtility::getNumThread() ).sample( factor, mode ) ) {
+                                return false;
+                        }
+
+                        Point3i size  = outData.getInfo().getSize();
+                        Point3d pitch = outData.getInfo().getPitch();
+                        std::cerr<<"new size : "<<size.x()<<" "<<size.y()<<" "<<size.z()<<std::endl;
+                        std::cerr<<"new pitch : "<<pitch.x()<<" "<<pitch.y()<<" "<<pitch.z()<<std::endl;
+                        return true;
+                }
                 /**
                  * @brief Polygonize volume data.
                  * @param [in] data Volume data.
@@ -143,26 +219,88 @@ namespace mi
                         return true;
                 }
 
+                /**
+                 * @brief Binarize a sub-box of volume data.
+                 * @param [in] inView View of input data.
+                 * @param [out] outData Binarized data. It has the size of the view.
+                 * @param [in] isovalue Isovalue.
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                template<typename T>
+                static	bool binarize( VolumeView<T>& inView, VolumeData<char>& outData, const T isovalue , const bool negate = false ) {
+                        VolumeInfo& info = inView.getInfo();
+                        outData.init( info );
+
+                        const int grain_size = VolumeDataUtility::getGrainSize( info.getSize() );
+                        parallel_for_each( info.begin(), info.end(), binarize_voxel<T, VolumeView<T> >( inView, outData, isovalue , negate ), grain_size );
+
+                        return true;
+                }
+
                 /**
                  * @brief Erode volume data.
-                 * @param [in] inData Input data.
+                 * @param [in] inData Input data ( VolumeData<char> or BrickedVolumeData<char> ).
                  * @param [out] outData Output data.
                  * @param [in] r Size of structural element (or radius of sphere).
                  * @retval true Success.
                  * @retval false Failure.
                  */
-                static	bool erode( VolumeData<char>& inData, VolumeData<char>& outData, const double r ) {
+                template <class Volume>
+                static	bool erode( Volume& inData, VolumeData<char>& outData, const double r ) {
                         VolumeInfo& info = inData.getInfo();
                         const Point3i& size = info.getSize();
                         const int grain_size = size.x() * size.y() / VolumeDataUtility::getNumThread() * size.z();
                         outData.init( info );
-                        mi::parallel_for_each( info.begin(), info.end(), mi::erode( inData, outData, r ), grain_size );
+                        mi::parallel_for_each( info.begin(), info.end(), mi::erode<Volume>( inData, outData, r ), grain_size );
+                        return true;
+                }
+
+                /**
+                 * @brief Erode volume data.
+                 *
+                 * The sphere is probed without bounds checks. When the input has no halo of 1 covering the sphere
+                 * ( setHalo() ), a padded copy is made; the input is not modified.
+                 * @param [in] inData Input data.
+                 * @param [out] outData Output data.
+                 * @param [in] r Size of structural element (or radius of sphere).
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                static	bool erode( VolumeData<char>& inData, VolumeData<char>& outData, const double r ) {
+                        VolumeInfo& info = inData.getInfo();
+                        VolumeData<char> copy;
+                        VolumeData<char>& padded = VolumeDataUtility::pad( inData, mi::erode_padded::getMargin( info.getPitch(), r ), 1, copy );
+                        const int grain_size =  VolumeDataUtility::getGrainSize( info.getSize() );
+                        outData.init( info );
+                        mi::parallel_for_each( info.begin(), info.end(), mi::erode_padded( padded, outData, r ), grain_size );
                         return true;
                 }
 
 
                 /**
                  * @brief Dilate volume data.
+                 * @param [in] inData Input data ( VolumeData<char> or BrickedVolumeData<char> ).
+                 * @param [out] outData Output data.
+                 * @param [in] r Size of structural element (or radius of sphere).
+                 * @retval true Success.
+                 * @retval false Failure.
+                 */
+                template <class Volume>
+                static	bool dilate( Volume& inData, VolumeData<char>& outData, const double r ) {
+
+                        VolumeInfo& info = inData.getInfo();
+                        const int grain_size =  VolumeDataUtility::getGrainSize( info.getSize() );
+                        if ( !outData.isReadable() ) outData.init( info );
+                        parallel_for_each( info.begin(), info.end(), mi::dilate<Volume>( inData, outData, r ), grain_size );
+                        return true;
+                }
+
+                /**
+                 * @brief Dilate volume data.
+                 *
+                 * The sphere is probed without bounds checks. When the input has no halo of 0 covering the sphere
+                 * ( setHalo() ), a padded copy is made; the input is not modified.
                  * @param [in] inData Input data.
                  * @param [out] outData Output data.
                  * @param [in] r Size of structural element (or radius of sphere).
@@ -170,11 +308,12 @@ namespace mi
                  * @retval false Failure.
                  */
                 static	bool dilate( VolumeData<char>& inData, VolumeData<char>& outData, const double r ) {
-
                         VolumeInfo& info = inData.getInfo();
+                        VolumeData<char> copy;
+                        VolumeData<char>& padded = VolumeDataUtility::pad( inData, mi::erode_padded::getMargin( info.getPitch(), r ), 0, copy );
                         const int grain_size =  VolumeDataUtility::getGrainSize( info.getSize() );
                         if ( !outData.isReadable() ) outData.init( info );
-                        parallel_for_each( info.begin(), info.end(), mi::dilate( inData, outData, r ), grain_size );
+                        parallel_for_each( info.begin(), info.end(), mi::dilate_padded( padded, outData, r ), grain_size );
                         return true;
                 }
 
@@ -196,6 +335,42 @@ namespace mi
                         return true;
                 }
 
+                /**
+                 * @brief Erode run-length volume by a sphere without decoding.
+                 * @param [in] inData Input data.
+                 * @param [out] outData Output data. It may be inData.
+                 * @param [in] r Radius of sphere.
+                 */
+                static	bool erode( const RunLengthVolume& inData, RunLengthVolume& outData, const double r ) {
+                        return RunLengthVolume::erode( inData, outData, r, VolumeDataUtility::getNumThread() );
+                }
+
+                /**
+                 * @brief Dilate run-length volume by a sphere without decoding.
+                 * @param [in] inData Input data.
+                 * @param [out] outData Output data. It may be inData.
+                 * @param [in] r Radius of sphere.
+                 */
+                static	bool dilate( const RunLengthVolume& inData, RunLengthVolume& outData, const double r ) {
+                        return RunLengthVolume::dilate( inData, outData, r, VolumeDataUtility::getNumThread() );
+                }
+
+                static	bool diff( const RunLengthVolume& srcData, const RunLengthVolume& trgData, RunLengthVolume& outData ) {
+                        return RunLengthVolume::subtract( srcData, trgData, outData, VolumeDataUtility::getNumThread() );
+                }
+
+                static	bool unite( const RunLengthVolume& srcData, const RunLengthVolume& trgData, RunLengthVolume& outData ) {
+                        return RunLengthVolume::unite( srcData, trgData, outData, VolumeDataUtility::getNumThread() );
+                }
+
+                static	bool intersect( const RunLengthVolume& srcData, const RunLengthVolume& trgData, RunLengthVolume& outData ) {
+                        return RunLengthVolume::intersect( srcData, trgData, outData, VolumeDataUtility::getNumThread() );
+                }
+
+                static bool negate_binary ( const RunLengthVolume& inData, RunLengthVolume& outData ) {
+                        return RunLengthVolume::complement( inData, outData, VolumeDataUtility::getNumThread() );
+                }
+
 
                 /**
                  * @brief Compute offset volume data.
@@ -209,7 +384,7 @@ namespace mi
                         const int grain_size = 1000000;
                         VolumeInfo& info = inData.getInfo();
                         outData.init( info );
-                        parallel_for_each( info.begin(), info.end(), mi::dilate( inData, outData, radius ), grain_size );
+                        parallel_for_each( info.begin(), info.end(), mi::dilate<>( inData, outData, radius ), grain_size );
                         return true;
                 }
 
@@ -258,11 +433,15 @@ namespace mi
                  * @param [in] binaryImage Binary volume data.
                  * @param [out] labelImage The result.
                  * @poaram [in] neighbor using connectivity (6, 18, 26)
+                 * @param [in] algorithm Labelling algorithm ( ConnectedComponentLabeller::SCAN or QUEUE ). Labels are the same.
                  *
                  */
-                static bool label( VolumeData<char>& binaryImage, VolumeData<int>& labelImage, const int neighbor = 26, const bool isSorted = true, int* numLabels=NULL ) {
+                static bool label( VolumeData<char>& binaryImage, VolumeData<int>& labelImage, const int neighbor = 26, const bool isSorted = true, int* numLabels=NULL,
+                                   const ConnectedComponentLabeller::Algorithm algorithm = ConnectedComponentLabeller::SCAN ) {
+                        labelImage.setHalo( 1, 0 ); // the halo of background the labeller needs. memory is allocated once.
                         if ( !labelImage.init( binaryImage.getInfo(), true ).check() ) return false; //not allocated.
                         ConnectedComponentLabeller labeller( binaryImage );
+                        labeller.setAlgorithm( algorithm ).setNumThread( VolumeDataUtility::getNumThread() );
                         const int nLabel = labeller.label( labelImage, neighbor, isSorted ) ; // 0: background, 1 : largest component.
                         if ( numLabels != NULL ) *numLabels = nLabel;
                         return true;
@@ -270,6 +449,7 @@ namespace mi
                 template< typename T>
                 static bool label_rle( VolumeData<char>& binaryImage, VolumeData<T>& resultImage,  const int neighbor = 26, const bool isSorted = true, int* numLabels=NULL ) {
                         mi::ConnectedComponentLabellerRle labeller( binaryImage );
+                        labeller.setNumThread( VolumeDataUtility::getNumThread() );
                         *numLabels =  labeller.label( isSorted );
                         // size check
                         labeller.getData( resultImage );
@@ -278,6 +458,7 @@ namespace mi
 
                 static bool extract_nth_component(  VolumeData<char>& binaryImage, VolumeData<char>& resultImage, const int n = 1 ) {
                         mi::ConnectedComponentLabellerRle labeller( binaryImage );
+                        labeller.setNumThread( VolumeDataUtility::getNumThread() );
                         const int num = labeller.label( true );
                         if ( n > num ) return false;
                         labeller.getNthComponent( resultImage, n );
@@ -285,8 +466,24 @@ namespace mi
                 }
 
 
+                /**
+                 * @brief Extract the n-th largest component of run-length volume without decoding.
+                 * @param [in] inData Input data.
+                 * @param [out] outData Output data. It may be inData.
+                 * @param [in] n Rank.
+                 */
+                static bool extract_nth_component(  const RunLengthVolume& inData, RunLengthVolume& outData, const int n = 1 ) {
+                        mi::ConnectedComponentLabellerRle labeller( inData.getInfo().getSize() );
+                        labeller.setNumThread( VolumeDataUtility::getNumThread() );
+                        labeller.encode( inData );
+                        const int num = labeller.label( true );
+                        if ( n > num ) return false;
+                        return labeller.getNthComponent( outData, inData.getInfo(), n );
+                }
+
                 static bool extract_not_nth_components(  VolumeData<char>& binaryImage, VolumeData<char>& resultImage, const int n = 1 ) {
                         mi::ConnectedComponentLabellerRle labeller( binaryImage );
+                        labeller.setNumThread( VolumeDataUtility::getNumThread() );
                         const int num = labeller.label( true );
                         if ( n > num ) return false;
                         labeller.getNotNthComponents( resultImage, n );
@@ -356,7 +553,7 @@ namespace mi
                  */
                 template <typename T>
                 static bool upsample ( VolumeData<T>& inData, VolumeData<T>& outData, const int scale = 1 ) {
-                        if ( !VolumeDataUpSampler<T> ( inData, outData ).sample( scale ) ) {
+                        if ( !VolumeDataUpSampler<T> ( inData, outData ).setNumThread( VolumeDataUtility::getNumThread() ).sample( scale ) ) {
                                 return false;
                         }
 
@@ -384,18 +581,71 @@ namespace mi
                         return true;
                 }
 
-                /*
-                 * may be deleted.
+                /**
+                 * @brief Get the writer used by debug_save().
+                 * @return Writer.
+                 */
+                static VolumeDataAsyncWriter& getDebugWriter ( void ) {
+                        static VolumeDataAsyncWriter writer( 0 );
+                        return writer;
+                }
+
+                /**
+                 * @brief Set how debug_save() writes volumes.
+                 * @param [in] budget Memory budget for volumes waiting for writing in background ( byte ). 0 means synchronous writing.
+                 * @param [in] isBrick Set true to use the chunked compressed format.
+                 */
+                static void setDebugWriter ( const size_t budget, const bool isBrick = false ) {
+                        VolumeDataUtility::getDebugWriter().setMemoryBudget( budget ).setBrickFormat( isBrick ).setNumThread( VolumeDataUtility::getNumThread() );
+                        return;
+                }
+
+                /**
+                 * @brief Wait until all volumes passed to debug_save() are written.
+                 */
+                static void flush_debug ( void ) {
+                        if ( VolumeDataUtility::isDebugMode() ) VolumeDataUtility::getDebugWriter().flush();
+                        return;
+                }
+
+                /**
+                 * @brief Save intermediate data in debug mode.
+                 *
+                 * Writing is done in background when setDebugWriter() gives a memory budget.
+                 * @param [in] data Volume data.
+                 * @param [in] filename File name.
+                 * @retval true Success.
+                 * @retval false Failure.
                  */
                 template< typename T>
                 static bool debug_save ( VolumeData<T>& data, const std::string& filename ) {
                         if ( !VolumeDataUtility::isDebugMode() ) return true; // do nothing.
-                        if ( !VolumeDataUtility::save<T>( data, filename ) ) return false;
-                        std::cerr<<"[debug] the result was saved to "<<filename<<std::endl;
-                        return true;
+                        return VolumeDataUtility::getDebugWriter().push( data, filename );
                 }
 
         private:
+                /**
+                 * @brief Get the volume with a halo of the border value.
+                 * @param [in] data Volume data.
+                 * @param [in] margin Minimum width of the halo.
+                 * @param [in] border Border value.
+                 * @param [out] copy Padded copy of data. It is used only when data has no such halo.
+                 * @return data or copy.
+                 */
+                static VolumeData<char>& pad ( VolumeData<char>& data, const int margin, const char border, VolumeData<char>& copy ) {
+                        if ( data.getHalo() >= margin && data.getBorderValue() == border ) return data;
+                        VolumeInfo& info = data.getInfo();
+                        const Point3i& size = info.getSize();
+                        copy.setHalo( margin, border ).init( info );
+                        for ( int z = 0 ; z < size.z() ; ++z ) {
+                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                        const char* src = data.getPointer( y, z );
+                                        std::copy( src, src + size.x(), copy.getPointer( y, z ) );
+                                }
+                        }
+                        return copy;
+                }
+
                 static int getGrainSize( const mi::Point3i& size ) {
                         return static_cast<int>( size.x() * size.y() / VolumeDataUtility::getNumThread() * size.z() );
 
@@ -9,6 +9,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <iterator>
+#include <algorithm>
 
 #include "math.hpp"
 #include "Clamp.hpp"
@@ -383,6 +384,17 @@ namespace mi
                         return this->setSize( size ).setPitch( pitch ).setOrigin( origin );
                 }
 
+                /**
+                 * @brief Exchange the information with another instance.
+                 * @param [in,out] that Instance.
+                 */
+                void swap ( VolumeInfo& that ) {
+                        std::swap( this->_size,   that._size );
+                        std::swap( this->_pitch,  that._pitch );
+                        std::swap( this->_origin, that._origin );
+                        return;
+                }
+
 
                 bool isCorner ( const Point3i& p ) const {
                         if (  ! this->isValid( p ) ) return false;
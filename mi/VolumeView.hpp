@@ -0,0 +1,249 @@
+/**
+ * @file VolumeView.hpp
+ * @author Takashi Michikawa <michikawa@acm.org>
+ */
+#ifndef MI_VOLUME_VIEW_HPP
+#define MI_VOLUME_VIEW_HPP 1
+#include <vector>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include "VolumeInfo.hpp"
+#include "VolumeData.hpp"
+#include "ParallelFor.hpp"
+namespace mi
+{
+        /**
+         * @class VolumeView VolumeView.hpp <mi/VolumeView.hpp>
+         * @brief Sub-box of volume data without copying voxels.
+         *
+         * A view refers to voxels [bmin, bmax] of a parent volume. Coordinates of the view start from (0, 0, 0)
+         * at bmin, and the origin of its information is moved to bmin, so that positions in space are the same
+         * as those of the parent. Accessors are the same as VolumeData ( get(), set(), at(), getPointer(),
+         * getStrideY(), getStrideZ(), getInfo() and getSize() ), so function objects taking the volume type as a
+         * template parameter run on views. Views are cheap to copy; the parent must outlive them.
+         * VolumeDataClipper::clip() and VolumeDataUtility::clip() make views. Among the library functions, only
+         * VolumeDataUtility::binarize() and VolumeDataCache::hash() accept views; the others take VolumeData,
+         * and copyTo() makes the compact copy they need.
+         */
+        template <typename T>
+        class VolumeView
+        {
+        private:
+                VolumeData<T>* _parent; ///< Parent volume.
+                VolumeInfo _info; ///< Information of the view.
+                Point3i _offset; ///< Position of (0, 0, 0) in the parent.
+        public:
+                explicit VolumeView ( void ) : _parent( NULL ), _offset( 0, 0, 0 ) {
+                        return;
+                }
+
+                /**
+                 * @brief Constructor.
+                 * @param [in] parent Parent volume.
+                 * @param [in] bmin Bounding box ( min ).
+                 * @param [in] bmax Bounding box ( max ).
+                 */
+                explicit VolumeView ( VolumeData<T>& parent, const Point3i& bmin, const Point3i& bmax ) : _parent( NULL ), _offset( 0, 0, 0 ) {
+                        this->init( parent, bmin, bmax );
+                        return;
+                }
+
+                /**
+                 * @brief Constructor. The view covers the whole parent.
+                 * @param [in] parent Parent volume.
+                 */
+                explicit VolumeView ( VolumeData<T>& parent ) : _parent( NULL ), _offset( 0, 0, 0 ) {
+                        this->init( parent, Point3i( 0, 0, 0 ), parent.getInfo().getMax() );
+                        return;
+                }
+
+                VolumeView ( const VolumeView<T>& that ) : _parent( that._parent ), _info( that._info ), _offset( that._offset ) {
+                        return;
+                }
+
+                VolumeView<T>& operator = ( const VolumeView<T>& that ) {
+                        this->_parent = that._parent;
+                        this->_info.init( that._info.getSize(), that._info.getPitch(), that._info.getOrigin() );
+                        this->_offset = that._offset;
+                        return *this;
+                }
+
+                /**
+                 * @brief Set the sub-box.
+                 * @param [in] parent Parent volume.
+                 * @param [in] bmin Bounding box ( min ).
+                 * @param [in] bmax Bounding box ( max ).
+                 * @retval true Success.
+                 * @retval false The box is out of the parent.
+                 */
+                bool init ( VolumeData<T>& parent, const Point3i& bmin, const Point3i& bmax ) {
+                        const VolumeInfo& info = parent.getInfo();
+                        if ( !info.isValid( bmin ) || !info.isValid( bmax ) ||
+                             bmax.x() < bmin.x() || bmax.y() < bmin.y() || bmax.z() < bmin.z() ) {
+                                std::cerr<<"error. bounding box is out-of-range."<<std::endl;
+                                this->_parent = NULL;
+                                return false;
+                        }
+                        this->_parent = &parent;
+                        this->_offset = bmin;
+                        this->_info.init( bmax - bmin + Point3i( 1, 1, 1 ), info.getPitch(), info.getPointInSpace( bmin ) );
+                        return true;
+                }
+
+                inline bool isReadable ( void ) const {
+                        return this->_parent != NULL && this->_parent->isReadable();
+                }
+
+                inline VolumeInfo& getInfo ( void ) {
+                        return this->_info;
+                }
+
+                inline Point3i getSize ( void ) {
+                        return this->getInfo().getSize();
+                }
+
+                /**
+                 * @brief Get the position of (0, 0, 0) in the parent.
+                 * @return Offset.
+                 */
+                inline Point3i getOffset ( void ) const {
+                        return this->_offset;
+                }
+
+                inline VolumeData<T>& getParent ( void ) {
+                        return *( this->_parent );
+                }
+
+                inline ptrdiff_t getStrideY ( void ) const {
+                        return this->_parent->getStrideY();
+                }
+
+                inline ptrdiff_t getStrideZ ( void ) const {
+                        return this->_parent->getStrideZ();
+                }
+
+                inline T* getPointer ( const int y = 0, const int z = 0 ) {
+                        return this->_parent->getPointer( y + this->_offset.y(), z + this->_offset.z() ) + this->_offset.x();
+                }
+
+                inline const T* getPointer ( const int y = 0, const int z = 0 ) const {
+                        return const_cast<const VolumeData<T>*>( this->_parent )->getPointer( y + this->_offset.y(), z + this->_offset.z() ) + this->_offset.x();
+                }
+
+                inline T get ( const Point3i& p ) const {
+                        return this->get( p.x(), p.y(), p.z() );
+                }
+
+                inline T get ( const int x, const int y, const int z ) const {
+                        return this->_parent->get( x + this->_offset.x(), y + this->_offset.y(), z + this->_offset.z() );
+                }
+
+                /**
+                 * @brief Get the value at a neighbor.
+                 * @param [in] p Position.
+                 * @param [in] d Offset to the neighbor.
+                 * @return Value at p + d.
+                 */
+                inline T get ( const Point3i& p, const Point3i& d ) const {
+                        return this->get( p.x() + d.x(), p.y() + d.y(), p.z() + d.z() );
+                }
+
+                inline void set ( const Point3i& p, const T v ) {
+                        this->set( p.x(), p.y(), p.z(), v );
+                        return;
+                }
+
+                inline void set ( const int x, const int y, const int z, const T v ) {
+                        this->_parent->set( x + this->_offset.x(), y + this->_offset.y(), z + this->_offset.z(), v );
+                        return;
+                }
+
+                inline T at ( const Point3i& p ) const {
+                        return this->get( p );
+                }
+
+                inline T& at ( const Point3i& p ) {
+                        return this->at( p.x(), p.y(), p.z() );
+                }
+
+                inline T& at ( const int x, const int y, const int z ) {
+                        return this->_parent->at( x + this->_offset.x(), y + this->_offset.y(), z + this->_offset.z() );
+                }
+
+                /**
+                 * @brief Copy voxels of the view to compact volume data.
+                 * @param [out] dst Destination. It is initialized with the information of the view and keeps its halo setting.
+                 * @param [in] nthread The number of threads.
+                 * @retval true Success.
+                 * @retval false The view is not readable.
+                 */
+                bool copyTo ( VolumeData<T>& dst, const int nthread = 1 ) const {
+                        if ( !this->isReadable() ) return false;
+                        dst.init( this->_info );
+                        copy_fn<false> fn( const_cast<VolumeView<T>&>( *this ), dst );
+                        VolumeView<T>::run( fn, this->_info.getSize().z(), nthread );
+                        return true;
+                }
+
+                /**
+                 * @brief Copy voxels of compact volume data into the view.
+                 * @param [in] src Source. Its size must be the same as the view.
+                 * @param [in] nthread The number of threads.
+                 * @retval true Success.
+                 * @retval false Sizes are different.
+                 */
+                bool copyFrom ( VolumeData<T>& src, const int nthread = 1 ) {
+                        if ( !this->isReadable() || !src.isReadable() || src.getSize() != this->getSize() ) return false;
+                        copy_fn<true> fn( *this, src );
+                        VolumeView<T>::run( fn, this->_info.getSize().z(), nthread );
+                        return true;
+                }
+        private:
+                template <class Function>
+                static void run ( Function& fn, const int sz, const int nthread ) {
+                        const int n = std::max( 1, std::min( nthread, sz ) );
+                        std::vector<int> chunks( n );
+                        for ( int i = 0 ; i < n ; ++i ) chunks[i] = i;
+                        fn.setNumChunks( n );
+                        if ( n == 1 ) fn( 0 );
+                        else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                        return;
+                }
+
+                /**
+                 * @brief Copy rows between a view and compact data. Each chunk handles a range of slices.
+                 */
+                template <bool toView>
+                class copy_fn
+                {
+                private:
+                        VolumeView<T>& _view;
+                        VolumeData<T>& _data;
+                        int _numChunks;
+                public:
+                        copy_fn ( VolumeView<T>& view, VolumeData<T>& data ) : _view( view ), _data( data ), _numChunks( 1 ) {
+                                return;
+                        }
+
+                        void setNumChunks ( const int n ) {
+                                this->_numChunks = n;
+                                return;
+                        }
+
+                        void operator () ( const int chunk ) const {
+                                const Point3i size = this->_view.getInfo().getSize();
+                                const int zbegin = static_cast<int>( static_cast<long long>( size.z() ) * chunk / this->_numChunks );
+                                const int zend   = static_cast<int>( static_cast<long long>( size.z() ) * ( chunk + 1 ) / this->_numChunks );
+                                for ( int z = zbegin ; z < zend ; ++z ) {
+                                        for ( int y = 0 ; y < size.y() ; ++y ) {
+                                                if ( toView ) std::memcpy( this->_view.getPointer( y, z ), this->_data.getPointer( y, z ), sizeof( T ) * size.x() );
+                                                else std::memcpy( this->_data.getPointer( y, z ), this->_view.getPointer( y, z ), sizeof( T ) * size.x() );
+                                        }
+                                }
+                                return;
+                        }
+                };
+        };
+}
+#endif// MI_VOLUME_VIEW_HPP
@@ -1,8 +1,13 @@
 #ifndef MI_WATERSHED_PROCESSOR_HPP
 #define MI_WATERSHED_PROCESSOR_HPP 1
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <vector>
 #include "VolumeData.hpp"
+#include "Neighbor.hpp"
 #include "SystemInfo.hpp"
-#include "PriorityQueue.hpp"
 #include "Thread.hpp"
 namespace mi
 {
@@ -10,29 +15,122 @@ namespace mi
         class WatershedProcessor
         {
         private:
+                typedef std::pair<float, ptrdiff_t> queue_type; ///< ( -weight, index ).
+                /**
+                 * @brief Voxels of larger weights first. Ties are taken in the order of indices ( z, y, x ), so labels
+                 * do not depend on the order of pushes, e.g. on which labelled voxels are queued first.
+                 */
+                typedef std::priority_queue<queue_type, std::vector<queue_type>, std::greater<queue_type> > queue;
+
                 const VolumeData<float>& _weightData;
         public:
                 WatershedProcessor ( const VolumeData<float>& weightData ) :  _weightData( weightData ) {
                         return;
                 }
 		
-                bool process ( VolumeData<T>& labelData ) {
+                /**
+                 * @brief Propagate labels to unlabelled voxels with positive weights.
+                 *
+                 * When the weight data has a halo of 0 ( VolumeData::setHalo() ), voxels are visited through linear
+                 * offsets without bounds checks. The label data should have the same halo of 0; otherwise labels are
+                 * processed in a padded copy and written back, and the layout of the label data is kept.
+                 * When frontierOnly is true, only labelled voxels next to unlabelled ones are queued first. The
+                 * result is the same, and the queue stays small when most voxels are labelled beforehand.
+                 * @param [in,out] labelData Label data. 0 means unlabelled.
+                 * @param [in] frontierOnly Queue only labelled voxels on the front.
+                 * @retval true Success.
+                 */
+                bool process ( VolumeData<T>& labelData, const bool frontierOnly = false ) {
+                        const int halo = this->_weightData.getHalo();
+                        if ( halo < 1 || this->_weightData.getBorderValue() > 0 ) return this->process_checked( labelData, frontierOnly );
+                        if ( labelData.getHalo() == halo && labelData.getBorderValue() == 0 ) return this->process_padded( labelData, frontierOnly );
+
+                        VolumeInfo& info = labelData.getInfo();
+                        VolumeData<T> work;
+                        work.setHalo( halo, 0 ).init( info );
+                        WatershedProcessor<T>::copy_rows( labelData, work );
+                        if ( ! this->process_padded( work, frontierOnly ) ) return false;
+                        WatershedProcessor<T>::copy_rows( work, labelData );
+                        return true;
+                }
+        private:
+                static void copy_rows ( VolumeData<T>& src, VolumeData<T>& dst ) {
+                        const Point3i size = src.getInfo().getSize();
+                        for ( int z = 0 ; z < size.z() ; ++z ) {
+                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                        const T* row = src.getPointer( y, z );
+                                        std::copy( row, row + size.x(), dst.getPointer( y, z ) );
+                                }
+                        }
+                        return;
+                }
+
+                /**
+                 * @brief Propagate labels through linear offsets. The label data has the same halo as the weight data.
+                 */
+                bool process_padded ( VolumeData<T>& labelData, const bool frontierOnly ) {
+                        const VolumeInfo& info = const_cast<VolumeData<T>&>( labelData ).getInfo();
+                        const Point3i& size = info.getSize();
+                        T* label = labelData.getPointer( 0, 0 );
+                        const float* weight = this->_weightData.getPointer( 0, 0 );
+                        const NeighborOffset<6> nbr( labelData.getStrideY(), labelData.getStrideZ() );
+
+                        queue pq;
+                        for ( int z = 0 ; z < size.z() ; ++z ) {
+                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                        const ptrdiff_t row = labelData.getPointer( y, z ) - label;
+                                        for ( int x = 0 ; x < size.x() ; ++x ) {
+                                                const ptrdiff_t i = row + x;
+                                                if ( label[i] <= 0 || weight[i] <= 0 ) continue;
+                                                if ( frontierOnly ) {
+                                                        int k = 0;
+                                                        while ( k < NeighborOffset<6>::size && ( label[ i + nbr[k] ] != 0 || weight[ i + nbr[k] ] <= 0 ) ) ++k;
+                                                        if ( k == NeighborOffset<6>::size ) continue;
+                                                }
+                                                pq.push( queue_type( -weight[i], i ) );
+                                        }
+                                }
+                        }
+
+                        while( !pq.empty() ) {
+                                const ptrdiff_t i = pq.top().second;
+                                pq.pop();
+                                const T labelId = label[i]; // Label ID to be propagated.
+                                for ( int k = 0 ; k < NeighborOffset<6>::size ; ++k ) {
+                                        const ptrdiff_t ni = i + nbr[k];
+                                        if ( label[ni] != 0 ) continue;
+                                        if ( weight[ni] > 0 ) { // the halo has no weight.
+                                                label[ni] = labelId;
+                                                pq.push( queue_type( -weight[ni], ni ) );
+                                        }
+                                }
+                        }
+                        return true;
+                }
+
+                bool process_checked ( VolumeData<T>& labelData, const bool frontierOnly ) {
                         const VolumeInfo& info = const_cast<VolumeData<T>&>( labelData ).getInfo();
                         Range range( info.getMin(), info.getMax() );
 			
+                        const Point3i& size = info.getSize();
+                        const ptrdiff_t sx = size.x();
+                        const ptrdiff_t sxy = sx * size.y();
+			
                         if ( 1 ) { //@ the program will be failed when "if" is removed.
-                                PriorityQueue <Point3i> pq;
+                                queue pq;
 				
                                 for( Range::iterator iter = range.begin() ; iter != range.end() ; ++iter ) {
                                         const Point3i& p = *iter;
                                         if ( labelData.get( p ) > 0 && this->_weightData.get( p ) > 0 ) {
-                                                pq.push( p, -this->_weightData.get( p ) ) ;
+                                                if ( frontierOnly && ! this->is_front( labelData, p ) ) continue;
+                                                pq.push( queue_type( -this->_weightData.get( p ), p.x() + sx * p.y() + sxy * p.z() ) ) ;
                                         }
                                 }
 
                                 while( !pq.empty() ) {
-                                        const Point3i p = pq.getTopIndex();
+                                        const ptrdiff_t i = pq.top().second;
                                         pq.pop();
+                                        const Point3i p( static_cast<int>( i % sx ), static_cast<int>( ( i % sxy ) / sx ), static_cast<int>( i / sxy ) );
                                         const int labelId = labelData.get( p ); // Label ID to be propagated.
                                         for( Neighbor::iterator diter = Neighbor::begin() ; diter != Neighbor::end( 6 ) ; ++diter ) {
                                                 const Point3i np = *diter + p;
@@ -40,13 +138,22 @@ namespace mi
                                                 if ( labelData.get( np ) != 0 ) continue;
                                                 if( this->_weightData.get( np ) > 0 ) {
                                                         labelData.set( np, labelId );
-                                                        pq.push( np, -this->_weightData.get( np ) );
+                                                        pq.push( queue_type( -this->_weightData.get( np ), np.x() + sx * np.y() + sxy * np.z() ) );
                                                 }
                                         }
                                 }
                         }
                         return true;
                 }
+
+                bool is_front ( VolumeData<T>& labelData, const Point3i& p ) const {
+                        const VolumeInfo& info = labelData.getInfo();
+                        for( Neighbor::iterator diter = Neighbor::begin() ; diter != Neighbor::end( 6 ) ; ++diter ) {
+                                const Point3i np = *diter + p;
+                                if ( info.isValid( np ) && labelData.get( np ) == 0 && this->_weightData.get( np ) > 0 ) return true;
+                        }
+                        return false;
+                }
         };
 }
 #endif// MI_WATERSHED_PROCESSOR_HPP
@@ -10,16 +10,16 @@
 
 namespace mi
 {
-        template<typename T>
+        template<typename T, class Volume = mi::VolumeData<T> >
         class binarize_voxel: public std::unary_function<mi::Point3i, void>
         {
         private:
-                const mi::VolumeData<T>& _dataFrom;
+                const Volume& _dataFrom;
                 mi::VolumeData<char>& _dataTo;
                 const T _isoval;
                 bool _negate;
         public:
-                binarize_voxel ( const mi::VolumeData<T>& dataFrom, mi::VolumeData<char>& dataTo, const T& isoval , const bool negate )
+                binarize_voxel ( const Volume& dataFrom, mi::VolumeData<char>& dataTo, const T& isoval , const bool negate )
                         : _dataFrom( dataFrom ), _dataTo( dataTo ) ,  _isoval( isoval ) , _negate( negate ) {
                         return;
                 }
@@ -5,19 +5,27 @@
 #ifndef __MI_FUNCTIONAL_DILATE_HPP__
 #define __MI_FUNCTIONAL_DILATE_HPP__ 1
 #include <functional>
+#include <vector>
+#include <cstddef>
 #include <mi/VolumeData.hpp>
 #include <mi/math.hpp>
 namespace mi
 {
+        /**
+         * @brief Morphological dilation by a sphere.
+         *
+         * Volume is VolumeData<char> or another volume type having the same accessors ( e.g. BrickedVolumeData<char> ).
+         */
+        template <class Volume = VolumeData<char> >
         class dilate
         {
         private:
-                VolumeData<char>& _inData;
+                Volume& _inData;
                 VolumeData<char>& _outData;
                 const double _radius;
                 Point3d _pitch; // (x*x, y*y, z*z)
         public:
-                dilate ( VolumeData<char>& inData, VolumeData<char>& outData, const double r ) :
+                dilate ( Volume& inData, VolumeData<char>& outData, const double r ) :
                         _inData( inData ), _outData( outData ), _radius( r ), _pitch( inData.getInfo().getPitch() ) {
 
                         const int rx = static_cast<int>( std::ceil ( this->_radius * 1.0 / _pitch.x() ) );
@@ -43,15 +51,60 @@ namespace mi
                                         double vy = dy * _pitch.y();
                                         for( int dx = -rx ; dx <= rx ; ++dx ) {
                                                 double vx = dx * _pitch.x();
-                                                const Point3i np = p + Point3i( dx,dy,dz );
+                                                const Point3i d( dx,dy,dz );
+                                                const Point3i np = p + d;
                                                 if ( !this->_inData.getInfo().isValid( np ) ) continue;
                                                 if ( _radius * _radius < vx * vx + vy * vy + vz * vz ) continue;
-                                                if ( this->_inData.get( np ) == 1 ) return 1;
+                                                if ( this->_inData.get( p, d ) == 1 ) return 1;
                                         }
                                 }
                         }
                         return 0;
                 }
         };
+
+        /**
+         * @brief Morphological dilation by a sphere on volume data with a halo.
+         *
+         * The halo of the input must be at least erode_padded::getMargin() voxels wide and hold 0, so that
+         * voxels of the sphere are read through linear offsets without bounds checks. The result is the same as dilate.
+         */
+        class dilate_padded
+        {
+        private:
+                const VolumeData<char>& _inData;
+                VolumeData<char>& _outData;
+                std::vector<ptrdiff_t> _offsets; ///< Linear offsets to voxels in the sphere except the center.
+        public:
+                dilate_padded ( const VolumeData<char>& inData, VolumeData<char>& outData, const double r ) : _inData( inData ), _outData( outData ) {
+                        const Point3d pitch = const_cast<VolumeData<char>&>( inData ).getInfo().getPitch();
+                        const int rx = static_cast<int>( std::ceil ( r * 1.0 / pitch.x() ) );
+                        const int ry = static_cast<int>( std::ceil ( r * 1.0 / pitch.y() ) );
+                        const int rz = static_cast<int>( std::ceil ( r * 1.0 / pitch.z() ) );
+                        for( int dz = -rz ; dz <= rz ; ++dz ) {
+                                double vz = dz * pitch.z();
+                                for( int dy = -ry ; dy <= ry ; ++dy ) {
+                                        double vy = dy * pitch.y();
+                                        for( int dx = -rx ; dx <= rx ; ++dx ) {
+                                                double vx = dx * pitch.x();
+                                                if ( r * r < vx * vx + vy * vy + vz * vz ) continue;
+                                                if ( dx == 0 && dy == 0 && dz == 0 ) continue;
+                                                this->_offsets.push_back( dx + dy * inData.getStrideY() + dz * inData.getStrideZ() );
+                                        }
+                                }
+                        }
+                        return;
+                }
+
+                void operator () ( const Point3i& p ) {
+                        const char* q = this->_inData.getPointer( p.y(), p.z() ) + p.x();
+                        char v = ( *q == 1 ) ? 1 : 0;
+                        for ( size_t i = 0 ; v != 1 && i < this->_offsets.size() ; ++i ) {
+                                if ( q[ this->_offsets[i] ] == 1 ) v = 1;
+                        }
+                        this->_outData.set( p, v ) ;
+                        return;
+                }
+        };
 };
 #endif //__MI_FUNCTIONAL_DILATE_HPP__
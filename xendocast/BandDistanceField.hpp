@@ -0,0 +1,214 @@
+#ifndef BAND_DISTANCE_FIELD_HPP
+#define BAND_DISTANCE_FIELD_HPP 1
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <mi/VolumeData.hpp>
+#include <mi/VolumeDataPyramid.hpp>
+#include <mi/VolumeDataUtility.hpp>
+#include <mi/ParallelFor.hpp>
+/**
+ * @class BandDistanceField
+ * @brief Distance field of binary data that is exact below a limit, computed coarse to fine.
+ *
+ * The binary data ( 0 : background ) is reduced by MIN ( VolumeDataPyramid ), so a block is background in the
+ * coarse data when any of its voxels is. For a voxel p in block c the coarse distance D( c ) then bounds the distance
+ * from below : d( p ) >= D( c ) - | ( factor - 1 ) * pitch |. Voxels whose bound is the limit or more take D( c ).
+ * The other voxels form the band and take the distance found by the separable search of DistanceFieldComputer within
+ * the limit, which is the full-resolution distance when it is below the limit, and the limit or more otherwise.
+ * Thresholds up to the limit and watershed ( -hole ) therefore see the same seeds and weights below the seeds
+ * as with the full-resolution distance field.
+ */
+class BandDistanceField
+{
+private:
+        BandDistanceField ( const BandDistanceField& that );
+        void operator = ( const BandDistanceField& that );
+private:
+        mi::VolumeData<char>& _binaryData; ///< Full-resolution binary data ( 0 : background ).
+        const int _level; ///< Level of the coarse volume ( reduced by 2^level ).
+        int _nthread; ///< The number of threads.
+        size_t _numBandVoxels;
+public:
+        /**
+         * @brief Constructor.
+         * @param [in] binaryData Full-resolution binary data.
+         * @param [in] level Level of the coarse volume ( reduced by 2^level ).
+         */
+        BandDistanceField ( mi::VolumeData<char>& binaryData, const int level ) : _binaryData( binaryData ), _level( level ), _nthread( 1 ), _numBandVoxels( 0 )
+        {
+                return;
+        }
+
+        BandDistanceField& setNumThread ( const int nthread )
+        {
+                this->_nthread = nthread < 1 ? 1 : nthread;
+                return *this;
+        }
+
+        /**
+         * @brief Get the number of voxels searched at full resolution in the last compute().
+         */
+        size_t getNumBandVoxels ( void ) const
+        {
+                return this->_numBandVoxels;
+        }
+
+        /**
+         * @brief Compute the distance field.
+         * @param [in] limit Distances below the limit are exact.
+         * @param [out] distData Distance field. Its halo setting is kept.
+         * @retval true Success.
+         */
+        bool compute ( const double limit, mi::VolumeData<float>& distData )
+        {
+                mi::VolumeDataPyramid<char> pyramid( this->_binaryData, mi::VolumeDataDownSampler<char>::MIN );
+                pyramid.setNumThread( this->_nthread );
+                mi::VolumeData<float> coarseDist;
+                if ( ! mi::VolumeDataUtility::compute_distance_field( pyramid.getLevel( this->_level ), coarseDist ) ) return false;
+
+                mi::VolumeInfo& info = this->_binaryData.getInfo();
+                distData.init( info );
+                const int n = std::max( 1, std::min( this->_nthread, info.getSize().z() ) );
+                std::vector<size_t> count( n, 0 );
+                std::vector<int> chunks( n );
+                for ( int i = 0 ; i < n ; ++i ) chunks[i] = i;
+                distance_fn fn( this->_binaryData, coarseDist, distData, mi::VolumeDataPyramid<char>::getFactor( this->_level ), limit, count );
+                if ( n == 1 ) fn( 0 );
+                else mi::parallel_for_each( chunks.begin(), chunks.end(), fn, 1 );
+                this->_numBandVoxels = 0;
+                for ( int i = 0 ; i < n ; ++i ) this->_numBandVoxels += count[i];
+                return true;
+        }
+private:
+        /**
+         * @brief Set distances in a range of slices.
+         */
+        class distance_fn
+        {
+        private:
+                mi::VolumeData<char>& _binary;
+                mi::VolumeData<float>& _coarseDist;
+                mi::VolumeData<float>& _dist;
+                const int _factor;
+                const float _limit;
+                float _bound; ///< Maximum of D( c ) - d( p ).
+                mi::Point3i _window; ///< Search range ( voxels ).
+                mi::Point3d _pitch;
+                std::vector<size_t>& _count;
+        public:
+                distance_fn ( mi::VolumeData<char>& binary, mi::VolumeData<float>& coarseDist, mi::VolumeData<float>& dist, const int factor, const double limit, std::vector<size_t>& count ) :
+                        _binary( binary ), _coarseDist( coarseDist ), _dist( dist ), _factor( factor ), _limit( static_cast<float>( limit ) ), _count( count )
+                {
+                        this->_pitch = binary.getInfo().getPitch();
+                        const mi::Point3d& p = this->_pitch;
+                        this->_bound = static_cast<float>( ( factor - 1 ) * std::sqrt( p.x() * p.x() + p.y() * p.y() + p.z() * p.z() ) );
+                        this->_window = mi::Point3i( static_cast<int>( std::ceil( limit / p.x() ) ),
+                                                     static_cast<int>( std::ceil( limit / p.y() ) ),
+                                                     static_cast<int>( std::ceil( limit / p.z() ) ) );
+                        return;
+                }
+
+                void operator () ( const int chunk ) const
+                {
+                        const short NONE = std::numeric_limits<short>::max();
+                        const mi::Point3i size = this->_binary.getSize();
+                        const mi::Point3i& w = this->_window;
+                        const int n = static_cast<int>( this->_count.size() );
+                        const int f = this->_factor;
+                        const int zbegin = static_cast<int>( static_cast<long long>( size.z() ) * chunk / n );
+                        const int zend   = static_cast<int>( static_cast<long long>( size.z() ) * ( chunk + 1 ) / n );
+                        std::vector<short> cloz( static_cast<size_t>( size.x() ) * size.y(), NONE ); // offsets to the closest background voxels in z.
+                        std::vector<short> cloy( size.x(), NONE ); // offsets to the closest columns in y.
+                        size_t count = 0;
+                        for ( int z = zbegin ; z < zend ; ++z ) {
+                                // voxels of the band are marked by -1.
+                                bool hasBand = false;
+                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                        const char* bin = this->_binary.getPointer( y, z );
+                                        float* dist = this->_dist.getPointer( y, z );
+                                        for ( int x = 0 ; x < size.x() ; ++x ) {
+                                                if ( bin[x] == 0 ) {
+                                                        dist[x] = 0;
+                                                        continue;
+                                                }
+                                                const float d = this->_coarseDist.get( x / f, y / f, z / f );
+                                                if ( d - this->_bound >= this->_limit ) {
+                                                        dist[x] = d;
+                                                } else {
+                                                        dist[x] = -1;
+                                                        hasBand = true;
+                                                }
+                                        }
+                                }
+                                if ( ! hasBand ) continue;
+
+                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                        for ( int x = 0 ; x < size.x() ; ++x ) {
+                                                short& c = cloz[ static_cast<size_t>( y ) * size.x() + x ];
+                                                c = NONE;
+                                                float mind = std::numeric_limits<float>::max();
+                                                for ( int dz = std::max( 0, z - w.z() ) ; dz <= std::min( size.z() - 1, z + w.z() ) ; ++dz ) {
+                                                        if ( this->_binary.get( x, y, dz ) != 0 ) continue;
+                                                        const float d = this->get_dist2( 0, 0, dz - z );
+                                                        if ( d < mind ) {
+                                                                mind = d;
+                                                                c = static_cast<short>( dz - z );
+                                                        }
+                                                }
+                                        }
+                                }
+
+                                for ( int y = 0 ; y < size.y() ; ++y ) {
+                                        float* dist = this->_dist.getPointer( y, z );
+                                        if ( std::find( dist, dist + size.x(), -1.0f ) == dist + size.x() ) continue;
+                                        for ( int x = 0 ; x < size.x() ; ++x ) {
+                                                cloy[x] = NONE;
+                                                float mind = std::numeric_limits<float>::max();
+                                                for ( int dy = std::max( 0, y - w.y() ) ; dy <= std::min( size.y() - 1, y + w.y() ) ; ++dy ) {
+                                                        const short c = cloz[ static_cast<size_t>( dy ) * size.x() + x ];
+                                                        if ( c == NONE ) continue;
+                                                        const float d = this->get_dist2( 0, dy - y, c );
+                                                        if ( d < mind ) {
+                                                                mind = d;
+                                                                cloy[x] = static_cast<short>( dy - y );
+                                                        }
+                                                }
+                                        }
+                                        for ( int x = 0 ; x < size.x() ; ++x ) {
+                                                if ( dist[x] != -1 ) continue;
+                                                ++count;
+                                                float mind = std::numeric_limits<float>::max();
+                                                int vx = 0, vy = 0, vz = 0;
+                                                for ( int dx = std::max( 0, x - w.x() ) ; dx <= std::min( size.x() - 1, x + w.x() ) ; ++dx ) {
+                                                        if ( cloy[dx] == NONE ) continue;
+                                                        const short c = cloz[ static_cast<size_t>( y + cloy[dx] ) * size.x() + dx ];
+                                                        const float d = this->get_dist2( dx - x, cloy[dx], c );
+                                                        if ( d < mind ) {
+                                                                mind = d;
+                                                                vx = dx - x;
+                                                                vy = cloy[dx];
+                                                                vz = c;
+                                                        }
+                                                }
+                                                // the same expression as vec2dist, so that distances below the limit are equal.
+                                                const mi::Point3d& p = this->_pitch;
+                                                const float d = ( mind == std::numeric_limits<float>::max() ) ? 0 :
+                                                        std::sqrt( static_cast<float>( vx * vx * p.x() * p.x() + vy * vy * p.y() * p.y() + vz * vz * p.z() * p.z() ) );
+                                                dist[x] = ( d < this->_limit && d > 0 ) ? d : std::max( this->_limit, this->_coarseDist.get( x / f, y / f, z / f ) );
+                                        }
+                                }
+                        }
+                        this->_count[chunk] = count;
+                        return;
+                }
+        private:
+                inline float get_dist2 ( const int x, const int y, const int z ) const
+                {
+                        const mi::Point3d& p = this->_pitch;
+                        return static_cast<float>( x * x * p.x() * p.x() + y * y * p.y() * p.y() + z * z * p.z() * p.z() );
+                }
+        };
+};
+#endif// BAND_DISTANCE_FIELD_HPP
@@ -2,15 +2,22 @@
 #include <mi/MeshUtility.hpp>
 #include <mi/VolumeDataUtility.hpp>
 #include <mi/VolumeDataPolygonizer.hpp>
+#include <mi/SparseVolumeData.hpp>
 #include <mi/Neighbor.hpp>
 #include <mi/FileNameConverter.hpp>
 #include <mi/SystemInfo.hpp>
 #include <mi/WatershedProcessor.hpp>
-#include "Binarizer.hpp"
 #include <mi/VolumeDataCreator.hpp>
+#include <mi/VolumeDataStreamReader.hpp>
+#include <mi/VolumeDataCropper.hpp>
+#include "BandDistanceField.hpp"
+#include <mi/Tokenizer.hpp>
+#include <mi/Parse.hpp>
+#include <mi/ParallelFor.hpp>
+#include <mi/VolumeDataCache.hpp>
 
 template<typename T>
-ExtractEndocastCommand<T>::ExtractEndocastCommand ( void ) : mi::CommandTemplate( "xendocast" )
+ExtractEndocastCommand<T>::ExtractEndocastCommand ( void ) : mi::CommandTemplate( "xendocast" ), _ct_key( 0 )
 {
         mi::AttributeSet& attrSet = this->getAttributeSet();
         attrSet.createStringAttribute( "-i", this->_ct_file, "ct image" ).setMandatory();
@@ -22,13 +29,26 @@ ExtractEndocastCommand<T>::ExtractEndocastCommand ( void ) : mi::CommandTemplate
 
         attrSet.createTripleNumericAttribute<int>( "-size", size.x(), size.y(), size.z(), "size of volume" ).setMin( 1, 1, 1 ).setMandatory();
         attrSet.createNumericAttribute<int> ( "-h", this->_header_size, "header size" ).setDefaultValue( 0 ).setMin( 0 );
+        attrSet.createStringAttribute( "-src", this->_src_type, "value type in the file (char, uchar, short, ushort, int, uint, float or double)" ).setDefaultValue( "" );
+        attrSet.createBooleanAttribute( "-be", this->_isBigEndian, "the file is big-endian" );
+        attrSet.createNumericAttribute<double>( "-offset", this->_value_offset, "offset added to values in the file" ).setDefaultValue( 0 );
+        attrSet.createNumericAttribute<int> ( "-slab", this->_slab, "read the file by slabs of this number of slices in background (0: off)" ).setDefaultValue( 0 ).setMin( 0 );
         attrSet.createTripleNumericAttribute<double>( "-pitch", pitch.x(), pitch.y(), pitch.z(), "pitch size" ).setMin ( 0.0001, 0.0001, 0.0001 ).setDefaultValue( 1,1,1 );
         attrSet.createTripleNumericAttribute<double>( "-origin", origin.x(), origin.y(), origin.z(), "origin point" ).setDefaultValue( 0, 0, 0 );
+        attrSet.createNumericAttribute<int> ( "-debug_mem", this->_debug_memory, "memory for writing debug data in background (MB, 0: synchronous)" ).setDefaultValue( 1024 ).setMin( 0 );
+        attrSet.createBooleanAttribute( "-debug_brick", this->_debug_brick, "write debug data in the chunked compressed format" );
         attrSet.createNumericAttribute<int> ( "-thread", this->_num_threads, "The number of threads" ).setDefaultValue( mi::SystemInfo::getNumCores() ).setMin( 1 );
         attrSet.createNumericAttribute<T>( "-iso", this->_isovalue, "isovalue" ).setMandatory();
         attrSet.createBooleanAttribute( "-fill", this->_fillHole, "fill hole by polygons" );
         attrSet.createBooleanAttribute( "-auto", this->_auto, "automatic estimation of -hole parameter" );
         attrSet.createNumericAttribute<double>( "-hole", this->_hole, "size of hole" ).setMin( 0.0001 ).setDefaultValue( 30 );
+        attrSet.createBooleanAttribute( "-crop", this->_crop, "process only the bounding box of voxels above the isovalue" );
+        attrSet.createNumericAttribute<double>( "-margin", this->_margin, "margin of -crop (same unit as -hole, keep it well above -hole)" ).setMin( 0 ).setDefaultValue( 60 );
+        attrSet.createNumericAttribute<int> ( "-multires", this->_multires, "coarse-to-fine distance field: data reduced by 2^n bound distances, exact ones are searched only within -hole of walls (0: off)" ).setDefaultValue( 0 ).setMin( 0 ).setMax( 4 );
+        attrSet.createStringAttribute( "-sweep_iso", this->_sweep_iso, "sweep mode: isovalues separated by commas (one binarization and distance field each)" ).setDefaultValue( "" );
+        attrSet.createStringAttribute( "-sweep_hole", this->_sweep_hole, "sweep mode: -hole values separated by commas (share the distance field)" ).setDefaultValue( "" );
+        attrSet.createNumericAttribute<int> ( "-sweep_mem", this->_sweep_memory, "sweep mode: memory for -hole values processed in parallel (MB)" ).setDefaultValue( 2048 ).setMin( 0 );
+        attrSet.createStringAttribute( "-cache", this->_cache_dir, "directory for reusing binary, distance and label data of previous runs (empty: off)" ).setDefaultValue( "" );
         return ;
 }
 
@@ -52,8 +72,59 @@ ExtractEndocastCommand<T>::init ( const mi::Argument& arg )
 
 	// initialization of the volume.
         mi::VolumeDataUtility::setNumThread( this->_num_threads );
+        mi::MeshUtility::setNumThread( this->_num_threads );
+        if ( this->isDebugModeOn() ) {
+                mi::VolumeDataUtility::setDebugWriter( static_cast<size_t>( this->_debug_memory ) * 1024 * 1024, this->_debug_brick );
+        }
         this->_ctData.init( mi::VolumeInfo( this->_size, this->_pitch, this->_origin ) );
-        if ( ! mi::VolumeDataUtility::open( this->_ctData, this->_ct_file, this->_header_size ) ) return false;
+        mi::RawValueType type;
+        if ( ! mi::getRawValueType( this->_src_type, type ) ) return false;
+        if ( this->_auto && this->_multires > 0 ) { // -auto needs distances above -hole.
+                std::cerr<<"warning : -multires is ignored with -auto."<<std::endl;
+                this->_multires = 0;
+        }
+        if ( this->_slab > 0 ) { // the file is read in run().
+                if ( this->_crop ) std::cerr<<"warning : -crop is ignored with -slab."<<std::endl;
+                if ( ! this->_cache_dir.empty() ) std::cerr<<"warning : -cache is ignored with -slab."<<std::endl;
+                return true;
+        }
+        if ( ! mi::VolumeDataUtility::open( this->_ctData, this->_ct_file, this->_header_size, type, this->_isBigEndian, this->_value_offset ) ) return false;
+        if ( this->_crop && ! this->crop() ) return false;
+        if ( ! this->_cache_dir.empty() ) { // keys start from the voxels actually processed ( after -crop ).
+                this->_cache.setDirectory( this->_cache_dir ).setNumThread( this->_num_threads );
+                this->_ct_key = this->_cache.hash( this->_ctData );
+                mi::Logger::getStream()<<"cache key : "<<std::hex<<this->_ct_key<<std::dec<<std::endl;
+        }
+        return true;
+}
+
+template<typename T>
+bool
+ExtractEndocastCommand<T>::crop ( void )
+{
+        // the origin of the cropped data is moved, so the mesh is in the coordinates of the original data.
+        // the margin must leave room for the seed of the surrounding air ( label 1 ) in watershed().
+        // in sweep mode, the box of the smallest isovalue contains those of the others.
+        const mi::Point3d pitch = this->_ctData.getInfo().getPitch();
+        const double minPitch = std::min( pitch.x(), std::min( pitch.y(), pitch.z() ) );
+        const int margin = static_cast<int>( std::ceil( this->_margin / minPitch ) );
+        T isovalue = this->_isovalue;
+        if ( this->isSweepMode() ) {
+                const std::vector<T> isovalues = this->getSweepIsovalues();
+                isovalue = std::min( isovalue, *std::min_element( isovalues.begin(), isovalues.end() ) );
+        }
+        mi::VolumeDataCropper<T> cropper( this->_ctData );
+        cropper.setNumThread( this->_num_threads );
+        if ( ! cropper.compute( isovalue, margin ) ) {
+                std::cerr<<"warning : no voxel is above the isovalue. -crop is ignored."<<std::endl;
+                return true;
+        }
+        mi::VolumeData<T> cropData;
+        if ( ! cropper.crop( cropData ) ) return false;
+        this->_ctData.swap( cropData );
+        const mi::Point3i bmin = cropper.getMin();
+        const mi::Point3i bmax = cropper.getMax();
+        mi::Logger::getStream()<<"crop : ("<<bmin.x()<<", "<<bmin.y()<<", "<<bmin.z()<<") - ("<<bmax.x()<<", "<<bmax.y()<<", "<<bmax.z()<<")"<<std::endl;
         return true;
 }
 
@@ -62,34 +133,121 @@ bool
 ExtractEndocastCommand<T>::run  ( void )
 {
 	std::cerr<<"run"<<std::endl;
-        const mi::VolumeInfo& info = const_cast<mi::VolumeData<T>&>( this->_ctData ).getInfo();
-	
-        mi::VolumeData<char> binaryData( info );
+        if ( this->isSweepMode() ) return this->sweep();
+        mi::VolumeData<char>  labelData;
+        labelData.setHalo( 1, 0 );
+        const uint64_t labelKey = this->cache_key( "label", this->_isovalue, this->_hole );
+        if ( this->_cache.load( "label", labelKey, labelData ) ) {
+                mi::Logger::getStream()<<"cache : "<<this->_cache.getFileName( "label", labelKey )<<std::endl;
+        } else {
+                if ( ! this->compute_label( labelData ) ) return false;
+                this->_cache.save( "label", labelKey, labelData );
+        }
+        this->getTimer().start( "polygonize" );
+        this->polygonize_endocast( this->_ctData, labelData, this->_isovalue, this->_endocast_polygon, mi::Logger::getStream() );
+        this->getTimer().end( "polygonize" );
+        return true;
+}
+
+template<typename T>
+bool
+ExtractEndocastCommand<T>::compute_label ( mi::VolumeData<char>& labelData )
+{
+        const mi::VolumeInfo& info = this->_ctData.getInfo();
+        mi::VolumeData<float> distData;
+        distData.setHalo( 1, 0 ); // watershed runs without bounds checks.
         this->getTimer().start("initialize");
-        this->binarize( this->_ctData, binaryData ) ;
-	std::cerr<<"binarize"<<std::endl;
-        mi::VolumeData<float> distData( info );
-	std::cerr<<"df"<<std::endl;
-        if( !mi::VolumeDataUtility::compute_distance_field( binaryData, distData ) ) return false; // binary -> vdf
-        mi::VolumeDataUtility::debug_save( distData, this->create_file_name( "dist", "raw" ) );
-        binaryData.deallocate();
+        if ( ! this->prepare_distance( distData, this->_hole ) ) return false;
         this->getTimer().end("initialize");
 	this->getTimer().start( "watershed" );
 	std::cerr<<"ws"<<std::endl;
-        mi::VolumeData<char>  labelData( info );
-        this->watershed( distData, labelData );
-        distData.deallocate();
+        labelData.init( info );
+        this->watershed( distData, labelData, this->_hole );
         this->getTimer().end( "watershed" );
-        this->getTimer().start( "polygonize" );
-        this->polygonize_endocast( labelData );
-        this->getTimer().end( "polygonize" );
         return true;
 }
 
+/**
+ * @brief Binarize the ct data by the current isovalue, or load the result of a previous run ( -cache ).
+ */
+template<typename T>
+bool
+ExtractEndocastCommand<T>::prepare_binary ( mi::VolumeData<char>& binaryData )
+{
+        const uint64_t key = this->cache_key( "binary", this->_isovalue, 0 );
+        if ( this->_cache.load( "binary", key, binaryData ) ) {
+                mi::Logger::getStream()<<"cache : "<<this->_cache.getFileName( "binary", key )<<std::endl;
+                return true;
+        }
+        binaryData.init( this->_ctData.getInfo() );
+        if ( ! this->binarize( this->_ctData, binaryData ) ) return false;
+	std::cerr<<"binarize"<<std::endl;
+        this->_cache.save( "binary", key, binaryData );
+        return true;
+}
+
+/**
+ * @brief Distance field of the binary data, or the result of a previous run ( -cache ). The binary data is released.
+ * With -multires, distances are exact only below the limit ( BandDistanceField ) and the others are the limit or more.
+ * @param [out] distData Distance field.
+ * @param [in] limit The largest -hole value the field is used for ( -multires ).
+ */
+template<typename T>
+bool
+ExtractEndocastCommand<T>::prepare_distance ( mi::VolumeData<float>& distData, const double limit )
+{
+        const uint64_t key = this->cache_key( "dist", this->_isovalue, limit );
+        if ( this->_cache.load( "dist", key, distData ) ) {
+                mi::Logger::getStream()<<"cache : "<<this->_cache.getFileName( "dist", key )<<std::endl;
+                return true;
+        }
+        mi::VolumeData<char> binaryData;
+        if ( ! this->prepare_binary( binaryData ) ) return false;
+	std::cerr<<"df"<<std::endl;
+        if ( this->_multires > 0 ) {
+                BandDistanceField field( binaryData, this->_multires );
+                field.setNumThread( this->_num_threads );
+                if ( ! field.compute( limit, distData ) ) return false;
+                mi::Logger::getStream()<<"multires : 1/"<<( 1 << this->_multires )<<", band voxels : "<<field.getNumBandVoxels()<<std::endl;
+        } else {
+                distData.init( binaryData.getInfo() );
+                if( !mi::VolumeDataUtility::compute_distance_field( binaryData, distData ) ) return false; // binary -> vdf
+        }
+        mi::VolumeDataUtility::debug_save( distData, this->create_file_name( "dist", "raw" ) );
+        this->_cache.save( "dist", key, distData );
+        return true;
+}
+
+/**
+ * @brief Key of a stage : the ct data and the parameters the stage depends on.
+ * @param [in] stage "binary", "dist" or "label".
+ * @param [in] isovalue Isovalue.
+ * @param [in] hole -hole ( "label" ), or the limit of distances ( "dist" with -multires ).
+ */
+template<typename T>
+uint64_t
+ExtractEndocastCommand<T>::cache_key ( const std::string& stage, const T isovalue, const double hole ) const
+{
+        uint64_t key = mi::VolumeDataCache::combine( this->_ct_key, stage );
+        key = mi::VolumeDataCache::combine( key, isovalue );
+        if ( stage == "dist" && this->_multires > 0 ) {
+                key = mi::VolumeDataCache::combine( key, this->_multires );
+                key = mi::VolumeDataCache::combine( key, hole );
+        }
+        if ( stage == "label" ) {
+                key = mi::VolumeDataCache::combine( key, this->_multires );
+                key = mi::VolumeDataCache::combine( key, this->_auto );
+                if ( ! this->_auto ) key = mi::VolumeDataCache::combine( key, hole );
+        }
+        return key;
+}
+
 template<typename T>
 bool
 ExtractEndocastCommand<T> ::term ( void )
 {
+        mi::VolumeDataUtility::flush_debug();
+        if ( this->isSweepMode() ) return true; // meshes were saved in sweep().
         return mi::MeshUtility::save( this->_endocast_polygon, this->_output_file );
 }
 
@@ -97,31 +255,50 @@ template<typename T>
 bool
 ExtractEndocastCommand<T> ::binarize ( const mi::VolumeData<T>& ctData, mi::VolumeData<char>& binaryData )
 {
-        const mi::VolumeInfo& info = const_cast<mi::VolumeData<T>&>( this->_ctData ).getInfo();
-        mi::VolumeData<char> tmpData( info );
-        Binarizer<T, char> binarizer( this->_ctData, 1, 0 );
-        binarizer.binarize( this->_isovalue, tmpData );
-
-        // remove smaller components.
-        mi::VolumeDataUtility::extract_nth_component( tmpData, binaryData, 1 );
-
-        mi::Range range( info.getMin(), info.getMax() );
-        for( mi::Range::iterator iter = range.begin() ; iter != range.end() ; ++iter ) {
-                const mi::Point3i& p = *iter;
-                const char value = 1 - binaryData.get( p );
-                binaryData.set( p, value );
+        // voxels above the isovalue are encoded into runs directly, and smaller components are removed in runs.
+        // only the largest component is decoded ( as 0 ), so no temporary volume is needed.
+        const mi::Point3i size = const_cast<mi::VolumeData<T>&>( this->_ctData ).getInfo().getSize();
+        mi::ConnectedComponentLabellerRle labeller( size );
+        labeller.setNumThread( this->_num_threads );
+        if ( this->_slab > 0 ) {
+                if ( ! this->stream_binarize( labeller ) ) return false;
+        } else {
+                labeller.encode( this->_ctData, this->_isovalue, 0, size.z() );
         }
+        labeller.label( true );
+        labeller.getNotNthComponents( binaryData, 1 );
         mi::VolumeDataUtility::debug_save( binaryData, this->create_file_name( "binary", "raw" ) );
         return true;
 }
 
+/**
+ * @brief Read the CT file on a background thread and encode each slab into runs as soon as it arrives.
+ */
+template<typename T>
+bool
+ExtractEndocastCommand<T> ::stream_binarize ( mi::ConnectedComponentLabellerRle& labeller )
+{
+        mi::RawValueType type;
+        if ( ! mi::getRawValueType( this->_src_type, type ) ) return false;
+        mi::VolumeDataStreamReader<T> reader( this->_ctData, this->_header_size );
+        reader.setValueType( type ).setBigEndian( this->_isBigEndian ).setOffset( this->_value_offset ).setSlabSize( this->_slab );
+        if ( ! reader.open( this->_ct_file ) ) return false;
+
+        int zbegin, zend;
+        while ( reader.next( zbegin, zend ) ) {
+                labeller.encode( this->_ctData, this->_isovalue, zbegin, zend );
+        }
+        if ( ! reader.close() ) return false;
+        reader.print( mi::Logger::getStream() );
+        return true;
+}
 
 template<typename T>
 bool
-ExtractEndocastCommand<T>::watershed( mi::VolumeData<float>& distData, mi::VolumeData<char>& labelData )
+ExtractEndocastCommand<T>::watershed( mi::VolumeData<float>& distData, mi::VolumeData<char>& labelData, const double hole )
 {
 	//@note あまりにも大きいのははじいたほうがよい。
-        const mi::VolumeInfo& info = const_cast<mi::VolumeData<T>&>( this->_ctData ).getInfo();
+        const mi::VolumeInfo& info = distData.getInfo();
         mi::Range range( info.getMin(), info.getMax() );
 
         if ( this->_auto ) {
@@ -153,7 +330,7 @@ ExtractEndocastCommand<T>::watershed( mi::VolumeData<float>& distData, mi::Volum
                 creator.fillSphere( maxp, maxDist * 0.5f );
         } else {
                 mi::VolumeData<char> initData( info );
-                float maxDist = this->_hole;
+                float maxDist = static_cast<float>( hole );
                 for( mi::Range::iterator iter = range.begin() ; iter != range.end() ; ++iter ) {
                         const mi::Point3i p = *iter;
                         const char value = ( distData.get( p ) < maxDist ) ? 0 : 1;
@@ -181,7 +358,7 @@ ExtractEndocastCommand<T>::watershed( mi::VolumeData<float>& distData, mi::Volum
 	}
 */
       mi::WatershedProcessor<char> processor( distData );
-        processor.process( labelData );
+        processor.process( labelData, true ); // ties are taken in the order of voxels, so the result is the same.
         std::cerr<<"watershed computed."<<std::endl;
         mi::VolumeDataUtility::debug_save( labelData, this->create_file_name( "label", "raw" ) );
         return true;
@@ -190,10 +367,10 @@ ExtractEndocastCommand<T>::watershed( mi::VolumeData<float>& distData, mi::Volum
 
 template<typename T>
 bool
-ExtractEndocastCommand<T>::polygonize_endocast( mi::VolumeData<char>& labelData )
+ExtractEndocastCommand<T>::polygonize_endocast( mi::VolumeData<T>& ctData, mi::VolumeData<char>& labelData, const T isovalue, mi::Mesh& result, std::ostream& log )
 {
 
-        const mi::VolumeInfo& info = const_cast<mi::VolumeData<T>&>( this->_ctData ).getInfo();
+        const mi::VolumeInfo& info = ctData.getInfo();
         mi::Range range( info.getMin(), info.getMax() );
         mi::Mesh mesh;
         if ( this->_fillHole ) {
@@ -201,25 +378,36 @@ ExtractEndocastCommand<T>::polygonize_endocast( mi::VolumeData<char>& labelData
                         const mi::Point3i p = *iter;
                         const int label = labelData.get( p );
                         if ( label != 0 && label != 2 ) {
-                                this->_ctData.set( p, this->_isovalue ) ;
+                                ctData.set( p, isovalue ) ;
                         }
                 }
-                mi::VolumeDataUtility::debug_save( this->_ctData, this->create_file_name( "filled", "raw" ) );
-                mi::VolumeDataUtility::polygonize( this->_ctData, mesh, this->_isovalue );
+                mi::VolumeDataUtility::debug_save( ctData, this->create_file_name( "filled", "raw" ) );
+                mi::VolumeDataUtility::polygonize( ctData, mesh, isovalue );
         } else {
-                mi::VolumeDataPolygonizer<T> polygonizer( this->_ctData );
-                mi::VolumeData<char> mask ( info ) ;
-                for( mi::Range::iterator iter = range.begin() ; iter != range.end() ; ++iter ) {
-                        const mi::Point3i p = *iter;
-                        if ( labelData.get( p ) == 2 ) { // check
-                                mask.set( p, 1 ) ; //check
-                        } else mask.set( p, 0 );
+                mi::VolumeDataPolygonizer<T> polygonizer( ctData );
+                // voxels of label 2 are below the iso-value, so only its shell can touch the iso-surface.
+                if ( labelData.getHalo() < 1 ) labelData.setHalo( 1, 0 );
+                const mi::NeighborOffset<26> nbr( labelData.getStrideY(), labelData.getStrideZ() );
+                const mi::Point3i& size = info.getSize();
+                mi::SparseVolumeData<char> mask ( info ) ;
+                for( int z = 0 ; z < size.z() ; ++z ) {
+                        for( int y = 0 ; y < size.y() ; ++y ) {
+                                const char* row = labelData.getPointer( y, z );
+                                for( int x = 0 ; x < size.x() ; ++x ) {
+                                        if ( row[x] != 2 ) continue;
+                                        for( int i = 0 ; i < mi::NeighborOffset<26>::size ; ++i ) {
+                                                if ( row[ x + nbr[i] ] == 2 ) continue;
+                                                mask.set( x, y, z, 1 );
+                                                break;
+                                        }
+                                }
+                        }
                 }
-                polygonizer.polygonize( static_cast<float>( this->_isovalue ),  mesh, mask );
+                log<<"mask bricks : "<<mask.getNumAllocatedBricks()<<" / "<<mask.getNumBricks()<<std::endl;
+                polygonizer.polygonize( static_cast<float>( isovalue ),  mesh, mask );
         }
 
         mi::MeshUtility::stitch( mesh );
-        this->_endocast_polygon.clone( mesh );
         mesh.negateOrientation();
         mi::AssemblyMesh assy;
         mi::MeshUtility::decompose( mesh, assy );
@@ -232,12 +420,137 @@ ExtractEndocastCommand<T>::polygonize_endocast( mi::VolumeData<char>& labelData
                         max_num_faces = num_faces;
                 }
         }
-        this->_endocast_polygon.clone( *assy.getMesh( id ) );
-        mi::MeshUtility::stitch( this->_endocast_polygon );
-	mi::Logger::getStream()<<"#triangles : "<<this->_endocast_polygon.getNumFaces()<<std::endl;
+        if ( assy.getNumMeshes() > 0 ) result.swap( *assy.getMesh( id ) );
+        mi::MeshUtility::stitch( result );
+	log<<"#triangles : "<<result.getNumFaces()<<std::endl;
+        return true;
+}
+
+template<typename T>
+bool
+ExtractEndocastCommand<T>::isSweepMode ( void ) const
+{
+        return !this->_sweep_iso.empty() || !this->_sweep_hole.empty();
+}
+
+/**
+ * @brief Isovalues of -sweep_iso, or -iso when it is empty.
+ */
+template<typename T>
+std::vector<T>
+ExtractEndocastCommand<T>::getSweepIsovalues ( void ) const
+{
+        std::vector<T> isovalues;
+        mi::Tokenizer isoTokens( this->_sweep_iso, "," );
+        for ( int i = 0 ; i < isoTokens.size() ; ++i ) isovalues.push_back( mi::parse<T>( isoTokens.get( i ) ) );
+        if ( isovalues.empty() ) isovalues.push_back( this->_isovalue );
+        return isovalues;
+}
+
+/**
+ * @brief Run the pipeline for combinations of isovalues and -hole values.
+ *
+ * Binarization and the distance field are computed once per isovalue, and -hole values share them.
+ * Watershed and polygonization of -hole values run in parallel as long as their volumes fit in -sweep_mem.
+ * Each mesh is saved to the output file name with "-iso<value>-hole<value>" before the extension.
+ * Jobs write logs to their own buffers, which are written in the order of -hole values after the jobs end.
+ */
+template<typename T>
+bool
+ExtractEndocastCommand<T>::sweep ( void )
+{
+        const std::vector<T> isovalues = this->getSweepIsovalues();
+        std::vector<double> holes;
+        mi::Tokenizer holeTokens( this->_sweep_hole, "," );
+        for ( int i = 0 ; i < holeTokens.size() ; ++i ) holes.push_back( mi::parse<double>( holeTokens.get( i ) ) );
+        if ( holes.empty() ) holes.push_back( this->_hole );
+        if ( this->_auto && holes.size() > 1 ) {
+                std::cerr<<"warning : -sweep_hole is ignored with -auto."<<std::endl;
+                holes.resize( 1 );
+        }
+        const double maxHole = *std::max_element( holes.begin(), holes.end() ); // distances of -multires are exact below it.
+
+        // volumes of a job : labels, seeds and a copy of the ct data ( -fill ).
+        const mi::Point3i size = this->_ctData.getInfo().getSize();
+        const double voxels = static_cast<double>( size.x() ) * size.y() * size.z();
+        const double bytes = voxels * ( 2 + ( this->_fillHole ? sizeof( T ) : 0 ) );
+        const int fit = static_cast<int>( this->_sweep_memory * 1024.0 * 1024.0 / bytes );
+        int njobs = std::max( 1, std::min( std::min( this->_num_threads, fit ), static_cast<int>( holes.size() ) ) );
+        if ( this->isDebugModeOn() ) njobs = 1; // debug data of jobs have the same names.
+        const int jobThreads = std::max( 1, this->_num_threads / njobs ); // stages in a job share the threads.
+        mi::Logger::getStream()<<"sweep : "<<isovalues.size()<<" isovalue(s) x "<<holes.size()<<" hole(s), "<<njobs<<" job(s) in parallel"<<std::endl;
+
+        for ( size_t i = 0 ; i < isovalues.size() ; ++i ) {
+                this->_isovalue = isovalues[i]; // used in binarize().
+                this->getTimer().start( "initialize" );
+                mi::VolumeData<float> distData;
+                distData.setHalo( 1, 0 ); // watershed runs without bounds checks.
+                if ( ! this->prepare_distance( distData, maxHole ) ) return false;
+                this->getTimer().end( "initialize" );
+
+                this->getTimer().start( "watershed and polygonize" );
+                std::vector<char> success( holes.size(), 0 );
+                std::vector<std::string> logs( holes.size() );
+                std::vector<int> chunks( njobs );
+                for ( int c = 0 ; c < njobs ; ++c ) chunks[c] = c;
+                const T isovalue = isovalues[i];
+                auto job = [&] ( const int c ) {
+                        for ( size_t h = static_cast<size_t>( c ) ; h < holes.size() ; h += static_cast<size_t>( njobs ) ) {
+                                std::stringstream log;
+                                success[h] = this->sweep_job( isovalue, holes[h], distData, log ) ? 1 : 0;
+                                logs[h] = log.str();
+                        }
+                };
+                mi::VolumeDataUtility::setNumThread( jobThreads );
+                mi::MeshUtility::setNumThread( jobThreads );
+                if ( njobs == 1 ) job( 0 );
+                else mi::parallel_for_each( chunks.begin(), chunks.end(), job, 1 );
+                mi::VolumeDataUtility::setNumThread( this->_num_threads );
+                mi::MeshUtility::setNumThread( this->_num_threads );
+                for ( size_t h = 0 ; h < logs.size() ; ++h ) mi::Logger::getStream()<<logs[h];
+                this->getTimer().end( "watershed and polygonize" );
+                if ( std::find( success.begin(), success.end(), 0 ) != success.end() ) return false;
+        }
         return true;
 }
 
+/**
+ * @brief Watershed and polygonization for a pair of parameters. Shared data are not modified.
+ * @param [out] log Stream for logs of the job.
+ */
+template<typename T>
+bool
+ExtractEndocastCommand<T>::sweep_job ( const T isovalue, const double hole, mi::VolumeData<float>& distData, std::ostream& log )
+{
+        mi::VolumeData<T>& ctData = this->_ctData;
+        const mi::VolumeInfo& info = ctData.getInfo();
+        mi::VolumeData<char> labelData;
+        labelData.setHalo( 1, 0 );
+        const uint64_t labelKey = this->cache_key( "label", isovalue, hole );
+        if ( this->_cache.load( "label", labelKey, labelData ) ) {
+                log<<"cache : "<<this->_cache.getFileName( "label", labelKey )<<std::endl;
+        } else {
+                labelData.init( info );
+                if ( ! this->watershed( distData, labelData, hole ) ) return false;
+                this->_cache.save( "label", labelKey, labelData );
+        }
+
+        mi::Mesh mesh;
+        if ( this->_fillHole ) { // holes are filled in a copy.
+                mi::VolumeData<T> filledData( info, false );
+                filledData.clone( ctData );
+                if ( ! this->polygonize_endocast( filledData, labelData, isovalue, mesh, log ) ) return false;
+        } else {
+                if ( ! this->polygonize_endocast( ctData, labelData, isovalue, mesh, log ) ) return false;
+        }
+
+        mi::FileNameConverter converter( this->_output_file );
+        std::stringstream ss;
+        ss<<converter.removeExtension()<<"-iso"<<static_cast<double>( isovalue )<<"-hole"<<hole<<"."<<converter.getExtension();
+        log<<"iso "<<static_cast<double>( isovalue )<<", hole "<<hole<<" : "<<mesh.getNumFaces()<<" triangles"<<std::endl;
+        return mi::MeshUtility::save( mesh, ss.str() );
+}
+
 template<typename T>
 std::string
 ExtractEndocastCommand<T>::create_file_name ( const std::string& tail, const std::string& ext )
@@ -4,6 +4,8 @@
 #include <mi/VolumeData.hpp>
 #include <mi/Mesh.hpp>
 #include <mi/FileNameConverter.hpp>
+#include <mi/VolumeDataCache.hpp>
+#include <mi/ConnectedComponentLabellerRle.hpp>
 template <typename T>
 class ExtractEndocastCommand : public mi::CommandTemplate
 {
@@ -12,6 +14,10 @@ private:
         std::string _output_file;
 
         int _header_size;
+        std::string _src_type;
+        bool _isBigEndian;
+        double _value_offset;
+        int _slab;
         mi::Point3i _size;
         mi::Vector3d _pitch;
         mi::Vector3d _origin;
@@ -27,7 +33,18 @@ private:
 
         bool _auto;
         bool _fillHole;
+        bool _crop;
+        double _margin;
+        int _multires;
+        std::string _sweep_iso;
+        std::string _sweep_hole;
+        int _sweep_memory;
+        std::string _cache_dir;
+        mi::VolumeDataCache _cache;
+        uint64_t _ct_key; ///< Hash of the ct data ( -cache ).
         int _num_threads;
+        int _debug_memory;
+        bool _debug_brick;
 
 public:
         ExtractEndocastCommand ( void ) ;
@@ -38,8 +55,19 @@ public:
         bool term ( void ) ;
 private:
         bool binarize ( const mi::VolumeData<T>& ctData, mi::VolumeData<char>& binaryData ) ;
-        bool watershed( mi::VolumeData<float>& distData, mi::VolumeData<char>& labelData ) ;
-        bool polygonize_endocast( mi::VolumeData<char>& labelData );
+        bool stream_binarize ( mi::ConnectedComponentLabellerRle& labeller ) ;
+        bool crop ( void ) ;
+        bool compute_label ( mi::VolumeData<char>& labelData ) ;
+        bool prepare_binary ( mi::VolumeData<char>& binaryData ) ;
+        bool prepare_distance ( mi::VolumeData<float>& distData, const double limit ) ;
+        uint64_t cache_key ( const std::string& stage, const T isovalue, const double hole ) const ;
+        bool watershed( mi::VolumeData<float>& distData, mi::VolumeData<char>& labelData, const double hole ) ;
+        bool polygonize_endocast( mi::VolumeData<T>& ctData, mi::VolumeData<char>& labelData, const T isovalue, mi::Mesh& result, std::ostream& log );
+
+        bool isSweepMode ( void ) const ;
+        std::vector<T> getSweepIsovalues ( void ) const ;
+        bool sweep ( void ) ;
+        bool sweep_job ( const T isovalue, const double hole, mi::VolumeData<float>& distData, std::ostream& log ) ;
 
         std::string create_file_name ( const std::string& tail, const std::string& ext );
 };